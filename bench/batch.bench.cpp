@@ -0,0 +1,127 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/batch.hpp>
+#include "bench.hpp"
+#include <cstdint>
+#include <vector>
+
+// Batch kernels against the scalar loops they replace, over 16K samples
+// where one in 1000 is an error.
+
+namespace {
+
+    constexpr std::size_t count = 16384;
+
+    using Sample = std::expected<float, std::uint8_t>;
+    using Scaled = std::expected<std::int32_t, std::uint8_t>;
+
+    std::vector<Sample> make_samples() {
+        std::vector<Sample> v;
+        v.reserve(count);
+        for (std::size_t i = 0; i != count; ++i) {
+            if (i % 1000 == 999)
+                v.emplace_back(std::unexpect, std::uint8_t(1));
+            else
+                v.emplace_back(static_cast<float>(i % 100));
+        }
+        return v;
+    }
+
+    constexpr auto scale = [](float x) { return static_cast<std::int32_t>(x * 16.0f); };
+
+    void transform_scalar(bench::State& state) {
+        const auto in = make_samples();
+        std::vector<Scaled> out(in.size());
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(in);
+            for (std::size_t j = 0; j != in.size(); ++j)
+                out[j] = in[j].transform(scale);
+            bench::do_not_optimize(out);
+        }
+    }
+
+    void transform_batch(bench::State& state) {
+        const auto in = make_samples();
+        std::vector<Scaled> out(in.size());
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(in);
+            kz::batch::transform(in, out, scale);
+            bench::do_not_optimize(out);
+        }
+    }
+
+    void sum_scalar(bench::State& state) {
+        const auto in = make_samples();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(in);
+            float sum = 0;
+            for (const auto& e : in)
+                sum += e.value_or(0.0f);
+            bench::do_not_optimize(sum);
+        }
+    }
+
+    void sum_batch(bench::State& state) {
+        const auto in = make_samples();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(in);
+            float sum = kz::batch::sum_values(in);
+            bench::do_not_optimize(sum);
+        }
+    }
+
+    // No errors: the whole array is scanned
+    void any_error_scalar(bench::State& state) {
+        const std::vector<Sample> in(count, 1.0f);
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(in);
+            bool any = false;
+            for (const auto& e : in)
+                any |= !e.has_value();
+            bench::do_not_optimize(any);
+        }
+    }
+
+    void any_error_batch(bench::State& state) {
+        const std::vector<Sample> in(count, 1.0f);
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(in);
+            bool any = kz::batch::any_error(in);
+            bench::do_not_optimize(any);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("batch/transform/scalar", transform_scalar);
+BENCHMARK("batch/transform/batch", transform_batch);
+BENCHMARK("batch/sum_values/scalar", sum_scalar);
+BENCHMARK("batch/sum_values/batch", sum_batch);
+BENCHMARK("batch/any_error/scalar", any_error_scalar);
+BENCHMARK("batch/any_error/batch", any_error_batch);
@@ -0,0 +1,108 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Minimal, dependency-free microbenchmark harness.
+//
+//  static void my_benchmark(bench::State& state) {
+//      for (std::size_t i = 0; i != state.iterations(); ++i) {
+//          bench::do_not_optimize(work());
+//      }
+//  }
+//  BENCHMARK("group/name", my_benchmark);
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+namespace bench {
+
+    class State {
+    public:
+        explicit State(std::size_t iterations) : _iterations(iterations) {}
+
+        std::size_t iterations() const noexcept { return _iterations; }
+
+    private:
+        std::size_t _iterations;
+    };
+
+    using Function = void (*)(State&);
+
+    struct Benchmark {
+        const char* name;
+        Function function;
+    };
+
+    inline std::vector<Benchmark>& registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, Function function) {
+            registry().push_back({name, function});
+        }
+    };
+
+    // Force the compiler to assume the value is read and modified
+    template <class T>
+    inline void do_not_optimize(T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : "+m"(value) : : "memory");
+#else
+        static const void* volatile sink;
+        sink = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    template <class T>
+    inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "m"(value) : "memory");
+#else
+        static const void* volatile sink;
+        sink = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+} // namespace bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+// __COUNTER__ rather than __LINE__: a macro can expand to several benchmarks
+#define BENCHMARK(name, function) \
+    static const bench::Registrar BENCH_CONCAT(bench_registrar_, __COUNTER__)(name, function)
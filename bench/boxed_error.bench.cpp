@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/boxed_error.hpp>
+#include "bench.hpp"
+#include <string>
+#include <vector>
+
+// Return-by-value cost of the success path with a large inline error versus
+// the same error boxed out-of-line.
+
+namespace {
+
+    struct Diagnostic {
+        std::string message;
+        std::string file;
+        int line;
+        int column;
+        std::vector<std::string> context;
+        std::string hint;
+    };
+
+    template <class E>
+    BENCH_NOINLINE std::expected<int, E> parse(int x) {
+        if (x < 0) {
+            return std::unexpected(Diagnostic{"negative value", "input.txt", 1, x, {}, {}});
+        }
+        return x * 2;
+    }
+
+    // A few layers of propagation, each returning by value
+    template <class E>
+    BENCH_NOINLINE std::expected<int, E> validate(int x) {
+        auto r = parse<E>(x);
+        if (!r) {
+            return std::unexpected(std::move(r.error()));
+        }
+        return *r + 1;
+    }
+
+    template <class E>
+    BENCH_NOINLINE std::expected<int, E> process(int x) {
+        auto r = validate<E>(x);
+        if (!r) {
+            return std::unexpected(std::move(r.error()));
+        }
+        return *r * 3;
+    }
+
+    template <class E>
+    void success(bench::State& state) {
+        int x = 1;
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(x);
+            auto r = process<E>(x);
+            bench::do_not_optimize(r);
+        }
+    }
+
+    template <class E>
+    void failure(bench::State& state) {
+        int x = -1;
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(x);
+            auto r = process<E>(x);
+            bench::do_not_optimize(r);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("boxed_error/success/inline", success<Diagnostic>);
+BENCHMARK("boxed_error/success/boxed", success<kz::boxed_error<Diagnostic>>);
+BENCHMARK("boxed_error/failure/inline", failure<Diagnostic>);
+BENCHMARK("boxed_error/failure/boxed", failure<kz::boxed_error<Diagnostic>>);
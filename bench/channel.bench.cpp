@@ -0,0 +1,117 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/channel.hpp>
+#include "bench.hpp"
+#include <atomic>
+#include <future>
+#include <thread>
+
+// Handoff of an expected between threads: result_channel against
+// std::promise / std::future, which allocate shared state and lock.
+
+namespace {
+
+    using Result = std::expected<int, int>;
+
+    // Same thread: create, publish and consume
+    void channel_local(bench::State& state) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            kz::result_channel<int, int> channel;
+            auto future = channel.get_future();
+            channel.set_value(static_cast<int>(i));
+            auto r = std::move(future).get();
+            bench::do_not_optimize(r);
+        }
+    }
+
+    void future_local(bench::State& state) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            std::promise<Result> promise;
+            auto future = promise.get_future();
+            promise.set_value(static_cast<int>(i));
+            auto r = future.get();
+            bench::do_not_optimize(r);
+        }
+    }
+
+    // Round trip to a spinning worker thread: post a slot through a
+    // mailbox, the worker publishes the result, wait for it. The slot is
+    // only destroyed once the worker is done with it. Both sides yield when
+    // idle so that the benchmark also works with a single core.
+    template <class Slot, class Publish, class Consume>
+    void round_trip(bench::State& state, Publish publish, Consume consume) {
+        std::atomic<Slot*> mailbox{nullptr};
+        std::atomic<Slot*> finished{nullptr};
+        std::atomic<bool> done{false};
+
+        std::thread worker([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                if (Slot* slot = mailbox.exchange(nullptr, std::memory_order_acquire)) {
+                    publish(*slot);
+                    finished.store(slot, std::memory_order_release);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            Slot slot;
+            auto future = slot.get_future();
+            mailbox.store(&slot, std::memory_order_release);
+            auto r = consume(future);
+            bench::do_not_optimize(r);
+            while (finished.load(std::memory_order_acquire) != &slot)
+                std::this_thread::yield();
+        }
+
+        done.store(true);
+        worker.join();
+    }
+
+    void channel_thread(bench::State& state) {
+        round_trip<kz::result_channel<int, int>>(
+            state,
+            [](kz::result_channel<int, int>& slot) { slot.set_value(1); },
+            [](auto& future) { return std::move(future).get(); });
+    }
+
+    void future_thread(bench::State& state) {
+        round_trip<std::promise<Result>>(
+            state,
+            [](std::promise<Result>& slot) { slot.set_value(1); },
+            [](auto& future) { return future.get(); });
+    }
+
+} // namespace
+
+BENCHMARK("channel/local/result_channel", channel_local);
+BENCHMARK("channel/local/std::future", future_local);
+BENCHMARK("channel/thread/result_channel", channel_thread);
+BENCHMARK("channel/thread/std::future", future_thread);
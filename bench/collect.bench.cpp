@@ -0,0 +1,170 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/collect.hpp>
+#include "bench.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// collect() against a hand-written loop, and parallel_transform_collect()
+// against a sequential transform + collect on CPU-bound work.
+
+namespace {
+
+    using Result = std::expected<std::uint64_t, int>;
+
+    std::vector<Result> make_results() {
+        std::vector<Result> results;
+        for (std::uint64_t i = 0; i != 1000; ++i)
+            results.emplace_back(i);
+        return results;
+    }
+
+    void collect_kz(bench::State& state) {
+        const auto results = make_results();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto r = kz::collect(results);
+            bench::do_not_optimize(r);
+        }
+    }
+
+    void collect_loop(bench::State& state) {
+        const auto results = make_results();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            std::expected<std::vector<std::uint64_t>, int> r;
+            for (const auto& e : results) {
+                if (!e) {
+                    r = std::unexpected(e.error());
+                    break;
+                }
+                r->push_back(*e);
+            }
+            bench::do_not_optimize(r);
+        }
+    }
+
+    // A few microseconds of arithmetic per item
+    BENCH_NOINLINE Result work(std::uint64_t x) {
+        for (int i = 0; i != 2000; ++i)
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+        if (x == 0)
+            return std::unexpected(0);
+        return x;
+    }
+
+    class ThreadPool {
+    public:
+        ThreadPool() {
+            const unsigned count = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned i = 0; i != count; ++i)
+                _threads.emplace_back([this] { loop(); });
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _done = true;
+            }
+            _condition.notify_all();
+            for (auto& thread : _threads)
+                thread.join();
+        }
+
+        std::size_t concurrency() const { return _threads.size(); }
+
+        void execute(std::function<void()> task) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _tasks.push(std::move(task));
+            }
+            _condition.notify_one();
+        }
+
+    private:
+        void loop() {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _condition.wait(lock, [this] { return _done || !_tasks.empty(); });
+                    if (_tasks.empty())
+                        return;
+                    task = std::move(_tasks.front());
+                    _tasks.pop();
+                }
+                task();
+            }
+        }
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::queue<std::function<void()>> _tasks;
+        std::vector<std::thread> _threads;
+        bool _done = false;
+    };
+
+    std::vector<std::uint64_t> make_inputs() {
+        std::vector<std::uint64_t> inputs(4096);
+        for (std::size_t i = 0; i != inputs.size(); ++i)
+            inputs[i] = i + 1;
+        return inputs;
+    }
+
+    void transform_sequential(bench::State& state) {
+        const auto inputs = make_inputs();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            std::vector<Result> results;
+            results.reserve(inputs.size());
+            for (auto x : inputs)
+                results.push_back(work(x));
+            auto r = kz::collect(std::move(results));
+            bench::do_not_optimize(r);
+        }
+    }
+
+    void transform_parallel(bench::State& state) {
+        const auto inputs = make_inputs();
+        ThreadPool pool;
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto r = kz::parallel_transform_collect(inputs, work, pool);
+            bench::do_not_optimize(r);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("collect/1000/kz::collect", collect_kz);
+BENCHMARK("collect/1000/loop", collect_loop);
+BENCHMARK("collect/transform/sequential", transform_sequential);
+BENCHMARK("collect/transform/parallel", transform_parallel);
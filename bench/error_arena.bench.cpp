@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/error_arena.hpp>
+#include "bench.hpp"
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Validation where 30% of the inputs fail with a formatted message and a
+// context entry: heap-allocated strings against arena_error, released in
+// bulk after each batch of 100 inputs. Both format with snprintf. The
+// difference is the allocations. Time is per input.
+
+namespace {
+
+    struct HeapError {
+        std::string message;
+        std::vector<std::pair<std::string, std::string>> context;
+    };
+
+    BENCH_NOINLINE std::expected<int, HeapError> validate_heap(int value) {
+        if (value % 10 < 3) {
+            char message[64];
+            std::snprintf(message, sizeof(message), "value %d is out of range", value);
+            HeapError error{message, {}};
+            error.context.emplace_back("field", "threshold");
+            return std::unexpected(std::move(error));
+        }
+        return value;
+    }
+
+    BENCH_NOINLINE std::expected<int, kz::arena_error> validate_arena(int value) {
+        if (value % 10 < 3)
+            return std::unexpected(kz::arena_error::format("value %d is out of range", value).with_context("field", "threshold"));
+        return value;
+    }
+
+    template <class Validate>
+    void run(bench::State& state, Validate validate) {
+        std::size_t failures = 0;
+        for (std::size_t i = 0; i < state.iterations(); i += 100) {
+            kz::error_arena::scope scope;
+            for (int j = 0; j != 100; ++j) {
+                auto r = validate(static_cast<int>(i) + j);
+                failures += !r.has_value();
+                bench::do_not_optimize(r);
+            }
+        }
+        bench::do_not_optimize(failures);
+    }
+
+    void heap_errors(bench::State& state) { run(state, validate_heap); }
+    void arena_errors(bench::State& state) { run(state, validate_arena); }
+
+} // namespace
+
+BENCHMARK("error_arena/30%/std::string", heap_errors);
+BENCHMARK("error_arena/30%/arena_error", arena_errors);
@@ -0,0 +1,316 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "bench.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Benchmarks written once against any implementation of expected, so that
+// kz::expected and the standard library's std::expected run the exact same
+// code. This header does not include <expected>: an implementation is a
+// traits class naming its templates,
+//
+//  struct my_lib {
+//      template <class T, class E> using expected = my::expected<T, E>;
+//      template <class E> using unexpected = my::unexpected<E>;
+//  };
+//
+// and EXPECTED_OPERATION_BENCHMARKS("my", my_lib) registers the benchmarks
+// for it. The monadic operations are separate, as some standard libraries
+// have std::expected without them.
+
+namespace bench::suite {
+
+    template <class Lib>
+    using expected_int = typename Lib::template expected<int, int>;
+
+    template <class Lib>
+    using expected_string = typename Lib::template expected<std::string, std::string>;
+
+    template <class Lib>
+    using unexpected_int = typename Lib::template unexpected<int>;
+
+    template <class Lib>
+    using unexpected_string = typename Lib::template unexpected<std::string>;
+
+    // Strings short enough for the small buffer: assignments measure the
+    // state transitions, not the allocator
+    template <class Lib>
+    expected_string<Lib> string_value() { return "value"; }
+
+    template <class Lib>
+    expected_string<Lib> string_error() { return unexpected_string<Lib>("error"); }
+
+    // Construction and destruction
+
+    template <class Lib>
+    void construct_value(State& state) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto x = static_cast<int>(i);
+            do_not_optimize(x);
+            expected_int<Lib> e(x);
+            do_not_optimize(e);
+        }
+    }
+
+    template <class Lib>
+    void construct_error(State& state) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto x = static_cast<int>(i);
+            do_not_optimize(x);
+            expected_int<Lib> e{unexpected_int<Lib>(x)};
+            do_not_optimize(e);
+        }
+    }
+
+    template <class Lib>
+    void construct_string_value(State& state) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto e = string_value<Lib>();
+            do_not_optimize(e);
+        }
+    }
+
+    template <class Lib>
+    void construct_string_error(State& state) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto e = string_error<Lib>();
+            do_not_optimize(e);
+        }
+    }
+
+    // Copy and move assignment, named after the state transition. The
+    // round trips do two assignments per iteration.
+
+    template <class Lib, bool Move>
+    void assign(State& state, bool from_value, bool to_value) {
+        auto dst = from_value ? string_value<Lib>() : string_error<Lib>();
+        auto src = to_value ? string_value<Lib>() : string_error<Lib>();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            do_not_optimize(src);
+            if constexpr (Move)
+                dst = std::move(src);
+            else
+                dst = src;
+            do_not_optimize(dst);
+        }
+    }
+
+    template <class Lib, bool Move>
+    void assign_round_trip(State& state) {
+        auto dst = string_value<Lib>();
+        auto value = string_value<Lib>();
+        auto error = string_error<Lib>();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            do_not_optimize(value);
+            do_not_optimize(error);
+            if constexpr (Move) {
+                dst = std::move(error);
+                do_not_optimize(dst);
+                dst = std::move(value);
+            } else {
+                dst = error;
+                do_not_optimize(dst);
+                dst = value;
+            }
+            do_not_optimize(dst);
+        }
+    }
+
+    template <class Lib>
+    void swap(State& state, bool a_value, bool b_value) {
+        auto a = a_value ? string_value<Lib>() : string_error<Lib>();
+        auto b = b_value ? string_value<Lib>() : string_error<Lib>();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            a.swap(b);
+            do_not_optimize(a);
+            do_not_optimize(b);
+        }
+    }
+
+    // Observers
+
+    template <class Lib>
+    void value(State& state) {
+        expected_int<Lib> e(1);
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            do_not_optimize(e);
+            auto x = e.value();
+            do_not_optimize(x);
+        }
+    }
+
+    template <class Lib>
+    void dereference(State& state) {
+        expected_int<Lib> e(1);
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            do_not_optimize(e);
+            auto x = *e;
+            do_not_optimize(x);
+        }
+    }
+
+    template <class Lib>
+    void value_or(State& state, bool has_value) {
+        auto e = has_value ? expected_int<Lib>(1) : expected_int<Lib>(unexpected_int<Lib>(2));
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            do_not_optimize(e);
+            auto x = e.value_or(3);
+            do_not_optimize(x);
+        }
+    }
+
+    // Monadic operations, on a value and on an error
+
+    template <class Lib, class F>
+    void monadic(State& state, bool has_value, F f) {
+        auto e = has_value ? expected_int<Lib>(1) : expected_int<Lib>(unexpected_int<Lib>(2));
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            do_not_optimize(e);
+            auto r = f(e);
+            do_not_optimize(r);
+        }
+    }
+
+    template <class Lib>
+    void and_then(State& state, bool has_value) {
+        monadic<Lib>(state, has_value, [](const expected_int<Lib>& e) {
+            return e.and_then([](int x) { return expected_int<Lib>(x + 1); });
+        });
+    }
+
+    template <class Lib>
+    void transform(State& state, bool has_value) {
+        monadic<Lib>(state, has_value, [](const expected_int<Lib>& e) {
+            return e.transform([](int x) { return x + 1; });
+        });
+    }
+
+    template <class Lib>
+    void or_else(State& state, bool has_value) {
+        monadic<Lib>(state, has_value, [](const expected_int<Lib>& e) {
+            return e.or_else([](int x) { return expected_int<Lib>(x + 1); });
+        });
+    }
+
+    template <class Lib>
+    void transform_error(State& state, bool has_value) {
+        monadic<Lib>(state, has_value, [](const expected_int<Lib>& e) {
+            return e.transform_error([](int x) { return x + 1; });
+        });
+    }
+
+    // Failure rates: three calls deep, the innermost one failing on the
+    // given percentage of a fixed set of inputs. Time is per outer call.
+
+    inline constexpr std::size_t input_count = 1024;
+
+    // Negative inputs fail. Which ones is scrambled so that the branch
+    // predictor can't learn the pattern.
+    inline std::vector<int> make_inputs(unsigned percent) {
+        std::vector<int> inputs(input_count);
+        for (std::size_t i = 0; i != input_count; ++i) {
+            const auto hash = static_cast<std::uint32_t>(i * 2654435761u) >> 16;
+            inputs[i] = hash % 100 < percent ? -1 - static_cast<int>(i) : static_cast<int>(i);
+        }
+        return inputs;
+    }
+
+    template <class Lib>
+    BENCH_NOINLINE expected_int<Lib> parse(int x) {
+        if (x < 0)
+            return unexpected_int<Lib>(x);
+        return x;
+    }
+
+    template <class Lib>
+    BENCH_NOINLINE expected_int<Lib> validate(int x) {
+        auto r = parse<Lib>(x);
+        if (!r)
+            return unexpected_int<Lib>(r.error());
+        return *r * 2;
+    }
+
+    template <class Lib>
+    BENCH_NOINLINE expected_int<Lib> process(int x) {
+        auto r = validate<Lib>(x);
+        if (!r)
+            return unexpected_int<Lib>(r.error());
+        return *r + 1;
+    }
+
+    template <class Lib>
+    void failure_rate(State& state, unsigned percent) {
+        const auto inputs = make_inputs(percent);
+        int sum = 0;
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto r = process<Lib>(inputs[i % input_count]);
+            sum += r ? *r : 1;
+        }
+        do_not_optimize(sum);
+    }
+
+} // namespace bench::suite
+
+#define EXPECTED_OPERATION_BENCHMARKS(impl, Lib)                                                                                            \
+    BENCHMARK("operations/construct/value/" impl, (bench::suite::construct_value<Lib>));                                                    \
+    BENCHMARK("operations/construct/error/" impl, (bench::suite::construct_error<Lib>));                                                    \
+    BENCHMARK("operations/construct/string_value/" impl, (bench::suite::construct_string_value<Lib>));                                      \
+    BENCHMARK("operations/construct/string_error/" impl, (bench::suite::construct_string_error<Lib>));                                      \
+    BENCHMARK("operations/copy_assign/value_to_value/" impl, ([](bench::State& s) { bench::suite::assign<Lib, false>(s, true, true); }));   \
+    BENCHMARK("operations/copy_assign/error_to_error/" impl, ([](bench::State& s) { bench::suite::assign<Lib, false>(s, false, false); })); \
+    BENCHMARK("operations/copy_assign/value_to_error_to_value/" impl, (bench::suite::assign_round_trip<Lib, false>));                       \
+    BENCHMARK("operations/move_assign/value_to_value/" impl, ([](bench::State& s) { bench::suite::assign<Lib, true>(s, true, true); }));    \
+    BENCHMARK("operations/move_assign/error_to_error/" impl, ([](bench::State& s) { bench::suite::assign<Lib, true>(s, false, false); }));  \
+    BENCHMARK("operations/move_assign/value_to_error_to_value/" impl, (bench::suite::assign_round_trip<Lib, true>));                        \
+    BENCHMARK("operations/swap/value_value/" impl, ([](bench::State& s) { bench::suite::swap<Lib>(s, true, true); }));                      \
+    BENCHMARK("operations/swap/error_error/" impl, ([](bench::State& s) { bench::suite::swap<Lib>(s, false, false); }));                    \
+    BENCHMARK("operations/swap/value_error/" impl, ([](bench::State& s) { bench::suite::swap<Lib>(s, true, false); }));                     \
+    BENCHMARK("operations/value/" impl, (bench::suite::value<Lib>));                                                                        \
+    BENCHMARK("operations/operator*/" impl, (bench::suite::dereference<Lib>));                                                              \
+    BENCHMARK("operations/value_or/value/" impl, ([](bench::State& s) { bench::suite::value_or<Lib>(s, true); }));                          \
+    BENCHMARK("operations/value_or/error/" impl, ([](bench::State& s) { bench::suite::value_or<Lib>(s, false); }))
+
+#define EXPECTED_MONADIC_BENCHMARKS(impl, Lib)                                                                                              \
+    BENCHMARK("operations/and_then/value/" impl, ([](bench::State& s) { bench::suite::and_then<Lib>(s, true); }));                          \
+    BENCHMARK("operations/and_then/error/" impl, ([](bench::State& s) { bench::suite::and_then<Lib>(s, false); }));                         \
+    BENCHMARK("operations/transform/value/" impl, ([](bench::State& s) { bench::suite::transform<Lib>(s, true); }));                        \
+    BENCHMARK("operations/transform/error/" impl, ([](bench::State& s) { bench::suite::transform<Lib>(s, false); }));                       \
+    BENCHMARK("operations/or_else/value/" impl, ([](bench::State& s) { bench::suite::or_else<Lib>(s, true); }));                            \
+    BENCHMARK("operations/or_else/error/" impl, ([](bench::State& s) { bench::suite::or_else<Lib>(s, false); }));                           \
+    BENCHMARK("operations/transform_error/value/" impl, ([](bench::State& s) { bench::suite::transform_error<Lib>(s, true); }));            \
+    BENCHMARK("operations/transform_error/error/" impl, ([](bench::State& s) { bench::suite::transform_error<Lib>(s, false); }))
+
+#define EXPECTED_FAILURE_RATE_BENCHMARKS(impl, Lib)                                                                                         \
+    BENCHMARK("failure_rate/0%/" impl, ([](bench::State& s) { bench::suite::failure_rate<Lib>(s, 0); }));                                   \
+    BENCHMARK("failure_rate/1%/" impl, ([](bench::State& s) { bench::suite::failure_rate<Lib>(s, 1); }));                                   \
+    BENCHMARK("failure_rate/10%/" impl, ([](bench::State& s) { bench::suite::failure_rate<Lib>(s, 10); }));                                 \
+    BENCHMARK("failure_rate/50%/" impl, ([](bench::State& s) { bench::suite::failure_rate<Lib>(s, 50); }))
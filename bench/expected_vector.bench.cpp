@@ -0,0 +1,108 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/expected_vector.hpp>
+#include "bench.hpp"
+#include <cstdint>
+#include <vector>
+
+// Numeric ingest: std::vector<expected<float, uint8_t>> (8 bytes per
+// element, values interleaved with errors) against expected_vector (values,
+// errors and a bitmap in separate arrays). One element in 1000 is an error.
+
+namespace {
+
+    constexpr std::size_t count = 16384;
+
+    using Result = std::expected<float, std::uint8_t>;
+
+    std::vector<Result> make_aos() {
+        std::vector<Result> v;
+        v.reserve(count);
+        for (std::size_t i = 0; i != count; ++i) {
+            if (i % 1000 == 999)
+                v.emplace_back(std::unexpect, std::uint8_t(1));
+            else
+                v.emplace_back(static_cast<float>(i));
+        }
+        return v;
+    }
+
+    kz::expected_vector<float, std::uint8_t> make_soa() {
+        kz::expected_vector<float, std::uint8_t> v;
+        v.reserve(count);
+        for (const auto& e : make_aos())
+            v.push_back(e);
+        return v;
+    }
+
+    void count_errors_aos(bench::State& state) {
+        const auto v = make_aos();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(v);
+            std::size_t errors = 0;
+            for (const auto& e : v)
+                errors += !e.has_value();
+            bench::do_not_optimize(errors);
+        }
+    }
+
+    void count_errors_soa(bench::State& state) {
+        const auto v = make_soa();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(v);
+            auto errors = v.count_errors();
+            bench::do_not_optimize(errors);
+        }
+    }
+
+    void transform_aos(bench::State& state) {
+        const auto v = make_aos();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            std::vector<Result> r;
+            r.reserve(v.size());
+            for (const auto& e : v)
+                r.push_back(e.transform([](float x) { return x * 2.0f + 1.0f; }));
+            bench::do_not_optimize(r);
+        }
+    }
+
+    void transform_soa(bench::State& state) {
+        const auto v = make_soa();
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            auto r = v.transform_values([](float x) { return x * 2.0f + 1.0f; });
+            bench::do_not_optimize(r);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("expected_vector/count_errors/vector<expected>", count_errors_aos);
+BENCHMARK("expected_vector/count_errors/expected_vector", count_errors_soa);
+BENCHMARK("expected_vector/transform/vector<expected>", transform_aos);
+BENCHMARK("expected_vector/transform/expected_vector", transform_soa);
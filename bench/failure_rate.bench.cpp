@@ -0,0 +1,124 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include "expected_suite.hpp"
+
+// Success and error paths mixed at 0%, 1%, 10% and 50% failure rates, three
+// calls deep: kz::expected against exceptions and plain error codes, doing
+// the same work. std_expected.bench.cpp adds std::expected.
+
+namespace {
+
+    struct kz_lib {
+        template <class T, class E>
+        using expected = kz::expected<T, E>;
+        template <class E>
+        using unexpected = kz::unexpected<E>;
+    };
+
+    // Error codes: 0 on success, the result in an output parameter
+
+    BENCH_NOINLINE int parse_code(int x, int& out) {
+        if (x < 0)
+            return x;
+        out = x;
+        return 0;
+    }
+
+    BENCH_NOINLINE int validate_code(int x, int& out) {
+        int value;
+        if (const auto error = parse_code(x, value))
+            return error;
+        out = value * 2;
+        return 0;
+    }
+
+    BENCH_NOINLINE int process_code(int x, int& out) {
+        int value;
+        if (const auto error = validate_code(x, value))
+            return error;
+        out = value + 1;
+        return 0;
+    }
+
+    void error_codes(bench::State& state, unsigned percent) {
+        const auto inputs = bench::suite::make_inputs(percent);
+        int sum = 0;
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            int value;
+            sum += process_code(inputs[i % bench::suite::input_count], value) ? 1 : value;
+        }
+        bench::do_not_optimize(sum);
+    }
+
+#if KZ_EXCEPTIONS
+
+    struct parse_error {
+        int code;
+    };
+
+    BENCH_NOINLINE int parse_throw(int x) {
+        if (x < 0)
+            throw parse_error{x};
+        return x;
+    }
+
+    BENCH_NOINLINE int validate_throw(int x) { return parse_throw(x) * 2; }
+
+    BENCH_NOINLINE int process_throw(int x) { return validate_throw(x) + 1; }
+
+    void exceptions(bench::State& state, unsigned percent) {
+        const auto inputs = bench::suite::make_inputs(percent);
+        int sum = 0;
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            try {
+                sum += process_throw(inputs[i % bench::suite::input_count]);
+            } catch (const parse_error&) {
+                sum += 1;
+            }
+        }
+        bench::do_not_optimize(sum);
+    }
+
+#endif
+
+} // namespace
+
+EXPECTED_FAILURE_RATE_BENCHMARKS("kz::expected", kz_lib);
+
+BENCHMARK("failure_rate/0%/error_code", [](bench::State& state) { error_codes(state, 0); });
+BENCHMARK("failure_rate/1%/error_code", [](bench::State& state) { error_codes(state, 1); });
+BENCHMARK("failure_rate/10%/error_code", [](bench::State& state) { error_codes(state, 10); });
+BENCHMARK("failure_rate/50%/error_code", [](bench::State& state) { error_codes(state, 50); });
+
+#if KZ_EXCEPTIONS
+BENCHMARK("failure_rate/0%/exceptions", [](bench::State& state) { exceptions(state, 0); });
+BENCHMARK("failure_rate/1%/exceptions", [](bench::State& state) { exceptions(state, 1); });
+BENCHMARK("failure_rate/10%/exceptions", [](bench::State& state) { exceptions(state, 10); });
+BENCHMARK("failure_rate/50%/exceptions", [](bench::State& state) { exceptions(state, 50); });
+#endif
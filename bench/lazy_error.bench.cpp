@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/lazy_error.hpp>
+#include "bench.hpp"
+#include <cstdio>
+#include <string>
+
+// Error-path throughput: every call fails with a formatted message. The
+// eager error formats it into a std::string up front; lazy_error captures
+// the arguments and formats only if asked. "code" callers only look at
+// the error code (retry, fall back), "message" callers also read the
+// message, so both variants format it there. Time is per call.
+
+namespace {
+
+    enum class errc { ok, out_of_range };
+
+    struct EagerError {
+        errc code;
+        std::string message;
+    };
+
+    using LazyError = kz::lazy_error<errc, int, int, int>;
+
+    BENCH_NOINLINE std::expected<int, EagerError> check_eager(int value, int lo, int hi) {
+        if (value < lo || value > hi) {
+            char message[64];
+            std::snprintf(message, sizeof(message), "value %d out of range [%d, %d]", value, lo, hi);
+            return std::unexpected(EagerError{errc::out_of_range, message});
+        }
+        return value;
+    }
+
+    BENCH_NOINLINE std::expected<int, LazyError> check_lazy(int value, int lo, int hi) {
+        if (value < lo || value > hi)
+            return std::unexpected(kz::lazy_error(errc::out_of_range, "value %d out of range [%d, %d]", value, lo, hi));
+        return value;
+    }
+
+    errc code(const EagerError& e) { return e.code; }
+    errc code(const LazyError& e) { return e.code(); }
+
+    std::size_t message_size(const EagerError& e) { return e.message.size(); }
+    std::size_t message_size(const LazyError& e) { return e.message().size(); }
+
+    template <bool ReadMessage, class Check>
+    void run(bench::State& state, Check check) {
+        std::size_t out_of_range = 0;
+        for (std::size_t i = 0; i < state.iterations(); ++i) {
+            auto r = check(1000 + static_cast<int>(i & 0xff), 0, 999);
+            if (!r && code(r.error()) == errc::out_of_range) {
+                ++out_of_range;
+                if constexpr (ReadMessage)
+                    out_of_range += message_size(r.error());
+            }
+            bench::do_not_optimize(r);
+        }
+        bench::do_not_optimize(out_of_range);
+    }
+
+    void eager_code(bench::State& state) { run<false>(state, check_eager); }
+    void lazy_code(bench::State& state) { run<false>(state, check_lazy); }
+    void eager_message(bench::State& state) { run<true>(state, check_eager); }
+    void lazy_message(bench::State& state) { run<true>(state, check_lazy); }
+
+} // namespace
+
+BENCHMARK("lazy_error/code/eager", eager_code);
+BENCHMARK("lazy_error/code/lazy", lazy_code);
+BENCHMARK("lazy_error/message/eager", eager_message);
+BENCHMARK("lazy_error/message/lazy", lazy_message);
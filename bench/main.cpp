@@ -0,0 +1,164 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    constexpr auto min_duration = std::chrono::milliseconds(20);
+    constexpr int repetitions = 5;
+
+    double run(bench::Function function, std::size_t iterations) {
+        bench::State state(iterations);
+        const auto start = clock_type::now();
+        function(state);
+        const auto stop = clock_type::now();
+        return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+
+    bool is_option(const char* arg) {
+        return std::strncmp(arg, "--", 2) == 0;
+    }
+
+    bool selected(const char* name, int argc, char** argv) {
+        bool filtered = false;
+        for (int i = 1; i != argc; ++i) {
+            if (is_option(argv[i])) {
+                continue;
+            }
+            if (std::strstr(name, argv[i])) {
+                return true;
+            }
+            filtered = true;
+        }
+        return !filtered;
+    }
+
+    const char* compiler() {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc";
+#else
+        return "unknown";
+#endif
+    }
+
+    // Benchmark names are plain ASCII, but quotes and backslashes would break the JSON
+    void print_json_string(const char* s) {
+        std::putchar('"');
+        for (; *s; ++s) {
+            if (*s == '"' || *s == '\\') {
+                std::putchar('\\');
+            }
+            std::putchar(*s);
+        }
+        std::putchar('"');
+    }
+
+    void print_json_header() {
+        char date[32];
+        const auto now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        std::printf("{\n  \"context\": {\n");
+        std::printf("    \"date\": \"%s\",\n", date);
+        std::printf("    \"compiler\": ");
+        print_json_string(compiler());
+        std::printf(",\n    \"repetitions\": %d\n  },\n  \"benchmarks\": [", repetitions);
+    }
+
+} // namespace
+
+// Usage: expected-bench [--json] [filter...]
+//
+// --json prints the results as JSON instead of a table, to keep track of
+// them from one commit to the next. Times are in nanoseconds per operation:
+// the median of the repetitions, and the fastest and slowest ones.
+int main(int argc, char** argv) {
+    bool json = false;
+    for (int i = 1; i != argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (is_option(argv[i])) {
+            std::fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (json) {
+        print_json_header();
+    } else {
+        std::printf("%-64s %12s %12s\n", "benchmark", "ns/op", "iterations");
+    }
+
+    const char* separator = "\n";
+
+    for (const auto& benchmark : bench::registry()) {
+        if (!selected(benchmark.name, argc, argv)) {
+            continue;
+        }
+
+        // Calibrate: grow the iteration count until a run is long enough
+        std::size_t iterations = 1;
+        while (run(benchmark.function, iterations) < std::chrono::duration<double, std::nano>(min_duration).count()) {
+            iterations *= 2;
+        }
+
+        double samples[repetitions];
+        for (auto& sample : samples) {
+            sample = run(benchmark.function, iterations) / static_cast<double>(iterations);
+        }
+        std::sort(std::begin(samples), std::end(samples));
+
+        if (json) {
+            std::printf("%s    {\"name\": ", separator);
+            print_json_string(benchmark.name);
+            std::printf(", \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f, \"iterations\": %zu}",
+                        samples[repetitions / 2], samples[0], samples[repetitions - 1], iterations);
+            separator = ",\n";
+        } else {
+            std::printf("%-64s %12.2f %12zu\n", benchmark.name, samples[repetitions / 2], iterations);
+        }
+        std::fflush(stdout);
+    }
+
+    if (json) {
+        std::printf("\n  ]\n}\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/pipeline.hpp>
+#include "bench.hpp"
+#include <string>
+#include <vector>
+
+// Eight-stage chain with a large error: member calls materialize an expected
+// per stage, a pipeline materializes only the result.
+
+namespace {
+
+    struct Diagnostic {
+        std::string message;
+        std::string file;
+        int line;
+        int column;
+        std::vector<std::string> context;
+    };
+
+    using Result = std::expected<int, Diagnostic>;
+
+    BENCH_NOINLINE Result check(int x) {
+        if (x < 0) {
+            return std::unexpected(Diagnostic{"negative value in a long enough message", "input.txt", 1, x, {"in expression"}});
+        }
+        return x;
+    }
+
+    const auto step = [](int x) { return x + 1; };
+    const auto next = [](int x) { return check(x); };
+
+    void members(bench::State& state, int x) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(x);
+            auto r = check(x)
+                .and_then(next).transform(step)
+                .and_then(next).transform(step)
+                .and_then(next).transform(step)
+                .and_then(next).transform(step);
+            bench::do_not_optimize(r);
+        }
+    }
+
+    void pipeline(bench::State& state, int x) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(x);
+            Result r = kz::pipe(check(x))
+                | kz::and_then(next) | kz::transform(step)
+                | kz::and_then(next) | kz::transform(step)
+                | kz::and_then(next) | kz::transform(step)
+                | kz::and_then(next) | kz::transform(step);
+            bench::do_not_optimize(r);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("pipeline/success/members", [](bench::State& state) { members(state, 1); });
+BENCHMARK("pipeline/success/pipeline", [](bench::State& state) { pipeline(state, 1); });
+BENCHMARK("pipeline/failure/members", [](bench::State& state) { members(state, -1); });
+BENCHMARK("pipeline/failure/pipeline", [](bench::State& state) { pipeline(state, -1); });
@@ -0,0 +1,59 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// The same benchmarks as expected.bench.cpp and failure_rate.bench.cpp, for
+// the standard library's std::expected. This file is compiled as C++23 and
+// without the include path of this library, so that <expected> is the
+// standard header. It registers nothing when the standard library has no
+// std::expected.
+
+#include <version>
+
+#if defined(__cpp_lib_expected)
+
+#include <expected>
+#include "expected_suite.hpp"
+
+namespace {
+
+    struct std_lib {
+        template <class T, class E>
+        using expected = std::expected<T, E>;
+        template <class E>
+        using unexpected = std::unexpected<E>;
+    };
+
+} // namespace
+
+EXPECTED_OPERATION_BENCHMARKS("std::expected", std_lib);
+EXPECTED_FAILURE_RATE_BENCHMARKS("std::expected", std_lib);
+
+#if __cpp_lib_expected >= 202211L
+EXPECTED_MONADIC_BENCHMARKS("std::expected", std_lib);
+#endif
+
+#endif
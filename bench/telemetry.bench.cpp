@@ -0,0 +1,70 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include "bench.hpp"
+
+// Error path with and without error telemetry. This file is built twice:
+// into expected-bench, and into expected-bench-telemetry with
+// KZ_EXPECTED_TELEMETRY=1. Every call fails. Time is per call.
+
+#if KZ_EXPECTED_TELEMETRY
+#define TELEMETRY_BENCHMARK(name, function) BENCHMARK("telemetry/on/" name, function)
+#else
+#define TELEMETRY_BENCHMARK(name, function) BENCHMARK("telemetry/off/" name, function)
+#endif
+
+namespace {
+
+    enum class errc { ok, invalid, timeout };
+
+    BENCH_NOINLINE std::expected<int, errc> parse(int value) {
+        if (value >= 0)
+            return std::unexpected(value & 1 ? errc::invalid : errc::timeout);
+        return value;
+    }
+
+    BENCH_NOINLINE std::expected<long, int> fail(int value) {
+        if (value >= 0)
+            return std::unexpected(value);
+        return value;
+    }
+
+    void enum_errors(bench::State& state) {
+        for (std::size_t i = 0; i < state.iterations(); ++i)
+            bench::do_not_optimize(parse(static_cast<int>(i & 0xffff)));
+    }
+
+    void int_errors(bench::State& state) {
+        for (std::size_t i = 0; i < state.iterations(); ++i)
+            bench::do_not_optimize(fail(static_cast<int>(i & 0xffff)));
+    }
+
+} // namespace
+
+TELEMETRY_BENCHMARK("enum", enum_errors);
+TELEMETRY_BENCHMARK("int", int_errors);
@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/try.hpp>
+#include "bench.hpp"
+#include <string>
+
+// Four propagation steps with a std::string error: KZ_TRY_ASSIGN against the
+// equivalent and_then() chain and the hand-written early return.
+
+namespace {
+
+    using Result = std::expected<int, std::string>;
+
+    BENCH_NOINLINE Result step(int x) {
+        if (x < 0) {
+            return std::unexpected(std::string("negative value in a long enough message"));
+        }
+        return x + 1;
+    }
+
+    BENCH_NOINLINE Result with_try(int x) {
+        KZ_TRY_ASSIGN(auto a, step(x));
+        KZ_TRY_ASSIGN(auto b, step(a));
+        KZ_TRY_ASSIGN(auto c, step(b));
+        KZ_TRY_ASSIGN(auto d, step(c));
+        return d * 2;
+    }
+
+    BENCH_NOINLINE Result with_and_then(int x) {
+        return step(x)
+            .and_then([](int a) { return step(a); })
+            .and_then([](int b) { return step(b); })
+            .and_then([](int c) { return step(c); })
+            .transform([](int d) { return d * 2; });
+    }
+
+    BENCH_NOINLINE Result by_hand(int x) {
+        auto a = step(x);
+        if (!a) return std::unexpected(std::move(a.error()));
+        auto b = step(*a);
+        if (!b) return std::unexpected(std::move(b.error()));
+        auto c = step(*b);
+        if (!c) return std::unexpected(std::move(c.error()));
+        auto d = step(*c);
+        if (!d) return std::unexpected(std::move(d.error()));
+        return *d * 2;
+    }
+
+    template <Result (*F)(int)>
+    void run(bench::State& state, int x) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(x);
+            auto r = F(x);
+            bench::do_not_optimize(r);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("try/success/KZ_TRY_ASSIGN", [](bench::State& state) { run<with_try>(state, 1); });
+BENCHMARK("try/success/and_then", [](bench::State& state) { run<with_and_then>(state, 1); });
+BENCHMARK("try/success/by_hand", [](bench::State& state) { run<by_hand>(state, 1); });
+BENCHMARK("try/failure/KZ_TRY_ASSIGN", [](bench::State& state) { run<with_try>(state, -1); });
+BENCHMARK("try/failure/and_then", [](bench::State& state) { run<with_and_then>(state, -1); });
+BENCHMARK("try/failure/by_hand", [](bench::State& state) { run<by_hand>(state, -1); });
@@ -0,0 +1,69 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include "bench.hpp"
+#include <string>
+
+// Success path cost of a std::string fallback: value_or() builds it on every
+// call, value_or_else() only when there is an error.
+
+namespace {
+
+    BENCH_NOINLINE std::expected<std::string, int> lookup(int key) {
+        if (key < 0) {
+            return std::unexpected(key);
+        }
+        return std::string("short");
+    }
+
+    BENCH_NOINLINE std::string make_fallback() {
+        return std::string("a default value that does not fit in the small buffer");
+    }
+
+    void value_or(bench::State& state, int key) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(key);
+            auto r = lookup(key).value_or(make_fallback());
+            bench::do_not_optimize(r);
+        }
+    }
+
+    void value_or_else(bench::State& state, int key) {
+        for (std::size_t i = 0; i != state.iterations(); ++i) {
+            bench::do_not_optimize(key);
+            auto r = lookup(key).value_or_else(make_fallback);
+            bench::do_not_optimize(r);
+        }
+    }
+
+} // namespace
+
+BENCHMARK("value_or/success/value_or", [](bench::State& state) { value_or(state, 1); });
+BENCHMARK("value_or/success/value_or_else", [](bench::State& state) { value_or_else(state, 1); });
+BENCHMARK("value_or/failure/value_or", [](bench::State& state) { value_or(state, -1); });
+BENCHMARK("value_or/failure/value_or_else", [](bench::State& state) { value_or_else(state, -1); });
@@ -0,0 +1,426 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ranges>
+#include <type_traits>
+#include <kz/expected_bits/expected.hpp>
+
+// SIMD kernels, selected at runtime between AVX2 and SSE2. Define as 0 to
+// only use the portable scalar loops.
+#if !defined(KZ_BATCH_SIMD)
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define KZ_BATCH_SIMD 1
+#else
+#define KZ_BATCH_SIMD 0
+#endif
+#endif
+
+#if KZ_BATCH_SIMD
+#define KZ_BATCH_AVX2 __attribute__((target("avx2")))
+#define KZ_BATCH_INLINE __attribute__((always_inline)) inline
+#endif
+
+namespace kz {
+
+    /*
+        Batch operations over contiguous arrays of expected<T, E>:
+
+            std::vector<kz::expected<float, Status>> samples = read();
+
+            if (kz::batch::any_error(samples))
+                report(samples[kz::batch::first_error_index(samples)].error());
+            float total = kz::batch::sum_values(samples);
+
+        For arithmetic T of 4 or 8 bytes and a trivially copyable E no larger
+        than T, the has_value() flags of several elements are loaded at once
+        as a mask and combined with the values, without branches, using AVX2
+        when the processor supports it and SSE2 otherwise. Other types,
+        other compilers, builds with KZ_BATCH_SIMD set to 0 and builds with
+        KZ_EXPECTED_TRACK_ORIGIN use scalar loops.
+    */
+
+    namespace batch {
+
+        // Kernels passed explicitly must be supported: at most selected_isa()
+        enum class isa { scalar, sse2, avx2 };
+
+        // The kernels used by this process
+        inline isa selected_isa() noexcept {
+#if KZ_BATCH_SIMD
+            static const isa value = __builtin_cpu_supports("avx2") ? isa::avx2 : isa::sse2;
+            return value;
+#else
+            return isa::scalar;
+#endif
+        }
+
+        namespace detail {
+
+            template <class R>
+            using element_t = std::remove_cv_t<std::ranges::range_value_t<R>>;
+
+            template <class R>
+            inline constexpr bool is_expected_range_v =
+                std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+                kz::detail::is_specialization<element_t<R>, expected>::value;
+
+            // Size in bytes of the value of an expected<T, E> that the SIMD
+            // kernels can process, 0 if they can't. The element must be the
+            // value (which the error overlaps) followed by the flag, padded to
+            // twice the size of the value. With origin tracking, the origin
+            // id sits in the flag's padding, which the kernels overwrite.
+            template <class X, class T = typename X::value_type, class E = typename X::error_type>
+            inline constexpr std::size_t lane_size_v =
+                (!KZ_EXPECTED_TRACK_ORIGIN && std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+                 (sizeof(T) == 4 || sizeof(T) == 8) &&
+                 std::is_trivially_copyable_v<E> && sizeof(E) <= sizeof(T) &&
+                 !kz::detail::is_niche_value_v<T, E> &&
+                 std::is_standard_layout_v<X> && sizeof(X) == 2 * sizeof(T))
+                    ? sizeof(T) : 0;
+
+            template <class X>
+            std::size_t first_error_scalar(const X* in, std::size_t begin, std::size_t end) noexcept {
+                for (std::size_t i = begin; i != end; ++i)
+                    if (!in[i].has_value())
+                        return i;
+                return end;
+            }
+
+            template <class X>
+            auto sum_scalar(const X* in, std::size_t begin, std::size_t end) noexcept {
+                typename X::value_type sum{};
+                for (std::size_t i = begin; i != end; ++i)
+                    sum += in[i].has_value() ? *in[i] : typename X::value_type{};
+                return sum;
+            }
+
+#if KZ_BATCH_SIMD
+            /*
+                The kernels are written once with the GCC / clang vector
+                extensions, for registers of Bytes bytes, and inlined into
+                functions compiled for AVX2 (32 bytes) and for SSE2 (16
+                bytes).
+
+                Each step loads the elements covering two registers and
+                splits them into a register of values and a register that
+                is all ones in the lanes of the elements holding an error.
+            */
+            template <std::size_t Bytes, std::size_t Lane>
+            struct simd {
+                using lane_type = std::conditional_t<Lane == 4, std::int32_t, std::int64_t>;
+                using reg [[gnu::vector_size(Bytes)]] = lane_type;
+                static constexpr std::size_t lanes = Bytes / Lane;
+
+                template <class T>
+                using reg_of [[gnu::vector_size(Bytes)]] = T;
+
+                // Elements per step: each one takes two lanes
+                static constexpr std::size_t step = lanes;
+            };
+
+            template <std::size_t Bytes, std::size_t Lane, class X>
+            KZ_BATCH_INLINE void load(const X* in, typename simd<Bytes, Lane>::reg& values, typename simd<Bytes, Lane>::reg& errors) noexcept {
+                using reg = typename simd<Bytes, Lane>::reg;
+                reg a, b;
+                std::memcpy(&a, in, Bytes);
+                std::memcpy(&b, reinterpret_cast<const unsigned char*>(in) + Bytes, Bytes);
+                if constexpr (simd<Bytes, Lane>::lanes == 2) {
+                    values = __builtin_shufflevector(a, b, 0, 2);
+                    errors = __builtin_shufflevector(a, b, 1, 3);
+                } else if constexpr (simd<Bytes, Lane>::lanes == 4) {
+                    values = __builtin_shufflevector(a, b, 0, 2, 4, 6);
+                    errors = __builtin_shufflevector(a, b, 1, 3, 5, 7);
+                } else {
+                    values = __builtin_shufflevector(a, b, 0, 2, 4, 6, 8, 10, 12, 14);
+                    errors = __builtin_shufflevector(a, b, 1, 3, 5, 7, 9, 11, 13, 15);
+                }
+                // Only the low byte of the flag lane is the bool, the rest is padding
+                errors = (errors & 0xFF) == 0;
+            }
+
+            template <class Reg>
+            KZ_BATCH_INLINE bool none(const Reg& r) noexcept {
+                std::uint64_t words[sizeof(Reg) / 8];
+                std::memcpy(words, &r, sizeof(Reg));
+                std::uint64_t any = 0;
+                for (const std::uint64_t word : words)
+                    any |= word;
+                return any == 0;
+            }
+
+            // Index of the first element holding an error, n if there is none
+            template <std::size_t Bytes, class X>
+            KZ_BATCH_INLINE std::size_t first_error_simd(const X* in, std::size_t n) noexcept {
+                constexpr std::size_t lane = lane_size_v<X>;
+                constexpr std::size_t step = simd<Bytes, lane>::step;
+                constexpr std::size_t unroll = 4;
+                typename simd<Bytes, lane>::reg values, errors;
+
+                std::size_t i = 0;
+                for (; i + step * unroll <= n; i += step * unroll) {
+                    typename simd<Bytes, lane>::reg any{};
+                    for (std::size_t u = 0; u != unroll; ++u) {
+                        load<Bytes, lane>(in + i + u * step, values, errors);
+                        any |= errors;
+                    }
+                    if (KZ_UNLIKELY(!none(any)))
+                        return first_error_scalar(in, i, i + step * unroll);
+                }
+                for (; i + step <= n; i += step) {
+                    load<Bytes, lane>(in + i, values, errors);
+                    if (KZ_UNLIKELY(!none(errors)))
+                        return first_error_scalar(in, i, i + step);
+                }
+                return first_error_scalar(in, i, n);
+            }
+
+            template <std::size_t Bytes, class X>
+            KZ_BATCH_INLINE auto sum_simd(const X* in, std::size_t n) noexcept {
+                using T = typename X::value_type;
+                constexpr std::size_t lane = lane_size_v<X>;
+                constexpr std::size_t step = simd<Bytes, lane>::step;
+                using sum_reg = typename simd<Bytes, lane>::template reg_of<T>;
+                typename simd<Bytes, lane>::reg values, errors;
+
+                // Two accumulators to hide the latency of the additions
+                sum_reg sum0{};
+                sum_reg sum1{};
+                std::size_t i = 0;
+                for (; i + 2 * step <= n; i += 2 * step) {
+                    load<Bytes, lane>(in + i, values, errors);
+                    sum0 += reinterpret_cast<sum_reg>(values & ~errors);
+                    load<Bytes, lane>(in + i + step, values, errors);
+                    sum1 += reinterpret_cast<sum_reg>(values & ~errors);
+                }
+                for (; i + step <= n; i += step) {
+                    load<Bytes, lane>(in + i, values, errors);
+                    sum0 += reinterpret_cast<sum_reg>(values & ~errors);
+                }
+
+                sum0 += sum1;
+                T sum = sum_scalar(in, i, n);
+                for (std::size_t j = 0; j != step; ++j)
+                    sum += sum0[j];
+                return sum;
+            }
+
+            template <class X>
+            KZ_BATCH_AVX2 std::size_t first_error_avx2(const X* in, std::size_t n) noexcept { return first_error_simd<32>(in, n); }
+
+            template <class X>
+            std::size_t first_error_sse2(const X* in, std::size_t n) noexcept { return first_error_simd<16>(in, n); }
+
+            template <class X>
+            KZ_BATCH_AVX2 auto sum_avx2(const X* in, std::size_t n) noexcept { return sum_simd<32>(in, n); }
+
+            template <class X>
+            auto sum_sse2(const X* in, std::size_t n) noexcept { return sum_simd<16>(in, n); }
+#endif
+
+            template <class X>
+            std::size_t first_error_index(const X* in, std::size_t n, isa kernels) noexcept {
+#if KZ_BATCH_SIMD
+                if constexpr (lane_size_v<X> != 0) {
+                    if (kernels == isa::avx2)
+                        return first_error_avx2(in, n);
+                    if (kernels == isa::sse2)
+                        return first_error_sse2(in, n);
+                }
+#endif
+                (void)kernels;
+                return first_error_scalar(in, 0, n);
+            }
+
+            template <class X>
+            auto sum_values(const X* in, std::size_t n, isa kernels) noexcept {
+#if KZ_BATCH_SIMD
+                if constexpr (lane_size_v<X> != 0) {
+                    if (kernels == isa::avx2)
+                        return sum_avx2(in, n);
+                    if (kernels == isa::sse2)
+                        return sum_sse2(in, n);
+                }
+#endif
+                (void)kernels;
+                return sum_scalar(in, 0, n);
+            }
+
+            template <class X, class Y, class F>
+            void transform_scalar(const X* in, Y* out, std::size_t begin, std::size_t end, F& f) {
+                for (std::size_t i = begin; i != end; ++i) {
+                    if (in[i].has_value())
+                        kz::detail::construct_at(out + i, std::in_place, f(*in[i]));
+                    else
+                        kz::detail::construct_at(out + i, kz::detail::unexpect_from(in[i]), in[i].error());
+                }
+            }
+
+#if KZ_BATCH_SIMD
+            /*
+                f is applied to every lane of values, whatever the state of
+                the elements: the lanes of elements holding an error are
+                replaced with fill first, so that f never gets the bits of
+                an error. The results are then blended with the errors:
+                the lane of an element holding an error keeps the bits of
+                the error. The flags are rebuilt and the elements written
+                back interleaved. The value and the error of an output
+                element must fit in the same lane as the input's.
+            */
+            template <std::size_t Bytes, class X, class Y, class F>
+            KZ_BATCH_INLINE void transform_simd(const X* in, Y* out, std::size_t n, F& f, const typename X::value_type& fill) {
+                using T = typename X::value_type;
+                using U = typename Y::value_type;
+                constexpr std::size_t lane = lane_size_v<X>;
+                using reg = typename simd<Bytes, lane>::reg;
+                using value_reg = typename simd<Bytes, lane>::template reg_of<T>;
+                using result_reg = typename simd<Bytes, lane>::template reg_of<U>;
+                constexpr std::size_t step = simd<Bytes, lane>::step;
+                reg values, errors;
+                value_reg fills;
+                for (std::size_t j = 0; j != step; ++j)
+                    fills[j] = fill;
+
+                std::size_t i = 0;
+                for (; i + step <= n; i += step) {
+                    load<Bytes, lane>(in + i, values, errors);
+                    const value_reg x = reinterpret_cast<value_reg>((values & ~errors) | (errors & reinterpret_cast<reg>(fills)));
+                    result_reg y;
+                    for (std::size_t j = 0; j != step; ++j)
+                        y[j] = static_cast<U>(f(x[j]));
+
+                    const reg blended = (errors & values) | (~errors & reinterpret_cast<reg>(y));
+                    const reg flags = ~errors & 1;
+                    reg low, high;
+                    if constexpr (step == 2) {
+                        low = __builtin_shufflevector(blended, flags, 0, 2);
+                        high = __builtin_shufflevector(blended, flags, 1, 3);
+                    } else if constexpr (step == 4) {
+                        low = __builtin_shufflevector(blended, flags, 0, 4, 1, 5);
+                        high = __builtin_shufflevector(blended, flags, 2, 6, 3, 7);
+                    } else {
+                        low = __builtin_shufflevector(blended, flags, 0, 8, 1, 9, 2, 10, 3, 11);
+                        high = __builtin_shufflevector(blended, flags, 4, 12, 5, 13, 6, 14, 7, 15);
+                    }
+                    std::memcpy(static_cast<void*>(out + i), &low, Bytes);
+                    std::memcpy(static_cast<void*>(out + i + step / 2), &high, Bytes);
+                }
+                transform_scalar(in, out, i, n, f);
+            }
+
+            template <class X, class Y, class F>
+            KZ_BATCH_AVX2 void transform_avx2(const X* in, Y* out, std::size_t n, F& f, const typename X::value_type& fill) {
+                transform_simd<32>(in, out, n, f, fill);
+            }
+
+            template <class X, class Y, class F>
+            void transform_sse2(const X* in, Y* out, std::size_t n, F& f, const typename X::value_type& fill) {
+                transform_simd<16>(in, out, n, f, fill);
+            }
+#endif
+
+            template <class X, class Y, class F>
+            void transform(const X* in, Y* out, std::size_t n, F& f, const typename X::value_type& fill, isa kernels) {
+#if KZ_BATCH_SIMD
+                if constexpr (lane_size_v<X> != 0 && lane_size_v<Y> == lane_size_v<X>) {
+                    if (kernels == isa::avx2)
+                        return transform_avx2(in, out, n, f, fill);
+                    if (kernels == isa::sse2)
+                        return transform_sse2(in, out, n, f, fill);
+                }
+#endif
+                (void)fill;
+                (void)kernels;
+                transform_scalar(in, out, 0, n, f);
+            }
+
+        } // namespace detail
+
+        // Index of the first element holding an error, or the size of the range
+        template <class R>
+        requires(detail::is_expected_range_v<R>)
+        std::size_t first_error_index(const R& in, isa kernels = selected_isa()) noexcept {
+            return detail::first_error_index(std::ranges::data(in), std::ranges::size(in), kernels);
+        }
+
+        template <class R>
+        requires(detail::is_expected_range_v<R>)
+        bool any_error(const R& in, isa kernels = selected_isa()) noexcept {
+            return first_error_index(in, kernels) != std::ranges::size(in);
+        }
+
+        // Sum of the values, skipping errors. Floating point values are not
+        // added in order.
+        template <class R>
+        requires(detail::is_expected_range_v<R> && std::is_arithmetic_v<typename detail::element_t<R>::value_type>)
+        auto sum_values(const R& in, isa kernels = selected_isa()) noexcept {
+            return detail::sum_values(std::ranges::data(in), std::ranges::size(in), kernels);
+        }
+
+        /*
+            out[i] = in[i].transform(f), for out at least as large as in.
+            Both must hold trivially copyable types. f must be free of side
+            effects and defined for T{}: it is also called with T{} in place
+            of the elements holding an error, and the results discarded.
+            Where it is not, as with 100 / x, pass a value that it is
+            defined for as fill. Pass a lambda or a function object rather
+            than a function pointer so that f is inlined and vectorized.
+        */
+        template <class R, class O, class F>
+        requires(detail::is_expected_range_v<R> && detail::is_expected_range_v<O> &&
+                 std::is_trivially_copyable_v<detail::element_t<R>> &&
+                 std::is_trivially_copyable_v<detail::element_t<O>> &&
+                 std::is_same_v<typename detail::element_t<R>::error_type, typename detail::element_t<O>::error_type> &&
+                 std::is_convertible_v<std::invoke_result_t<F&, const typename detail::element_t<R>::value_type&>,
+                                       typename detail::element_t<O>::value_type>)
+        void transform(const R& in, O&& out, F f, const typename detail::element_t<R>::value_type& fill,
+                       isa kernels = selected_isa()) {
+            assert(std::ranges::size(out) >= std::ranges::size(in));
+            detail::transform(std::ranges::data(in), std::ranges::data(out), std::ranges::size(in), f, fill, kernels);
+        }
+
+        template <class R, class O, class F>
+        requires(detail::is_expected_range_v<R> && detail::is_expected_range_v<O> &&
+                 std::is_trivially_copyable_v<detail::element_t<R>> &&
+                 std::is_trivially_copyable_v<detail::element_t<O>> &&
+                 std::is_same_v<typename detail::element_t<R>::error_type, typename detail::element_t<O>::error_type> &&
+                 std::is_convertible_v<std::invoke_result_t<F&, const typename detail::element_t<R>::value_type&>,
+                                       typename detail::element_t<O>::value_type>)
+        void transform(const R& in, O&& out, F f, isa kernels = selected_isa()) {
+            assert(std::ranges::size(out) >= std::ranges::size(in));
+            detail::transform(std::ranges::data(in), std::ranges::data(out), std::ranges::size(in), f,
+                              typename detail::element_t<R>::value_type{}, kernels);
+        }
+
+    } // namespace batch
+
+} // namespace kz
@@ -0,0 +1,229 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <kz/expected_bits/exception.hpp>
+#include <kz/expected_bits/relocate.hpp>
+#include <kz/expected_bits/unexpected.hpp>
+
+namespace kz {
+
+    namespace detail {
+
+        // Per-thread cache of fixed-size blocks. Blocks freed on another thread
+        // than the one that allocated them simply join that thread's cache.
+        template <std::size_t Size, std::size_t Align>
+        class box_pool {
+            struct node {
+                node* next;
+            };
+
+        public:
+            static constexpr std::size_t block_size = Size < sizeof(node) ? sizeof(node) : Size;
+            static constexpr std::size_t block_align = Align < alignof(node) ? alignof(node) : Align;
+            static constexpr std::size_t max_cached = 64;
+
+            static void* allocate() {
+                if (KZ_UNLIKELY(_closed))
+                    return ::operator new(block_size, std::align_val_t(block_align));
+                guard();
+                if (node* n = _head) {
+                    _head = n->next;
+                    --_count;
+                    return n;
+                }
+                return ::operator new(block_size, std::align_val_t(block_align));
+            }
+
+            static void deallocate(void* p) noexcept {
+                if (!_closed)
+                    guard();
+                if (!_closed && _count < max_cached) {
+                    _head = ::new (p) node{_head};
+                    ++_count;
+                } else {
+                    ::operator delete(p, std::align_val_t(block_align));
+                }
+            }
+
+        private:
+            // Releases the cache on thread exit and closes the pool: blocks
+            // allocated or freed after that go straight to the heap, without
+            // touching the destroyed releaser again.
+            struct releaser {
+                ~releaser() {
+                    _closed = true;
+                    while (node* n = _head) {
+                        _head = n->next;
+                        ::operator delete(n, std::align_val_t(block_align));
+                    }
+                }
+            };
+
+            static void guard() {
+                thread_local releaser r;
+                (void)r;
+            }
+
+            // Trivial types: they remain usable while other thread_local
+            // objects are being destroyed.
+            static inline thread_local node* _head = nullptr;
+            static inline thread_local std::size_t _count = 0;
+            static inline thread_local bool _closed = false;
+        };
+
+    } // namespace detail
+
+    /*
+        boxed_error
+
+        Holds an error out-of-line, in a block taken from a per-thread pool.
+        Use it as the error type of expected<> when E is large: the inline
+        footprint of expected<T, boxed_error<E>> is that of expected<T, E*>,
+        so the success path no longer moves a big object around.
+
+        A moved-from boxed_error is empty and may only be destroyed or
+        assigned to.
+    */
+
+    template <class E>
+    class boxed_error {
+        using pool = detail::box_pool<sizeof(E), alignof(E)>;
+
+    public:
+        using value_type = E;
+
+        // Constructors
+        template <class... Args>
+        explicit boxed_error(in_place_t, Args&&... args)
+        requires(std::is_constructible_v<E, Args...>)
+            : _error(make(std::forward<Args>(args)...)) {}
+
+        boxed_error(const E& e)
+        requires(std::is_copy_constructible_v<E>)
+            : _error(make(e)) {}
+
+        boxed_error(E&& e)
+        requires(std::is_move_constructible_v<E>)
+            : _error(make(std::move(e))) {}
+
+        boxed_error(const boxed_error& rhs)
+        requires(std::is_copy_constructible_v<E>)
+            : _error(rhs._error ? make(*rhs._error) : nullptr) {}
+
+        boxed_error(boxed_error&& rhs) noexcept : _error(std::exchange(rhs._error, nullptr)) {}
+
+        // Destructor
+        ~boxed_error() { release(); }
+
+        // Assignment
+        boxed_error& operator=(const boxed_error& rhs)
+        requires(std::is_copy_constructible_v<E>) {
+            if (this != &rhs) {
+                E* error = rhs._error ? make(*rhs._error) : nullptr;
+                release();
+                _error = error;
+            }
+            return *this;
+        }
+
+        boxed_error& operator=(boxed_error&& rhs) noexcept {
+            if (this != &rhs) {
+                release();
+                _error = std::exchange(rhs._error, nullptr);
+            }
+            return *this;
+        }
+
+        // Swap
+        void swap(boxed_error& other) noexcept {
+            std::swap(_error, other._error);
+        }
+
+        friend void swap(boxed_error& x, boxed_error& y) noexcept {
+            x.swap(y);
+        }
+
+        // Observers
+        const E& operator*() const noexcept  { return *_error; }
+        E&       operator*() noexcept        { return *_error; }
+        const E* operator->() const noexcept { return _error; }
+        E*       operator->() noexcept       { return _error; }
+        const E& get() const noexcept        { return *_error; }
+        E&       get() noexcept              { return *_error; }
+
+        // Moved-from (empty) boxes are only equal to each other
+        friend bool operator==(const boxed_error& x, const boxed_error& y) {
+            if (!x._error || !y._error)
+                return x._error == y._error;
+            return static_cast<bool>(*x == *y);
+        }
+
+        friend bool operator==(const boxed_error& x, const E& e) {
+            return x._error && static_cast<bool>(*x == e);
+        }
+
+    private:
+        template <class... Args>
+        static E* make(Args&&... args) {
+            void* p = pool::allocate();
+#if KZ_EXCEPTIONS
+            try {
+                return ::new (p) E(std::forward<Args>(args)...);
+            } catch (...) {
+                pool::deallocate(p);
+                throw;
+            }
+#else
+            return ::new (p) E(std::forward<Args>(args)...);
+#endif
+        }
+
+        void release() noexcept {
+            if (_error) {
+                std::destroy_at(_error);
+                pool::deallocate(_error);
+                _error = nullptr;
+            }
+        }
+
+        E* _error;
+    };
+
+    template <class E>
+    boxed_error(E) -> boxed_error<E>;
+
+    template <class E>
+    struct is_trivially_relocatable<boxed_error<E>> : std::true_type {};
+
+} // namespace kz
@@ -0,0 +1,237 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <kz/expected_bits/expected.hpp>
+#include <kz/expected_bits/pipeline.hpp>
+
+#if !defined(KZ_CACHE_LINE_SIZE)
+#define KZ_CACHE_LINE_SIZE 64
+#endif
+
+namespace kz {
+
+    /*
+        result_channel
+
+        One-shot, single-producer single-consumer handoff of an
+        expected<T, E> between threads:
+
+            kz::result_channel<Config, Error> channel;
+            auto future = channel.get_future() | kz::transform(validate);
+
+            pool.post([&] { channel.set_value(load()); });
+            ...
+            auto config = std::move(future).get();
+
+        The expected is stored inline, in the same cache line as the state
+        when it fits, and nothing is allocated. The producer publishes with
+        a single atomic exchange and only wakes the consumer up when it is
+        actually blocked. The channel must outlive both the producer's call
+        to set_*() and the consumer's call to get().
+    */
+
+    template <class T, class E, class... Stages>
+    class future_expected;
+
+    template <class T, class E>
+    class alignas(KZ_CACHE_LINE_SIZE) result_channel {
+    public:
+        using result_type = expected<T, E>;
+
+        result_channel() noexcept {}
+
+        result_channel(const result_channel&) = delete;
+        result_channel& operator=(const result_channel&) = delete;
+
+        ~result_channel() {
+            if (_state.load(std::memory_order_acquire) == state_ready)
+                detail::destroy_at(std::addressof(_result));
+        }
+
+        // The consumer side. Call once.
+        future_expected<T, E> get_future() noexcept {
+            return future_expected<T, E>(*this, std::tuple<>());
+        }
+
+        // Producer side: construct the expected in place and publish it. Call once.
+        template <class... Args>
+        requires(std::is_constructible_v<expected<T, E>, Args...>)
+        void emplace(Args&&... args) {
+            detail::construct_at(std::addressof(_result), std::forward<Args>(args)...);
+            int state = state_empty;
+            if (KZ_UNLIKELY(!_state.compare_exchange_strong(state, state_ready, std::memory_order_acq_rel)))
+                notify();
+        }
+
+        template <class... Args>
+        void set_value(Args&&... args) {
+            emplace(std::in_place, std::forward<Args>(args)...);
+        }
+
+        template <class... Args>
+        void set_error(Args&&... args) {
+            emplace(unexpect, std::forward<Args>(args)...);
+        }
+
+        bool ready() const noexcept {
+            return _state.load(std::memory_order_acquire) == state_ready;
+        }
+
+        // Block until the result is published
+        result_type& wait() noexcept {
+            if (KZ_UNLIKELY(!ready()))
+                wait_slow();
+            return _result;
+        }
+
+    private:
+        // The consumer can destroy the channel as soon as it sees
+        // state_ready: a producer that has to wake it up goes through
+        // state_notifying so that it is done with the channel by then.
+        enum : int { state_empty, state_waiting, state_notifying, state_ready };
+
+        KZ_COLD void wait_slow() noexcept {
+            // Spin a little first: the producer is often about to publish.
+            // Then give the producer a chance to run in case it shares the
+            // core, and only then block.
+            for (int i = 0; i != 32; ++i) {
+                if (ready())
+                    return;
+                pause();
+            }
+            for (int i = 0; i != 8; ++i) {
+                if (ready())
+                    return;
+                std::this_thread::yield();
+            }
+
+            int state = state_empty;
+            if (!_state.compare_exchange_strong(state, state_waiting, std::memory_order_acq_rel) && state == state_ready)
+                return;
+#if __cpp_lib_atomic_wait
+            _state.wait(state_waiting, std::memory_order_acquire);
+#endif
+            while (!ready())
+                std::this_thread::yield();
+        }
+
+        // The consumer is blocked (or about to be) in wait_slow()
+        KZ_COLD void notify() noexcept {
+            _state.store(state_notifying, std::memory_order_release);
+#if __cpp_lib_atomic_wait
+            _state.notify_one();
+#endif
+            _state.store(state_ready, std::memory_order_release);
+        }
+
+        static void pause() noexcept {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+            __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+
+        template <class, class, class...>
+        friend class future_expected;
+
+        std::atomic<int> _state{state_empty};
+        union {
+            expected<T, E> _result;
+        };
+    };
+
+    /*
+        future_expected
+
+        Consumer side of a result_channel. Appending and_then(), transform(),
+        transform_error() or or_else() stages with operator| returns a new
+        future: the stages run, as a pipeline, on the thread that calls
+        get(). Movable, but get() may only be called once.
+    */
+
+    template <class T, class E, class... Stages>
+    class future_expected {
+    public:
+        using result_type = typename pipeline<expected<T, E>, Stages...>::result_type;
+
+        future_expected(future_expected&& rhs) noexcept
+            : _channel(std::exchange(rhs._channel, nullptr)), _stages(std::move(rhs._stages)) {}
+
+        future_expected& operator=(future_expected&& rhs) noexcept {
+            _channel = std::exchange(rhs._channel, nullptr);
+            _stages = std::move(rhs._stages);
+            return *this;
+        }
+
+        bool valid() const noexcept { return _channel != nullptr; }
+        bool ready() const noexcept { return _channel->ready(); }
+        void wait() const noexcept { _channel->wait(); }
+
+        // Block until the result is published, then run the stages on it
+        result_type get() && {
+            result_channel<T, E>* channel = std::exchange(_channel, nullptr);
+            return pipeline<expected<T, E>, Stages...>(std::move(channel->wait()), std::move(_stages)).run();
+        }
+
+        template <class Stage>
+        requires(detail::is_pipe_stage_v<std::remove_cvref_t<Stage>>)
+        friend auto operator|(future_expected&& f, Stage&& stage) {
+            return std::move(f).append(std::forward<Stage>(stage));
+        }
+
+    private:
+        template <class, class>
+        friend class result_channel;
+
+        template <class, class, class...>
+        friend class future_expected;
+
+        future_expected(result_channel<T, E>& channel, std::tuple<Stages...>&& stages)
+            : _channel(&channel), _stages(std::move(stages)) {}
+
+        template <class Stage>
+        future_expected<T, E, Stages..., std::remove_cvref_t<Stage>> append(Stage&& stage) && {
+            return future_expected<T, E, Stages..., std::remove_cvref_t<Stage>>(
+                *std::exchange(_channel, nullptr),
+                std::tuple_cat(std::move(_stages), std::tuple<std::remove_cvref_t<Stage>>(std::forward<Stage>(stage))));
+        }
+
+        result_channel<T, E>* _channel;
+        std::tuple<Stages...> _stages;
+    };
+
+} // namespace kz
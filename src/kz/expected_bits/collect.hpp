@@ -0,0 +1,361 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <kz/expected_bits/expected.hpp>
+
+namespace kz {
+
+    namespace detail {
+
+        template <class R>
+        using range_expected_t = std::remove_cvref_t<std::ranges::range_reference_t<R>>;
+
+        template <class X>
+        inline constexpr bool is_expected_v = is_specialization<std::remove_cvref_t<X>, expected>::value;
+
+        // expected<vector<T>, E>, or expected<void, E> for a range of expected<void, E>
+        template <class T, class E>
+        using collect_result_t = expected<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>, E>;
+
+        // Elements of an owning range passed as an rvalue, or yielded by
+        // value, are moved from. Elements seen through a view are not.
+        template <class R>
+        inline constexpr bool collect_moves_v =
+            !std::is_lvalue_reference_v<std::ranges::range_reference_t<R>> ||
+            (!std::is_lvalue_reference_v<R> && !std::ranges::view<std::remove_cvref_t<R>>);
+
+    } // namespace detail
+
+    /*
+        collect
+
+        Turn a range of expected<T, E> into an expected<std::vector<T>, E>
+        holding either all the values, in order, or the first error:
+
+            std::vector<kz::expected<Row, Error>> rows = fetch_all(ids);
+            kz::expected<std::vector<Row>, Error> table = kz::collect(std::move(rows));
+
+        The vector is allocated once when the size of the range is known
+        and iteration stops at the first error.
+    */
+
+    template <std::ranges::input_range R>
+    requires(detail::is_expected_v<std::ranges::range_reference_t<R>>)
+    auto collect(R&& range) {
+        using source_type = detail::range_expected_t<R>;
+        using T = typename source_type::value_type;
+        using E = typename source_type::error_type;
+        using result_type = detail::collect_result_t<T, E>;
+
+        if constexpr (std::is_void_v<T>) {
+            for (auto&& e : range) {
+                if (KZ_UNLIKELY(!e.has_value())) {
+                    if constexpr (detail::collect_moves_v<R>)
+                        return result_type(detail::unexpect_from(e), std::move(e).error());
+                    else
+                        return result_type(detail::unexpect_from(e), e.error());
+                }
+            }
+            return result_type();
+        } else {
+            std::vector<T> values;
+            if constexpr (std::ranges::sized_range<R> || std::ranges::forward_range<R>)
+                values.reserve(static_cast<std::size_t>(std::ranges::distance(range)));
+
+            for (auto&& e : range) {
+                if (KZ_UNLIKELY(!e.has_value())) {
+                    if constexpr (detail::collect_moves_v<R>)
+                        return result_type(detail::unexpect_from(e), std::move(e).error());
+                    else
+                        return result_type(detail::unexpect_from(e), e.error());
+                }
+                if constexpr (detail::collect_moves_v<R>)
+                    values.emplace_back(*std::move(e));
+                else
+                    values.emplace_back(*e);
+            }
+            return result_type(std::in_place, std::move(values));
+        }
+    }
+
+    namespace detail {
+
+        /*
+            Items of a parallel_transform_collect() are claimed in chunks
+            from a shared counter by the calling thread and by the tasks
+            handed to the executor. A task that only starts once the call
+            has returned finds nothing left to claim and never touches the
+            caller's frame: this block is the only thing it uses, hence the
+            shared ownership.
+        */
+        class parallel_work {
+        public:
+            using process_function = void (*)(void* context, parallel_work& work, std::size_t begin, std::size_t end);
+
+            parallel_work(std::size_t size, std::size_t grain, process_function process, void* context) noexcept
+                : _remaining(size), _size(size), _grain(grain), _process(process), _context(context) {}
+
+            parallel_work(const parallel_work&) = delete;
+            parallel_work& operator=(const parallel_work&) = delete;
+
+            // Claim and process chunks until there are none left
+            void run() noexcept {
+                for (;;) {
+                    const std::size_t begin = _next.fetch_add(_grain, std::memory_order_relaxed);
+                    if (begin >= _size)
+                        return;
+                    const std::size_t end = std::min(begin + _grain, _size);
+                    _process(_context, *this, begin, end);
+                    finish(end - begin);
+                }
+            }
+
+            // Drop the items nobody has claimed yet. Claims are handed out
+            // in order, so these all come after the ones being processed.
+            void cancel() noexcept {
+                const std::size_t claimed = _next.exchange(_size, std::memory_order_relaxed);
+                if (claimed < _size)
+                    finish(_size - claimed);
+            }
+
+            // Block until every item is either processed or cancelled
+            void wait() noexcept {
+                for (;;) {
+                    const std::size_t remaining = _remaining.load(std::memory_order_acquire);
+                    if (remaining == 0)
+                        return;
+#if __cpp_lib_atomic_wait
+                    _remaining.wait(remaining, std::memory_order_acquire);
+#else
+                    std::this_thread::yield();
+#endif
+                }
+            }
+
+        private:
+            void finish(std::size_t count) noexcept {
+                if (_remaining.fetch_sub(count, std::memory_order_acq_rel) == count) {
+#if __cpp_lib_atomic_wait
+                    _remaining.notify_all();
+#endif
+                }
+            }
+
+            std::atomic<std::size_t> _next{0};
+            std::atomic<std::size_t> _remaining;
+            const std::size_t _size;
+            const std::size_t _grain;
+            const process_function _process;
+            void* const _context;
+        };
+
+        // Where the values are stored until all the items are done (nothing is
+        // stored for void)
+        template <class T>
+        using collect_slot_t = std::optional<std::conditional_t<std::is_void_v<T>, char, T>>;
+
+        // Lives in the caller's frame: only reached through claimed items
+        template <class Iterator, class F, class T, class E>
+        class parallel_collect {
+        public:
+            parallel_collect(Iterator first, F& f, collect_slot_t<T>* slots, std::size_t size) noexcept
+                : _first(first), _f(f), _slots(slots), _failed_at(size), _error_index(size) {}
+
+            static void process(void* context, parallel_work& work, std::size_t begin, std::size_t end) noexcept {
+                auto& self = *static_cast<parallel_collect*>(context);
+                for (std::size_t i = begin; i != end; ++i) {
+                    // Items after a failure are not needed anymore
+                    if (i > self._failed_at.load(std::memory_order_relaxed))
+                        return;
+#if KZ_EXCEPTIONS
+                    try {
+#endif
+                        auto&& r = std::invoke(self._f, self._first[static_cast<std::iter_difference_t<Iterator>>(i)]);
+                        if (KZ_LIKELY(r.has_value())) {
+                            if constexpr (!std::is_void_v<T>)
+                                self._slots[i].emplace(*std::forward<decltype(r)>(r));
+                        } else {
+                            self.fail(work, i, [&](std::optional<E>& error) {
+                                self._error_tag = kz::detail::unexpect_from(r);
+                                error.emplace(std::forward<decltype(r)>(r).error());
+                            });
+                        }
+#if KZ_EXCEPTIONS
+                    } catch (...) {
+                        self.fail(work, i, [&](std::optional<E>& error) {
+                            error.reset();
+                            self._exception = std::current_exception();
+                        });
+                    }
+#endif
+                }
+            }
+
+            // Valid once the work is done: the error of the first item that failed
+            std::optional<E>& error() noexcept { return _error; }
+            unexpect_t error_tag() const noexcept { return _error_tag; }
+
+#if KZ_EXCEPTIONS
+            std::exception_ptr& exception() noexcept { return _exception; }
+#endif
+
+        private:
+            // Keep the failure with the lowest index, so that the outcome is
+            // the same as a sequential transform followed by collect()
+            template <class Record>
+            KZ_COLD void fail(parallel_work& work, std::size_t index, Record&& record) noexcept {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (index < _error_index) {
+                        _error_index = index;
+#if KZ_EXCEPTIONS
+                        _exception = nullptr;
+#endif
+                        record(_error);
+                        _failed_at.store(index, std::memory_order_relaxed);
+                    }
+                }
+                work.cancel();
+            }
+
+            const Iterator _first;
+            F& _f;
+            collect_slot_t<T>* const _slots;
+            std::atomic<std::size_t> _failed_at;
+            std::mutex _mutex;
+            std::size_t _error_index;
+            std::optional<E> _error;
+            unexpect_t _error_tag; // Carries the origin of _error
+#if KZ_EXCEPTIONS
+            std::exception_ptr _exception;
+#endif
+        };
+
+        template <class Executor>
+        std::size_t executor_concurrency(Executor& executor) {
+            if constexpr (requires { executor.concurrency(); }) {
+                return static_cast<std::size_t>(executor.concurrency());
+            } else {
+                return std::thread::hardware_concurrency();
+            }
+        }
+
+    } // namespace detail
+
+    /*
+        parallel_transform_collect
+
+        Apply f, which returns an expected, to every item of a random access
+        range on an executor and collect the values:
+
+            kz::expected<std::vector<Image>, Error> images =
+                kz::parallel_transform_collect(paths, decode, pool);
+
+        The result is the same as collect()-ing the transform() of every
+        item in order, but as soon as an item fails the items after it that
+        have not started yet are cancelled.
+
+        The executor is anything with an execute(task) member that runs the
+        nullary task once, on any thread. The calling thread takes part in
+        the work: nothing needs to be run by the executor for the call to
+        complete, so it is safe to call from a task of the same pool. The
+        number of threads involved, the caller included, is concurrency()
+        if the executor has such a member, hardware_concurrency() otherwise.
+
+        f is called concurrently with lvalues of the range's elements. If it
+        throws, the exception is rethrown by the caller (unless an item
+        before it failed).
+    */
+
+    template <std::ranges::random_access_range R, class F, class Executor>
+    requires(std::ranges::sized_range<R> && detail::is_expected_v<std::invoke_result_t<F&, std::ranges::range_reference_t<R>>>)
+    auto parallel_transform_collect(R&& range, F&& f, Executor&& executor) {
+        using source_type = std::remove_cvref_t<std::invoke_result_t<F&, std::ranges::range_reference_t<R>>>;
+        using T = typename source_type::value_type;
+        using E = typename source_type::error_type;
+        using result_type = detail::collect_result_t<T, E>;
+        using slot_type = detail::collect_slot_t<T>;
+        using context_type = detail::parallel_collect<std::ranges::iterator_t<R>, std::remove_reference_t<F>, T, E>;
+
+        const std::size_t size = static_cast<std::size_t>(std::ranges::size(range));
+        std::vector<slot_type> slots(std::is_void_v<T> ? 0 : size);
+        context_type context(std::ranges::begin(range), f, slots.data(), size);
+
+        if (size != 0) {
+            const std::size_t workers = std::clamp<std::size_t>(detail::executor_concurrency(executor), 1, size);
+            const std::size_t grain = std::max<std::size_t>(1, size / (workers * 8));
+            const auto work = std::make_shared<detail::parallel_work>(size, grain, &context_type::process, &context);
+
+#if KZ_EXCEPTIONS
+            try {
+#endif
+                for (std::size_t i = 1; i != workers; ++i)
+                    executor.execute([work] { work->run(); });
+#if KZ_EXCEPTIONS
+            } catch (...) {
+                work->run();
+                work->wait();
+                throw;
+            }
+#endif
+            work->run();
+            work->wait();
+        }
+
+#if KZ_EXCEPTIONS
+        if (KZ_UNLIKELY(context.exception()))
+            std::rethrow_exception(context.exception());
+#endif
+        if (KZ_UNLIKELY(context.error()))
+            return result_type(context.error_tag(), std::move(*context.error()));
+
+        if constexpr (std::is_void_v<T>) {
+            return result_type();
+        } else {
+            std::vector<T> values;
+            values.reserve(size);
+            for (auto& slot : slots)
+                values.emplace_back(std::move(*slot));
+            return result_type(std::in_place, std::move(values));
+        }
+    }
+
+} // namespace kz
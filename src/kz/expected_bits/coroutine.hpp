@@ -0,0 +1,403 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+// The object returned by get_return_object() must be converted to the
+// return type only once the coroutine returns to its caller (see
+// expected_return). The standard leaves the timing unspecified: GCC and clang
+// defer the conversion, except LLVM 15 (Apple clang 14) which converts right
+// away. Other compilers are not known to defer it, define
+// KZ_EXPECTED_COROUTINES to 1 to try them anyway.
+#if defined(__apple_build_version__)
+#define KZ_COROUTINE_DEFERRED_RETURN (__clang_major__ != 14)
+#elif defined(__clang__)
+#define KZ_COROUTINE_DEFERRED_RETURN (__clang_major__ != 15)
+#elif defined(__GNUC__)
+#define KZ_COROUTINE_DEFERRED_RETURN 1
+#else
+#define KZ_COROUTINE_DEFERRED_RETURN 0
+#endif
+
+#if !defined(KZ_EXPECTED_COROUTINES)
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>) && KZ_COROUTINE_DEFERRED_RETURN
+#define KZ_EXPECTED_COROUTINES 1
+#else
+#define KZ_EXPECTED_COROUTINES 0
+#endif
+#endif
+
+#if KZ_EXPECTED_COROUTINES
+
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <kz/expected_bits/exception.hpp>
+#include <kz/expected_bits/expected.hpp>
+#include <kz/expected_bits/try.hpp>
+
+/*
+    Coroutines returning expected:
+
+        kz::expected<Config, Error> load(const char* path) {
+            auto text = co_await read_file(path);   // returns the error of read_file() if any
+            co_await validate(text);                // expected<void, Error>
+            if (text.empty())
+                co_await kz::unexpected(Error::Empty);  // returns this error
+            co_return parse(text);
+        }
+
+    These coroutines never suspend: they run to completion, or stop at the
+    first error, before returning to the caller. Their frames are therefore
+    strictly nested, which allows the following allocation strategy:
+
+    - The promise does not let the coroutine handle escape, so compilers
+      that implement heap allocation elision (clang) can put the frame on
+      the caller's stack when the coroutine is inlined.
+    - Otherwise the frame comes from a per-thread stack of frames (64 KiB),
+      and from the heap only when that stack is full.
+    - A coroutine whose first two parameters are std::allocator_arg_t and an
+      allocator gets its frame from that allocator instead.
+*/
+
+namespace kz {
+    namespace detail {
+
+        // Per-thread stack of coroutine frames
+        class frame_arena {
+        public:
+            static constexpr std::size_t chunk_size = 64 * 1024;
+
+            // Returns nullptr if the frame doesn't fit
+            static void* allocate(std::size_t size) noexcept {
+                guard();
+                if (!_top) {
+                    if (_released)
+                        return nullptr;
+                    _top = static_cast<std::byte*>(::operator new(chunk_size, std::nothrow));
+                    if (!_top)
+                        return nullptr;
+                    _begin = _top;
+                }
+                if (size > static_cast<std::size_t>(_begin + chunk_size - _top))
+                    return nullptr;
+                return std::exchange(_top, _top + size);
+            }
+
+            // Frames are strictly nested, so blocks are freed in the reverse
+            // order of their allocation: the one freed is always on top.
+            static void deallocate(void* block, std::size_t size) noexcept {
+                assert(!_begin || static_cast<std::byte*>(block) + size == _top);
+                if (static_cast<std::byte*>(block) + size == _top)
+                    _top = static_cast<std::byte*>(block);
+            }
+
+        private:
+            // Releases the chunk on thread exit. Later frames come from the heap.
+            struct releaser {
+                ~releaser() {
+                    ::operator delete(_begin);
+                    _begin = _top = nullptr;
+                    _released = true;
+                }
+            };
+
+            static void guard() {
+                thread_local releaser r;
+                (void)r;
+            }
+
+            // Trivial types: they remain usable while other thread_local
+            // objects are being destroyed.
+            static inline thread_local std::byte* _begin = nullptr;
+            static inline thread_local std::byte* _top = nullptr;
+            static inline thread_local bool _released = false;
+        };
+
+        // Allocation of coroutine frames. Each frame is preceded by a header
+        // that knows how to release it.
+        class frame_allocation {
+            using release_fn = void (*)(std::byte* block, std::size_t size) noexcept;
+
+            static constexpr std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+            static constexpr std::size_t header_size = (sizeof(release_fn) + alignment - 1) & ~(alignment - 1);
+
+            struct alignas(alignment) unit {
+                std::byte bytes[alignment];
+            };
+
+            static constexpr std::size_t round_up(std::size_t size) noexcept {
+                return (size + alignment - 1) & ~(alignment - 1);
+            }
+
+            static void* frame(std::byte* block, release_fn release) noexcept {
+                ::new (block) release_fn(release);
+                return block + header_size;
+            }
+
+            static void release_arena(std::byte* block, std::size_t size) noexcept {
+                frame_arena::deallocate(block, round_up(header_size + size));
+            }
+
+            static void release_heap(std::byte* block, std::size_t) noexcept {
+                ::operator delete(block);
+            }
+
+            // The allocator is stored after the frame
+            template <class Alloc>
+            static void release_allocator(std::byte* block, std::size_t size) noexcept {
+                const std::size_t units = round_up(header_size + size) / alignment;
+                Alloc* stored = std::launder(reinterpret_cast<Alloc*>(block + units * alignment));
+                Alloc alloc(std::move(*stored));
+                stored->~Alloc();
+                std::allocator_traits<Alloc>::deallocate(
+                    alloc, reinterpret_cast<unit*>(block), units + (sizeof(Alloc) + alignment - 1) / alignment);
+            }
+
+        public:
+            static void* allocate(std::size_t size) {
+                const std::size_t total = round_up(header_size + size);
+                if (void* block = frame_arena::allocate(total))
+                    return frame(static_cast<std::byte*>(block), &release_arena);
+                return frame(static_cast<std::byte*>(::operator new(total)), &release_heap);
+            }
+
+            template <class Allocator>
+            static void* allocate(std::size_t size, const Allocator& allocator) {
+                using Alloc = typename std::allocator_traits<Allocator>::template rebind_alloc<unit>;
+                static_assert(alignof(Alloc) <= alignment, "over-aligned allocators are not supported");
+
+                Alloc alloc(allocator);
+                const std::size_t units = round_up(header_size + size) / alignment;
+                std::byte* block = reinterpret_cast<std::byte*>(std::allocator_traits<Alloc>::allocate(
+                    alloc, units + (sizeof(Alloc) + alignment - 1) / alignment));
+                ::new (block + units * alignment) Alloc(std::move(alloc));
+                return frame(block, &release_allocator<Alloc>);
+            }
+
+            static void deallocate(void* p, std::size_t size) noexcept {
+                std::byte* block = static_cast<std::byte*>(p) - header_size;
+                release_fn release = *std::launder(reinterpret_cast<release_fn*>(block));
+                release(block, size);
+            }
+        };
+
+        template <class T, class E>
+        class expected_promise_base;
+
+        // Returned by get_return_object(). The result of the coroutine is
+        // stored here and converted to expected<T, E> once the coroutine is
+        // done. This relies on the compiler deferring the conversion until
+        // the coroutine returns to its caller (KZ_COROUTINE_DEFERRED_RETURN):
+        // converting right away would read the result before it exists.
+        template <class T, class E>
+        class expected_return {
+        public:
+            explicit expected_return(expected_promise_base<T, E>& promise) noexcept {
+                promise._result = this;
+            }
+
+            expected_return(const expected_return&) = delete;
+            expected_return& operator=(const expected_return&) = delete;
+
+            ~expected_return() {
+                if (_has_result)
+                    detail::destroy_at(std::addressof(_result));
+            }
+
+            operator expected<T, E>() && {
+                assert(_has_result);
+                return std::move(_result);
+            }
+
+            template <class... Args>
+            void emplace(Args&&... args) {
+                detail::construct_at(std::addressof(_result), std::forward<Args>(args)...);
+                _has_result = true;
+            }
+
+        private:
+            union {
+                expected<T, E> _result;
+            };
+            bool _has_result = false;
+        };
+
+        template <class T, class E>
+        class expected_promise_base {
+        public:
+            expected_return<T, E> get_return_object() noexcept {
+                return expected_return<T, E>(*this);
+            }
+
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+
+            void unhandled_exception() const {
+#if KZ_EXCEPTIONS
+                throw;
+#else
+                std::terminate();
+#endif
+            }
+
+            // Short-circuits on error
+            template <class R>
+            struct awaiter {
+                R&& _expected;
+
+                bool await_ready() const noexcept {
+                    return _expected.has_value();
+                }
+
+                template <class Promise>
+                void await_suspend(std::coroutine_handle<Promise> handle) {
+                    handle.promise()._result->emplace(detail::unexpect_from(_expected), std::forward<R>(_expected).error());
+                    handle.destroy();
+                }
+
+                decltype(auto) await_resume() const noexcept {
+                    return detail::try_value(std::forward<R>(_expected));
+                }
+            };
+
+            template <class R>
+            requires(is_specialization<std::remove_cvref_t<R>, expected>::value)
+            awaiter<R> await_transform(R&& e) noexcept {
+                return awaiter<R>{std::forward<R>(e)};
+            }
+
+            // co_await unexpected(e) always returns the error
+            template <class G>
+            struct unexpected_awaiter {
+                G&& _error;
+                unexpect_t _tag; // Carries the origin of the unexpected
+
+                bool await_ready() const noexcept { return false; }
+
+                template <class Promise>
+                void await_suspend(std::coroutine_handle<Promise> handle) {
+                    handle.promise()._result->emplace(_tag, std::forward<G>(_error));
+                    handle.destroy();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            template <class G>
+            unexpected_awaiter<G&&> await_transform(unexpected<G>&& e) noexcept {
+                return {std::move(e).value(), detail::unexpect_from(e)};
+            }
+
+            template <class G>
+            unexpected_awaiter<const G&> await_transform(const unexpected<G>& e) noexcept {
+                return {e.value(), detail::unexpect_from(e)};
+            }
+
+            static void* operator new(std::size_t size) {
+                return frame_allocation::allocate(size);
+            }
+
+            static void operator delete(void* p, std::size_t size) noexcept {
+                frame_allocation::deallocate(p, size);
+            }
+
+        protected:
+            friend class expected_return<T, E>;
+
+            expected_return<T, E>* _result = nullptr;
+        };
+
+        template <class T, class E>
+        class expected_promise : public expected_promise_base<T, E> {
+        public:
+            template <class U = T>
+            requires(std::is_constructible_v<expected<T, E>, U>)
+            void return_value(U&& v) {
+                this->_result->emplace(std::forward<U>(v));
+            }
+        };
+
+        template <class T, class E>
+        requires(std::is_void_v<T>)
+        class expected_promise<T, E> : public expected_promise_base<T, E> {
+        public:
+            void return_void() {
+                this->_result->emplace();
+            }
+        };
+
+        // Frames of coroutines taking (std::allocator_arg_t, Allocator, Args...)
+        template <class T, class E, class Allocator, class... Args>
+        class expected_allocator_promise : public expected_promise<T, E> {
+        public:
+            static void* operator new(std::size_t size, std::allocator_arg_t, const Allocator& allocator, const Args&...) {
+                return frame_allocation::allocate(size, allocator);
+            }
+
+            static void operator delete(void* p, std::size_t size) noexcept {
+                frame_allocation::deallocate(p, size);
+            }
+        };
+
+        // Same for member functions, which get the object first
+        template <class T, class E, class This, class Allocator, class... Args>
+        class expected_member_allocator_promise : public expected_promise<T, E> {
+        public:
+            static void* operator new(std::size_t size, const This&, std::allocator_arg_t, const Allocator& allocator, const Args&...) {
+                return frame_allocation::allocate(size, allocator);
+            }
+
+            static void operator delete(void* p, std::size_t size) noexcept {
+                frame_allocation::deallocate(p, size);
+            }
+        };
+
+    } // namespace detail
+} // namespace kz
+
+template <class T, class E, class... Args>
+struct std::coroutine_traits<kz::expected<T, E>, Args...> {
+    using promise_type = kz::detail::expected_promise<T, E>;
+};
+
+template <class T, class E, class Allocator, class... Args>
+struct std::coroutine_traits<kz::expected<T, E>, std::allocator_arg_t, Allocator, Args...> {
+    using promise_type = kz::detail::expected_allocator_promise<T, E, std::remove_cvref_t<Allocator>, Args...>;
+};
+
+template <class T, class E, class This, class Allocator, class... Args>
+struct std::coroutine_traits<kz::expected<T, E>, This, std::allocator_arg_t, Allocator, Args...> {
+    using promise_type = kz::detail::expected_member_allocator_promise<T, E, std::remove_cvref_t<This>, std::remove_cvref_t<Allocator>, Args...>;
+};
+
+#endif
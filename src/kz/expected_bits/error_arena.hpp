@@ -0,0 +1,377 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <kz/expected_bits/exception.hpp>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define KZ_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define KZ_PRINTF_FORMAT(fmt, args)
+#endif
+
+namespace kz {
+
+    /*
+        error_arena
+
+        Per-thread bump allocator for error payloads. Allocating is bumping
+        a pointer, nothing is freed individually: memory is reclaimed in
+        bulk by rewinding the arena at the end of a scope.
+
+            for (const auto& request : batch) {
+                kz::error_arena::scope scope;
+                auto r = validate(request);     // errors live in the arena
+                if (!r)
+                    log(r.error().message());
+            }                                   // and are released here
+
+        The first blocks live in the arena itself; when it needs more, it
+        takes blocks from the heap and keeps them for reuse after rewinding.
+        Once warmed up, the error path does not touch the heap anymore.
+    */
+
+    class error_arena {
+        struct alignas(std::max_align_t) block {
+            block* next;
+            std::size_t size;   // usable bytes after the header
+
+            std::byte* data() noexcept { return reinterpret_cast<std::byte*>(this + 1); }
+        };
+
+    public:
+        static constexpr std::size_t inline_size = 4096;
+
+        // A position in the arena to rewind to
+        struct marker {
+            block* current;
+            std::size_t used;
+        };
+
+        error_arena() noexcept {
+            _first.header = {nullptr, sizeof(_first.storage)};
+            _current = &_first.header;
+        }
+
+        error_arena(const error_arena&) = delete;
+        error_arena& operator=(const error_arena&) = delete;
+
+        ~error_arena() {
+            block* b = _first.header.next;
+            while (b) {
+                block* next = b->next;
+                ::operator delete(b);
+                b = next;
+            }
+        }
+
+        // The arena of the calling thread
+        static error_arena& current() noexcept {
+            thread_local error_arena arena;
+            return arena;
+        }
+
+        // align is a power of two, at most alignof(std::max_align_t)
+        void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+            std::size_t offset = (_used + align - 1) & ~(align - 1);
+            if (KZ_UNLIKELY(offset + size > _current->size)) {
+                next_block(size + align);
+                offset = 0;
+            }
+            _used = offset + size;
+            return _current->data() + offset;
+        }
+
+        // Copy of a string in the arena
+        std::string_view copy(std::string_view s) {
+            char* p = static_cast<char*>(allocate(s.size(), 1));
+            if (!s.empty())
+                std::memcpy(p, s.data(), s.size());
+            return std::string_view(p, s.size());
+        }
+
+        // printf-style formatting into the arena
+        KZ_PRINTF_FORMAT(2, 3) std::string_view format(const char* fmt, ...) {
+            va_list args;
+            va_start(args, fmt);
+            const std::string_view s = vformat(fmt, args);
+            va_end(args);
+            return s;
+        }
+
+        std::string_view vformat(const char* fmt, va_list args) {
+            // Format straight into what is left of the current block, and
+            // again in a new block only if it doesn't fit.
+            va_list retry;
+            va_copy(retry, args);
+            char* p = reinterpret_cast<char*>(_current->data() + _used);
+            const std::size_t available = _current->size - _used;
+            const int length = std::vsnprintf(p, available, fmt, args);
+            if (length < 0) {
+                va_end(retry);
+                return {};
+            }
+            if (KZ_UNLIKELY(static_cast<std::size_t>(length) >= available)) {
+                p = static_cast<char*>(allocate(static_cast<std::size_t>(length) + 1, 1));
+                std::vsnprintf(p, static_cast<std::size_t>(length) + 1, fmt, retry);
+                _used -= 1;
+            } else {
+                _used += static_cast<std::size_t>(length);
+            }
+            va_end(retry);
+            return std::string_view(p, static_cast<std::size_t>(length));
+        }
+
+        marker mark() const noexcept { return {_current, _used}; }
+
+        // Release everything allocated since m was taken
+        void rewind(marker m) noexcept {
+            _current = m.current;
+            _used = m.used;
+        }
+
+        // Release everything, keeping the blocks
+        void reset() noexcept { rewind({&_first.header, 0}); }
+
+        // Bytes the arena can hand out before it needs another block from the heap
+        std::size_t capacity() const noexcept {
+            std::size_t size = 0;
+            for (const block* b = &_first.header; b; b = b->next)
+                size += b->size;
+            return size;
+        }
+
+        // Rewinds the arena of the calling thread on destruction
+        class scope {
+        public:
+            scope() noexcept : scope(current()) {}
+            explicit scope(error_arena& arena) noexcept : _arena(arena), _marker(arena.mark()) {}
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+
+            ~scope() { _arena.rewind(_marker); }
+
+        private:
+            error_arena& _arena;
+            marker _marker;
+        };
+
+    private:
+        KZ_COLD void next_block(std::size_t size) {
+            // Reuse the blocks kept from earlier growth when they are large enough
+            while (_current->next) {
+                _current = _current->next;
+                if (_current->size >= size) {
+                    _used = 0;
+                    return;
+                }
+            }
+            const std::size_t capacity = std::max(size, 2 * _current->size);
+            block* b = static_cast<block*>(::operator new(sizeof(block) + capacity));
+            b->next = nullptr;
+            b->size = capacity;
+            _current->next = b;
+            _current = b;
+            _used = 0;
+        }
+
+        struct first_block {
+            block header;
+            alignas(std::max_align_t) std::byte storage[inline_size];
+        };
+
+        first_block _first;
+        block* _current;
+        std::size_t _used = 0;
+    };
+
+    /*
+        arena_error
+
+        Error with a message and key/value context, all stored in the
+        calling thread's error_arena:
+
+            return kz::unexpected(kz::arena_error::format("invalid port %d", port)
+                                      .with_context("file", path)
+                                      .with_context("line", line_text));
+
+        An arena_error is a single pointer: copying and moving it is free
+        and building one never allocates from the heap once the arena is
+        warmed up. Copies are independent: with_context() on one of them
+        leaves the others as they were. It is only valid until the arena is rewound past the
+        point where it was built (the end of the enclosing
+        error_arena::scope): copy what must outlive the scope.
+
+        A default constructed arena_error has an empty message.
+    */
+
+    class arena_error {
+    public:
+        struct context_entry {
+            std::string_view key;
+            std::string_view value;
+            const context_entry* next;
+        };
+
+        class context_range {
+        public:
+            class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = context_entry;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const context_entry*;
+                using reference = const context_entry&;
+
+                iterator() noexcept = default;
+                iterator(const context_entry* entry, const context_entry* last) noexcept : _entry(entry), _last(last) {}
+
+                reference operator*() const noexcept { return *_entry; }
+                pointer operator->() const noexcept { return _entry; }
+                iterator& operator++() noexcept { _entry = _entry == _last ? nullptr : _entry->next; return *this; }
+                iterator operator++(int) noexcept { auto it = *this; ++*this; return it; }
+
+                friend bool operator==(const iterator& x, const iterator& y) noexcept { return x._entry == y._entry; }
+
+            private:
+                const context_entry* _entry = nullptr;
+                // The entries past the last one belong to other errors
+                const context_entry* _last = nullptr;
+            };
+
+            context_range(const context_entry* first, const context_entry* last) noexcept : _first(first), _last(last) {}
+
+            iterator begin() const noexcept { return iterator(_first, _last); }
+            iterator end() const noexcept { return iterator(); }
+            bool empty() const noexcept { return _first == nullptr; }
+
+        private:
+            const context_entry* _first;
+            const context_entry* _last;
+        };
+
+        arena_error() noexcept = default;
+
+        explicit arena_error(std::string_view message, error_arena& arena = error_arena::current())
+            : _data(make(arena, arena.copy(message))) {}
+
+        KZ_PRINTF_FORMAT(1, 2) static arena_error format(const char* fmt, ...) {
+            error_arena& arena = error_arena::current();
+            va_list args;
+            va_start(args, fmt);
+            const std::string_view message = arena.vformat(fmt, args);
+            va_end(args);
+            return arena_error(make(arena, message));
+        }
+
+        std::string_view message() const noexcept { return _data ? _data->message : std::string_view(); }
+
+        context_range context() const noexcept {
+            return _data ? context_range(_data->first, _data->last) : context_range(nullptr, nullptr);
+        }
+
+        // Value of the first context entry with this key, empty if there is none
+        std::string_view context(std::string_view key) const noexcept {
+            for (const auto& entry : context())
+                if (entry.key == key)
+                    return entry.value;
+            return {};
+        }
+
+        /*
+            Append a context entry, copying key and value in the arena of
+            the calling thread. The error gets a record of its own, so that
+            its copies do not see the entry. They keep sharing the entries
+            before it: these are only copied when a copy has already
+            appended its own entry after them.
+        */
+        arena_error& with_context(std::string_view key, std::string_view value) {
+            error_arena& arena = error_arena::current();
+            data* d = _data ? make(arena, *_data) : make(arena, std::string_view());
+            if (d->last && d->last->next) {
+                d->first = d->last = nullptr;
+                for (const auto& entry : context())
+                    append(arena, d, entry.key, entry.value);
+            }
+            append(arena, d, arena.copy(key), arena.copy(value));
+            _data = d;
+            return *this;
+        }
+
+        // Same message and context
+        friend bool operator==(const arena_error& x, const arena_error& y) noexcept {
+            if (x.message() != y.message())
+                return false;
+            auto i = x.context().begin();
+            auto j = y.context().begin();
+            for (; i != x.context().end() && j != y.context().end(); ++i, ++j)
+                if (i->key != j->key || i->value != j->value)
+                    return false;
+            return i == x.context().end() && j == y.context().end();
+        }
+
+    private:
+        struct data {
+            std::string_view message;
+            context_entry* first;
+            context_entry* last;
+        };
+
+        explicit arena_error(data* d) noexcept : _data(d) {}
+
+        static data* make(error_arena& arena, std::string_view message) {
+            return make(arena, data{message, nullptr, nullptr});
+        }
+
+        static data* make(error_arena& arena, const data& d) {
+            return ::new (arena.allocate(sizeof(data), alignof(data))) data(d);
+        }
+
+        static void append(error_arena& arena, data* d, std::string_view key, std::string_view value) {
+            auto* entry = static_cast<context_entry*>(arena.allocate(sizeof(context_entry), alignof(context_entry)));
+            ::new (entry) context_entry{key, value, nullptr};
+            if (d->last)
+                d->last->next = entry;
+            else
+                d->first = entry;
+            d->last = entry;
+        }
+
+        data* _data = nullptr;
+    };
+
+} // namespace kz
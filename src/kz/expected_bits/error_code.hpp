@@ -0,0 +1,252 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <kz/expected_bits/expected.hpp>
+
+namespace kz {
+
+    namespace detail {
+
+        // The category of the error_codes that stand for an error they
+        // could not hold: its value was out of range or its category did
+        // not fit in the registry
+        class unknown_error_category : public std::error_category {
+        public:
+            const char* name() const noexcept override { return "kz::unknown"; }
+            std::string message(int) const override { return "error not representable as a kz::error_code"; }
+        };
+
+        inline const std::error_category& unknown_category() noexcept {
+            static const unknown_error_category category;
+            return category;
+        }
+
+        /*
+            Maps the 8-bit category ids of error_code to categories. The
+            system and generic categories have fixed ids, other categories
+            get one the first time they are used (or when they are
+            registered during static initialization). Lookups by id are a
+            single load.
+        */
+        class error_category_registry {
+        public:
+            static constexpr std::size_t capacity = 256;
+            static constexpr std::uint8_t system_id = 0;
+            static constexpr std::uint8_t generic_id = 1;
+            static constexpr std::uint8_t unknown_id = 255;
+
+            constexpr error_category_registry() noexcept = default;
+
+            error_category_registry(const error_category_registry&) = delete;
+            error_category_registry& operator=(const error_category_registry&) = delete;
+
+            const std::error_category& get(std::uint8_t id) const noexcept {
+                if (id == system_id)
+                    return std::system_category();
+                if (id == generic_id)
+                    return std::generic_category();
+                if (id == unknown_id)
+                    return unknown_category();
+                return *_categories[id].load(std::memory_order_acquire);
+            }
+
+            // Id of the category, registering it if needed. -1 when there is no room left.
+            int find_or_add(const std::error_category& category) noexcept {
+                if (category == std::system_category())
+                    return system_id;
+                if (category == std::generic_category())
+                    return generic_id;
+
+                std::size_t count = _count.load(std::memory_order_acquire);
+                if (const int id = find(category, 2, count); id >= 0)
+                    return id;
+
+                std::lock_guard<std::mutex> lock(_mutex);
+                const std::size_t begin = count;
+                count = _count.load(std::memory_order_relaxed);
+                if (const int id = find(category, begin, count); id >= 0)
+                    return id;
+                if (count == unknown_id)
+                    return -1;
+                _categories[count].store(&category, std::memory_order_relaxed);
+                _count.store(count + 1, std::memory_order_release);
+                return static_cast<int>(count);
+            }
+
+        private:
+            int find(const std::error_category& category, std::size_t begin, std::size_t end) const noexcept {
+                for (std::size_t id = begin; id != end; ++id)
+                    if (*_categories[id].load(std::memory_order_relaxed) == category)
+                        return static_cast<int>(id);
+                return -1;
+            }
+
+            std::atomic<const std::error_category*> _categories[capacity]{};
+            std::atomic<std::size_t> _count{2};
+            std::mutex _mutex;
+        };
+
+        inline constinit error_category_registry error_categories;
+
+    } // namespace detail
+
+    /*
+        error_code
+
+        A std::error_code packed in 32 bits: the id of the category in the
+        high 8 bits and the value, as a signed 24-bit integer, in the low
+        24 bits. It is trivially copyable and expected<std::int32_t,
+        error_code> fits in 8 bytes, which the x86-64 SysV ABI returns in a
+        single register:
+
+            kz::expected<std::int32_t, kz::error_code> read_some(int fd, std::span<std::byte> buffer) {
+                const auto n = ::read(fd, buffer.data(), buffer.size());
+                if (n < 0)
+                    return kz::unexpected(kz::error_code(errno, std::generic_category()));
+                return static_cast<std::int32_t>(n);
+            }
+
+        The message is only looked up, from the category, by message().
+        Values must be between min_value and max_value and there is room
+        for 253 categories besides the system and generic ones. Errors that
+        do not fit become an error in the reserved unknown category, with
+        value 1 (0 stays 0): use to_error_code() to convert an arbitrary
+        std::error_code and get it back when it does not fit.
+    */
+
+    class error_code {
+    public:
+        static constexpr int min_value = -(1 << 23);
+        static constexpr int max_value = (1 << 23) - 1;
+
+        // Success in the system category, like std::error_code
+        constexpr error_code() noexcept = default;
+
+        error_code(int value, const std::error_category& category) noexcept : _bits(pack(category, value)) {}
+
+        template <class ErrorCodeEnum>
+        requires(std::is_error_code_enum_v<ErrorCodeEnum>)
+        error_code(ErrorCodeEnum e) noexcept : error_code(std_code(e)) {}
+
+        explicit error_code(const std::error_code& ec) noexcept : error_code(ec.value(), ec.category()) {}
+
+        // Pre-registered category ids
+        static constexpr std::uint8_t system_category_id = detail::error_category_registry::system_id;
+        static constexpr std::uint8_t generic_category_id = detail::error_category_registry::generic_id;
+        static constexpr std::uint8_t unknown_category_id = detail::error_category_registry::unknown_id;
+
+        // No registry lookup: the category id is known
+        static constexpr error_code from_id(std::uint8_t category_id, int value) noexcept {
+            return from_bits(pack(category_id, value));
+        }
+
+        static constexpr error_code from_bits(std::uint32_t bits) noexcept {
+            error_code ec;
+            ec._bits = bits;
+            return ec;
+        }
+
+        constexpr std::uint32_t bits() const noexcept { return _bits; }
+
+        constexpr int value() const noexcept { return static_cast<std::int32_t>(_bits << 8) >> 8; }
+        constexpr std::uint8_t category_id() const noexcept { return static_cast<std::uint8_t>(_bits >> 24); }
+        const std::error_category& category() const noexcept { return detail::error_categories.get(category_id()); }
+
+        std::string message() const { return category().message(value()); }
+
+        std::error_condition default_error_condition() const noexcept {
+            return category().default_error_condition(value());
+        }
+
+        constexpr explicit operator bool() const noexcept { return value() != 0; }
+
+        constexpr void clear() noexcept { _bits = 0; }
+
+        // Lossless
+        operator std::error_code() const noexcept { return std::error_code(value(), category()); }
+
+        friend constexpr bool operator==(const error_code& x, const error_code& y) noexcept = default;
+
+        friend bool operator==(const error_code& x, const std::error_code& y) noexcept {
+            return static_cast<std::error_code>(x) == y;
+        }
+
+        friend bool operator==(const error_code& x, const std::error_condition& y) noexcept {
+            return static_cast<std::error_code>(x) == y;
+        }
+
+    private:
+        static constexpr std::uint32_t pack(std::uint8_t category_id, int value) noexcept {
+            return (std::uint32_t(category_id) << 24) | (static_cast<std::uint32_t>(value) & 0xFFFFFFu);
+        }
+
+        static std::uint32_t pack(const std::error_category& category, int value) noexcept {
+            const int id = value >= min_value && value <= max_value ? detail::error_categories.find_or_add(category) : -1;
+            if (KZ_UNLIKELY(id < 0))
+                return pack(unknown_category_id, value != 0 ? 1 : 0);
+            return pack(static_cast<std::uint8_t>(id), value);
+        }
+
+        template <class ErrorCodeEnum>
+        static std::error_code std_code(ErrorCodeEnum e) noexcept {
+            using std::make_error_code;
+            return make_error_code(e);
+        }
+
+        std::uint32_t _bits = 0;
+    };
+
+    static_assert(sizeof(error_code) == 4);
+    static_assert(std::is_trivially_copyable_v<error_code>);
+
+    // ec as an error_code, or ec itself if its value or category does not fit
+    inline expected<error_code, std::error_code> to_error_code(const std::error_code& ec) noexcept {
+        if (KZ_UNLIKELY(ec.value() < error_code::min_value || ec.value() > error_code::max_value))
+            return expected<error_code, std::error_code>(unexpect, ec);
+        const int id = detail::error_categories.find_or_add(ec.category());
+        if (KZ_UNLIKELY(id < 0))
+            return expected<error_code, std::error_code>(unexpect, ec);
+        return error_code::from_id(static_cast<std::uint8_t>(id), ec.value());
+    }
+
+    // Register a category during static initialization and return its id:
+    //     static const auto id = kz::register_error_category(my_category());
+    // Returns -1 when all the ids are taken.
+    inline int register_error_category(const std::error_category& category) noexcept {
+        return detail::error_categories.find_or_add(category);
+    }
+
+} // namespace kz
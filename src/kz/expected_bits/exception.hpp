@@ -38,15 +38,90 @@
 #endif
 #endif
 
+// Branch prediction hints
+#if defined(__GNUC__) || defined(__clang__)
+#define KZ_LIKELY(x) __builtin_expect(!!(x), 1)
+#define KZ_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define KZ_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define KZ_LIKELY(x) (x)
+#define KZ_UNLIKELY(x) (x)
+#define KZ_COLD __declspec(noinline)
+#else
+#define KZ_LIKELY(x) (x)
+#define KZ_UNLIKELY(x) (x)
+#define KZ_COLD
+#endif
+
+// MSVC ignores [[no_unique_address]] and provides its own attribute instead
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KZ_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define KZ_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+namespace kz {
+
+    /*
+        Handler called by value() on an expected holding an error when
+        exceptions are disabled and KZ_EXPECTED_ACCESS_POLICY is
+        KZ_EXPECTED_ACCESS_HANDLER. It must not return: if it does, the
+        program is aborted.
+    */
+
+    using bad_access_handler = void (*)(const char* what);
+
+    namespace detail {
+
+        [[noreturn]] KZ_COLD inline void default_bad_access_handler(const char* what) {
+            std::fprintf(stderr, "%s: value() called on an expected holding an error\n", what);
+            std::fflush(stderr);
+            std::abort();
+        }
+
+        inline std::atomic<bad_access_handler> bad_access_handler_instance{&default_bad_access_handler};
+
+    } // namespace detail
+
+    // Install a new handler (nullptr restores the default) and return the previous one
+    inline bad_access_handler set_bad_access_handler(bad_access_handler handler) noexcept {
+        return detail::bad_access_handler_instance.exchange(
+            handler ? handler : &detail::default_bad_access_handler);
+    }
+
+    inline bad_access_handler get_bad_access_handler() noexcept {
+        return detail::bad_access_handler_instance.load();
+    }
+
+} // namespace kz
+
 #if KZ_EXCEPTIONS
 
 #include <exception>
+#include <type_traits>
+#include <utility>
 
 namespace kz {
 
     template <class E>
     class bad_expected_access;
 
+    namespace detail {
+
+        // E has a what() that describes it (like lazy_error)
+        template <class E, class = void>
+        struct has_what : std::false_type {};
+
+        template <class E>
+        struct has_what<E, std::void_t<decltype(std::declval<const E&>().what())>>
+            : std::is_convertible<decltype(std::declval<const E&>().what()), const char*> {};
+
+    } // namespace detail
+
     template <>
     class bad_expected_access<void> : public std::exception {
     protected:
@@ -68,6 +143,14 @@ namespace kz {
     public:
         explicit bad_expected_access(E e) : _error(std::move(e)) {}
 
+        // The error's own description when it has one (like lazy_error)
+        const char* what() const noexcept override {
+            if constexpr (detail::has_what<E>::value)
+                return _error.what();
+            else
+                return bad_expected_access<void>::what();
+        }
+
         E&        error() &       noexcept { return _error; }
         const E&  error() const&  noexcept { return _error; }
         E&&       error() &&      noexcept { return std::move(_error); }
@@ -77,13 +160,64 @@ namespace kz {
         E _error;
     };
 
+    namespace detail {
+
+        // Out-of-line and cold so that callers of value() only inline a test
+        // and a branch, not the construction and throw of the exception.
+        template <class E>
+        [[noreturn]] KZ_COLD void throw_bad_expected_access(E&& e) {
+            throw bad_expected_access<std::decay_t<E>>(std::forward<E>(e));
+        }
+
+    } // namespace detail
+
 } // namespace kz
 
 
 #define KZ_THROW(e) throw (e)
+#define KZ_THROW_BAD_EXPECTED_ACCESS(e) ::kz::detail::throw_bad_expected_access(e)
 
 #else
 
+// What value() does on an expected holding an error without exceptions:
+// - KZ_EXPECTED_ACCESS_TERMINATE: print a diagnostic and abort
+// - KZ_EXPECTED_ACCESS_HANDLER: call the handler set with set_bad_access_handler()
+// - KZ_EXPECTED_ACCESS_UNCHECKED: undefined behaviour, the check is optimized away
+#define KZ_EXPECTED_ACCESS_TERMINATE 1
+#define KZ_EXPECTED_ACCESS_HANDLER 2
+#define KZ_EXPECTED_ACCESS_UNCHECKED 3
+
+#if !defined(KZ_EXPECTED_ACCESS_POLICY)
+#define KZ_EXPECTED_ACCESS_POLICY KZ_EXPECTED_ACCESS_HANDLER
+#endif
+
+namespace kz {
+    namespace detail {
+
+        [[noreturn]] KZ_COLD inline void bad_expected_access_failed() {
+    #if KZ_EXPECTED_ACCESS_POLICY == KZ_EXPECTED_ACCESS_TERMINATE
+            default_bad_access_handler("kz::bad_expected_access");
+    #else
+            get_bad_access_handler()("kz::bad_expected_access");
+            std::abort();
+    #endif
+        }
+
+    } // namespace detail
+} // namespace kz
+
 #define KZ_THROW(e) {}
 
+#if KZ_EXPECTED_ACCESS_POLICY == KZ_EXPECTED_ACCESS_UNCHECKED
+#if defined(__GNUC__) || defined(__clang__)
+#define KZ_THROW_BAD_EXPECTED_ACCESS(e) __builtin_unreachable()
+#elif defined(_MSC_VER)
+#define KZ_THROW_BAD_EXPECTED_ACCESS(e) __assume(0)
+#else
+#define KZ_THROW_BAD_EXPECTED_ACCESS(e) {}
+#endif
+#else
+#define KZ_THROW_BAD_EXPECTED_ACCESS(e) ::kz::detail::bad_expected_access_failed()
+#endif
+
 #endif
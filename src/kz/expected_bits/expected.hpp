@@ -27,11 +27,19 @@
 
 #pragma once
 
+#include <cassert>
 #include <functional>
 #include <memory>
 #include <kz/expected_bits/exception.hpp>
+#include <kz/expected_bits/niche.hpp>
+#include <kz/expected_bits/relocate.hpp>
+#include <kz/expected_bits/telemetry.hpp>
+#include <kz/expected_bits/traces.hpp>
 #include <kz/expected_bits/unexpected.hpp>
 
+// Called wherever an error enters an expected (see telemetry.hpp)
+#define KZ_EXPECTED_ON_ERROR(error) (KZ_EXPECTED_TELEMETRY_HOOK(error), KZ_EXPECTED_TRACE_HOOK(error))
+
 // clang does not suport P0848R3. Details at https://clang.llvm.org/cxx_status.html#cxx20.
 // Older versions of GCC / mingw will crash (ICE).
 #if defined(__clang__)
@@ -75,10 +83,42 @@ namespace kz {
             if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
                 detail::destroy_at(std::addressof(oldval));
                 detail::construct_at(std::addressof(newval), std::forward<Args>(args)...);
+            } else if constexpr (is_trivially_relocatable_v<T>) {
+                if (std::is_constant_evaluated()) {
+                    T tmp(std::forward<Args>(args)...);
+                    detail::destroy_at(std::addressof(oldval));
+                    detail::construct_at(std::addressof(newval), std::move(tmp));
+                } else {
+                    relocation_buffer<T> tmp;
+                    ::new (static_cast<void*>(tmp.get())) T(std::forward<Args>(args)...);
+                    detail::destroy_at(std::addressof(oldval));
+                    relocate_at(tmp.get(), std::addressof(newval));
+                }
             } else if constexpr (std::is_nothrow_move_constructible_v<T>) {
                 T tmp(std::forward<Args>(args)...);
                 detail::destroy_at(std::addressof(oldval));
                 detail::construct_at(std::addressof(newval), std::move(tmp));
+            } else if constexpr (is_trivially_relocatable_v<U>) {
+                if (std::is_constant_evaluated()) {
+                    U tmp(std::move(oldval));
+                    detail::destroy_at(std::addressof(oldval));
+                    try {
+                        detail::construct_at(std::addressof(newval), std::forward<Args>(args)...);
+                    } catch (...) {
+                        detail::construct_at(std::addressof(oldval), std::move(tmp));
+                        throw;
+                    }
+                } else {
+                    relocation_buffer<U> tmp;
+                    relocate_at(std::addressof(oldval), tmp.get());
+                    try {
+                        detail::construct_at(std::addressof(newval), std::forward<Args>(args)...);
+                    } catch (...) {
+                        relocate_at(tmp.get(), std::addressof(oldval));
+                        throw;
+                    }
+                    detail::destroy_at(tmp.get());
+                }
             } else {
                 U tmp(std::move(oldval));
                 detail::destroy_at(std::addressof(oldval));
@@ -101,12 +141,103 @@ namespace kz {
 
 #endif
 
+        // void is treated as a trivial type
+        template <class T>
+        using void_as_trivial_t = std::conditional_t<std::is_void_v<T>, int, T>;
+
+        // Assigning can be done by copying the bytes when T and E can
+        template <class T, class E>
+        inline constexpr bool is_trivially_copy_assignable_expected_v =
+            std::is_trivially_copy_assignable_v<void_as_trivial_t<T>> &&
+            std::is_trivially_copy_constructible_v<void_as_trivial_t<T>> &&
+            std::is_trivially_destructible_v<void_as_trivial_t<T>> &&
+            std::is_trivially_copy_assignable_v<E> &&
+            std::is_trivially_copy_constructible_v<E> &&
+            std::is_trivially_destructible_v<E>;
+
+        template <class T, class E>
+        inline constexpr bool is_trivially_move_assignable_expected_v =
+            std::is_trivially_move_assignable_v<void_as_trivial_t<T>> &&
+            std::is_trivially_move_constructible_v<void_as_trivial_t<T>> &&
+            std::is_trivially_destructible_v<void_as_trivial_t<T>> &&
+            std::is_trivially_move_assignable_v<E> &&
+            std::is_trivially_move_constructible_v<E> &&
+            std::is_trivially_destructible_v<E>;
+
         template<class T, template <class...> class V>
         struct is_specialization : std::false_type {};
 
         template<template <class...> class V, class... Args>
         struct is_specialization<V<Args...>, V>: std::true_type {};
 
+        // T can be initialized with the result of invoking F. A prvalue T is
+        // accepted even if T is not movable: it is constructed in place.
+        template <class T, class F, class... Args>
+        constexpr bool is_invoke_constructible() {
+            if constexpr (std::is_invocable_v<F, Args...>) {
+                using R = std::invoke_result_t<F, Args...>;
+                return std::is_same_v<std::remove_cv_t<R>, std::remove_cv_t<T>> || std::is_constructible_v<T, R>;
+            } else {
+                return false;
+            }
+        }
+
+        template <class T, class F, class... Args>
+        inline constexpr bool is_invoke_constructible_v = is_invoke_constructible<T, F, Args...>();
+
+        // Fallbacks of value_or_else() and error_or_else() take the other
+        // alternative if they can, and nothing otherwise
+        template <class F, class A>
+        using fallback_result_t = typename std::conditional_t<
+            std::is_invocable_v<F, A>, std::invoke_result<F, A>, std::invoke_result<F>>::type;
+
+        template <class F, class A>
+        constexpr fallback_result_t<F, A> invoke_fallback(F&& f, A&& a) {
+            if constexpr (std::is_invocable_v<F, A>)
+                return std::invoke(std::forward<F>(f), std::forward<A>(a));
+            else
+                return std::invoke(std::forward<F>(f));
+        }
+
+        // Result of transform(): references are kept, other types decay
+        template <class R>
+        using transform_value_t = std::conditional_t<std::is_lvalue_reference_v<R>, R, std::remove_cvref_t<R>>;
+
+        // Storage for an error that is only alive some of the time. Empty
+        // errors are always alive and take no space.
+        template <class E, bool = std::is_empty_v<E> &&
+                                  std::is_trivially_default_constructible_v<E> &&
+                                  std::is_trivially_destructible_v<E>>
+        struct error_slot {
+            constexpr error_slot() noexcept {}
+
+            template <class F, class... Args>
+            constexpr explicit error_slot(invoke_tag_t, F&& f, Args&&... args)
+                : _error(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)) {}
+
+#if KZ_P0848R3
+            KZ_CONSTEXPR_DESTRUCTOR ~error_slot() requires(!std::is_trivially_destructible_v<E>) {}
+            KZ_CONSTEXPR_DESTRUCTOR ~error_slot() requires(std::is_trivially_destructible_v<E>) = default;
+#else
+            KZ_CONSTEXPR_DESTRUCTOR ~error_slot() {}
+#endif
+
+            union {
+                E _error;
+            };
+        };
+
+        template <class E>
+        struct error_slot<E, true> {
+            constexpr error_slot() = default;
+
+            template <class F, class... Args>
+            constexpr explicit error_slot(invoke_tag_t, F&& f, Args&&... args)
+                : _error(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)) {}
+
+            KZ_NO_UNIQUE_ADDRESS E _error;
+        };
+
     } // namespace detail
 
     /*
@@ -140,6 +271,7 @@ namespace kz {
             } else {
                 construct_error(rhs._error);
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
         constexpr expected(const expected&) noexcept
         requires(
@@ -161,6 +293,7 @@ namespace kz {
             } else {
                 construct_error(rhs._error);
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 #endif
 
@@ -176,6 +309,7 @@ namespace kz {
             } else {
                 construct_error(std::move(rhs._error));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 
         constexpr expected(expected&&) noexcept
@@ -193,6 +327,7 @@ namespace kz {
             } else {
                 construct_error(std::move(rhs._error));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 #endif
 
@@ -220,6 +355,7 @@ namespace kz {
             } else {
                 construct_error(std::forward<const G&>(rhs.error()));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 
         template <class U, class G>
@@ -246,6 +382,7 @@ namespace kz {
             } else {
                 construct_error(std::forward<G>(rhs.error()));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 
         template <class U = T>
@@ -262,13 +399,19 @@ namespace kz {
         constexpr explicit(!std::is_convertible_v<const G&, E>)
         expected(const unexpected<G>& e)
         requires(std::is_constructible_v<E, const G&>)
-            : _error(std::forward<const G&>(e.value())), _has_value(false) {}
+            : _error(std::forward<const G&>(e.value())), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
 
         template <class G>
         constexpr explicit(!std::is_convertible_v<G, E>)
         expected(unexpected<G>&& e)
         requires(std::is_constructible_v<E, G>)
-            : _error(std::forward<G>(e.value())), _has_value(false) {}
+            : _error(std::forward<G>(e.value())), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
 
         template <class... Args>
         constexpr explicit expected(in_place_t, Args&&... args)
@@ -281,14 +424,33 @@ namespace kz {
             : _value(il, std::forward<Args>(args)...), _has_value(true) {}
 
         template <class... Args>
-        constexpr explicit expected(unexpect_t, Args&&... args)
+        constexpr explicit expected(unexpect_t tag, Args&&... args)
         requires(std::is_constructible_v<E, Args...>)
-            : _error(std::forward<Args>(args)...), _has_value(false) {}
+            : _error(std::forward<Args>(args)...), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
 
         template <class U, class... Args>
-        constexpr explicit expected(unexpect_t, initializer_list<U> il, Args&&... args)
+        constexpr explicit expected(unexpect_t tag, initializer_list<U> il, Args&&... args)
         requires(std::is_constructible_v<E, initializer_list<U>&, Args...>)
-            : _error(il, std::forward<Args>(args)...), _has_value(false) {}
+            : _error(il, std::forward<Args>(args)...), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, F&& f, Args&&... args)
+        requires(detail::is_invoke_constructible_v<T, F, Args...>)
+            : _value(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)), _has_value(true) {}
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, unexpect_t tag, F&& f, Args&&... args)
+        requires(detail::is_invoke_constructible_v<E, F, Args...>)
+            : _error(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
 
         // Destructor
         KZ_CONSTEXPR_DESTRUCTOR ~expected() {
@@ -329,7 +491,11 @@ namespace kz {
             std::is_copy_constructible_v<T> &&
             std::is_copy_assignable_v<E> &&
             std::is_copy_constructible_v<E> &&
-            (std::is_nothrow_move_constructible_v<T> || std::is_nothrow_move_constructible_v<E>)) {
+            (std::is_nothrow_move_constructible_v<T> || std::is_nothrow_move_constructible_v<E>)
+#if KZ_P0848R3
+            && !detail::is_trivially_copy_assignable_expected_v<T, E>
+#endif
+            ) {
             if (_has_value) {
                 if (rhs._has_value) {
                     _value = rhs._value;
@@ -345,9 +511,15 @@ namespace kz {
                     _error = rhs._error;
                 }
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
             return *this;
         }
 
+#if KZ_P0848R3
+        constexpr expected& operator=(const expected&) noexcept
+        requires(detail::is_trivially_copy_assignable_expected_v<T, E>) = default;
+#endif
+
         constexpr expected& operator=(const expected&) = delete;
 
         constexpr expected& operator=(expected&& rhs) noexcept(
@@ -360,7 +532,11 @@ namespace kz {
             std::is_move_assignable_v<T> &&
             std::is_move_constructible_v<E> &&
             std::is_move_assignable_v<E> &&
-            (std::is_nothrow_move_constructible_v<T> || std::is_nothrow_move_constructible_v<E>)) {
+            (std::is_nothrow_move_constructible_v<T> || std::is_nothrow_move_constructible_v<E>)
+#if KZ_P0848R3
+            && !detail::is_trivially_move_assignable_expected_v<T, E>
+#endif
+            ) {
             if (_has_value) {
                 if (rhs._has_value) {
                     _value = std::move(rhs._value);
@@ -376,9 +552,15 @@ namespace kz {
                     _error = std::move(rhs._error);
                 }
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
             return *this;
         }
 
+#if KZ_P0848R3
+        constexpr expected& operator=(expected&&) noexcept
+        requires(detail::is_trivially_move_assignable_expected_v<T, E>) = default;
+#endif
+
         constexpr expected& operator=(expected&&) = delete;
 
         template <class U = T>
@@ -410,6 +592,8 @@ namespace kz {
             } else {
                 _error = std::forward<const G&>(e.value());
             }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
             return *this;
         }
 
@@ -425,6 +609,8 @@ namespace kz {
             } else {
                 _error = std::forward<G>(e.value());
             }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
             return *this;
         }
 
@@ -465,11 +651,23 @@ namespace kz {
             std::is_move_constructible_v<T> &&
             std::is_move_constructible_v<E> &&
             (std::is_nothrow_move_constructible_v<T> || std::is_nothrow_move_constructible_v<E>)) {
+            KZ_EXPECTED_SWAP_ORIGIN(rhs);
             if (_has_value) {
                 if (rhs._has_value) {
                     using std::swap;
                     std::swap(_value, rhs._value);
                 } else {
+                    if constexpr (is_trivially_relocatable_v<T> && is_trivially_relocatable_v<E>) {
+                        if (!std::is_constant_evaluated()) {
+                            detail::relocation_buffer<E> tmp;
+                            relocate_at(std::addressof(rhs._error), tmp.get());
+                            relocate_at(std::addressof(_value), std::addressof(rhs._value));
+                            relocate_at(tmp.get(), std::addressof(_error));
+                            _has_value = false;
+                            rhs._has_value = true;
+                            return;
+                        }
+                    }
 #if KZ_EXCEPTIONS
                     if constexpr (std::is_nothrow_move_constructible_v<T> &&
                                   std::is_nothrow_move_constructible_v<E>) {
@@ -537,22 +735,22 @@ namespace kz {
         constexpr bool      has_value() const noexcept     { return _has_value; }
 
         constexpr const T& value() const& {
-            if (!_has_value) KZ_THROW(bad_expected_access(_error));
+            if (KZ_UNLIKELY(!_has_value)) KZ_THROW_BAD_EXPECTED_ACCESS(_error);
             return _value;
         }
 
         constexpr T& value() & {
-            if (!_has_value) KZ_THROW(bad_expected_access(_error));
+            if (KZ_UNLIKELY(!_has_value)) KZ_THROW_BAD_EXPECTED_ACCESS(_error);
             return _value;
         }
 
         constexpr const T&& value() const&& {
-            if (!_has_value) KZ_THROW(bad_expected_access(std::move(_error)));
+            if (KZ_UNLIKELY(!_has_value)) KZ_THROW_BAD_EXPECTED_ACCESS(std::move(_error));
             return std::move(_value);
         }
 
         constexpr T&& value() && {
-            if (!_has_value) KZ_THROW(bad_expected_access(std::move(_error)));
+            if (KZ_UNLIKELY(!_has_value)) KZ_THROW_BAD_EXPECTED_ACCESS(std::move(_error));
             return std::move(_value);
         }
 
@@ -583,12 +781,44 @@ namespace kz {
             return _has_value ? std::forward<G>(e) :  std::move(_error);
         }
 
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, const E&>, T>)
+        constexpr T value_or_else(F&& f) const & {
+            if (_has_value)
+                return _value;
+            return static_cast<T>(detail::invoke_fallback(std::forward<F>(f), _error));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, E&&>, T>)
+        constexpr T value_or_else(F&& f) && {
+            if (_has_value)
+                return std::move(_value);
+            return static_cast<T>(detail::invoke_fallback(std::forward<F>(f), std::move(_error)));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, const T&>, E>)
+        constexpr E error_or_else(F&& f) const & {
+            if (!_has_value)
+                return _error;
+            return static_cast<E>(detail::invoke_fallback(std::forward<F>(f), _value));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, T&&>, E>)
+        constexpr E error_or_else(F&& f) && {
+            if (!_has_value)
+                return std::move(_error);
+            return static_cast<E>(detail::invoke_fallback(std::forward<F>(f), std::move(_value)));
+        }
+
         template <class F>
         requires(std::is_copy_constructible_v<E>)
         constexpr auto and_then(F&& f) &
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
-            return _has_value ? std::invoke(std::forward<F>(f), value()) : U(unexpect, error());
+            return _has_value ? std::invoke(std::forward<F>(f), value()) : U(detail::unexpect_from(*this), error());
         }
 
         template <class F>
@@ -596,7 +826,7 @@ namespace kz {
         constexpr auto and_then(F&& f) const &
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
-            return _has_value ? std::invoke(std::forward<F>(f), value()) : U(unexpect, error());
+            return _has_value ? std::invoke(std::forward<F>(f), value()) : U(detail::unexpect_from(*this), error());
         }
 
         template <class F>
@@ -604,7 +834,7 @@ namespace kz {
         constexpr auto and_then(F&& f) &&
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
-            return _has_value ? std::invoke(std::forward<F>(f), std::move(value())) : U(unexpect, std::move(error()));
+            return _has_value ? std::invoke(std::forward<F>(f), std::move(value())) : U(detail::unexpect_from(*this), std::move(error()));
         }
 
         template <class F>
@@ -612,7 +842,7 @@ namespace kz {
         constexpr auto and_then(F&& f) const &&
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
-            return _has_value ? std::invoke(std::forward<F>(f), std::move(value())) : U(unexpect, std::move(error()));
+            return _has_value ? std::invoke(std::forward<F>(f), std::move(value())) : U(detail::unexpect_from(*this), std::move(error()));
         }
 
         template <class F>
@@ -654,10 +884,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, error());
+                return expected<U,E>(detail::unexpect_from(*this), error());
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f), value()));
+                return expected<U,E>(invoke_tag, std::forward<F>(f), value());
             else
             {
                 std::invoke(std::forward<F>(f), value());
@@ -672,10 +902,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, error());
+                return expected<U,E>(detail::unexpect_from(*this), error());
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f), value()));
+                return expected<U,E>(invoke_tag, std::forward<F>(f), value());
             else
             {
                 std::invoke(std::forward<F>(f), value());
@@ -690,10 +920,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, std::move(error()));
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f), std::move(value())));
+                return expected<U,E>(invoke_tag, std::forward<F>(f), std::move(value()));
             else
             {
                 std::invoke(std::forward<F>(f), std::move(value()));
@@ -708,10 +938,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, std::move(error()));
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f), std::move(value())));
+                return expected<U,E>(invoke_tag, std::forward<F>(f), std::move(value()));
             else
             {
                 std::invoke(std::forward<F>(f), std::move(value()));
@@ -724,7 +954,7 @@ namespace kz {
         constexpr auto transform_error(F&& f) &
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), error()));
+            return _has_value ? expected<T,G>(std::in_place, value()) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
         }
 
         template <class F>
@@ -732,7 +962,7 @@ namespace kz {
         constexpr auto transform_error(F&& f) const &
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), error()));
+            return _has_value ? expected<T,G>(std::in_place, value()) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
         }
 
         template <class F>
@@ -740,7 +970,7 @@ namespace kz {
         constexpr auto transform_error(F&& f) &&
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
+            return _has_value ? expected<T,G>(std::in_place, std::move(value())) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
         }
 
         template <class F>
@@ -748,7 +978,7 @@ namespace kz {
         constexpr auto transform_error(F&& f) const &&
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
+            return _has_value ? expected<T,G>(std::in_place, std::move(value())) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
         }
 
         // Equality operators
@@ -807,6 +1037,10 @@ namespace kz {
             E _error;
         };
         bool _has_value;
+#if KZ_EXPECTED_TRACK_ORIGIN
+        std::uint32_t _origin = 0;
+        friend struct detail::origin_access;
+#endif
     };
 
     /*
@@ -814,7 +1048,7 @@ namespace kz {
     */
 
     template <class T, class E>
-    requires std::is_void_v<T>
+    requires(std::is_void_v<T> && !detail::is_niche_error_v<T, E>)
     class expected<T, E> {
     public:
         using value_type = T;
@@ -837,6 +1071,7 @@ namespace kz {
             } else {
                 construct_error(rhs._error);
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 
         constexpr expected(const expected&) noexcept
@@ -853,6 +1088,7 @@ namespace kz {
             } else {
                 construct_error(rhs._error);
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 #endif
 
@@ -866,6 +1102,7 @@ namespace kz {
             } else {
                 construct_error(std::move(rhs._error));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 
         constexpr expected(expected&&) noexcept
@@ -879,6 +1116,7 @@ namespace kz {
             } else {
                 construct_error(std::move(rhs._error));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 #endif
 
@@ -897,6 +1135,7 @@ namespace kz {
             } else {
                 construct_error(std::forward<const G&>(rhs.error()));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 
         template <class U, class G>
@@ -914,31 +1153,52 @@ namespace kz {
             } else {
                 construct_error(std::forward<G>(rhs.error()));
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
         }
 
         template <class G>
         constexpr explicit(!std::is_convertible_v<const G&, E>)
         expected(const unexpected<G>& e)
         requires(std::is_constructible_v<E, const G&>)
-            : _error(std::forward<const G&>(e.value())), _has_value(false) {}
+            : _error(std::forward<const G&>(e.value())), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
 
         template <class G>
         constexpr explicit(!std::is_convertible_v<G, E>)
         expected(unexpected<G>&& e)
         requires(std::is_constructible_v<E, G>)
-            : _error(std::forward<G>(e.value())), _has_value(false) {}
+            : _error(std::forward<G>(e.value())), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
 
         constexpr explicit expected(in_place_t) noexcept : _has_value(true) {}
 
         template <class... Args>
-        constexpr explicit expected(unexpect_t, Args&&... args)
+        constexpr explicit expected(unexpect_t tag, Args&&... args)
         requires(std::is_constructible_v<E, Args...>)
-            : _error(std::forward<Args>(args)...), _has_value(false) {}
+            : _error(std::forward<Args>(args)...), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
 
         template <class U, class... Args>
-        constexpr explicit expected(unexpect_t, initializer_list<U> il, Args&&... args)
+        constexpr explicit expected(unexpect_t tag, initializer_list<U> il, Args&&... args)
             requires(std::is_constructible_v<E, initializer_list<U>&, Args...>)
-            : _error(il, std::forward<Args>(args)...), _has_value(false) {}
+            : _error(il, std::forward<Args>(args)...), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, unexpect_t tag, F&& f, Args&&... args)
+        requires(detail::is_invoke_constructible_v<E, F, Args...>)
+            : _error(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)), _has_value(false) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
 
         // Destructor
         KZ_CONSTEXPR_DESTRUCTOR ~expected() {
@@ -958,7 +1218,11 @@ namespace kz {
             std::is_nothrow_copy_constructible_v<E>)
         requires(
             std::is_copy_assignable_v<E> &&
-            std::is_copy_constructible_v<E>) {
+            std::is_copy_constructible_v<E>
+#if KZ_P0848R3
+            && !detail::is_trivially_copy_assignable_expected_v<T, E>
+#endif
+            ) {
             if (_has_value) {
                 if (!rhs._has_value) {
                     construct_error(rhs._error);
@@ -971,9 +1235,15 @@ namespace kz {
                     _error = rhs._error;
                 }
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
             return *this;
         }
 
+#if KZ_P0848R3
+        constexpr expected& operator=(const expected&) noexcept
+        requires(detail::is_trivially_copy_assignable_expected_v<T, E>) = default;
+#endif
+
         constexpr expected& operator=(const expected&) = delete;
 
         constexpr expected& operator=(expected&& rhs) noexcept(
@@ -981,7 +1251,11 @@ namespace kz {
             std::is_nothrow_move_constructible_v<E>)
         requires(
             std::is_move_constructible_v<E> &&
-            std::is_move_assignable_v<E>) {
+            std::is_move_assignable_v<E>
+#if KZ_P0848R3
+            && !detail::is_trivially_move_assignable_expected_v<T, E>
+#endif
+            ) {
             if (_has_value) {
                 if (!rhs._has_value) {
                     construct_error(std::move(rhs._error));
@@ -994,9 +1268,15 @@ namespace kz {
                     _error = std::move(rhs._error);
                 }
             }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
             return *this;
         }
 
+#if KZ_P0848R3
+        constexpr expected& operator=(expected&&) noexcept
+        requires(detail::is_trivially_move_assignable_expected_v<T, E>) = default;
+#endif
+
         template <class G>
         constexpr expected& operator=(const unexpected<G>& e)
         requires(
@@ -1007,6 +1287,8 @@ namespace kz {
             } else {
                 _error = std::forward<const G&>(e.value());
             }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
             return *this;
         }
 
@@ -1020,6 +1302,8 @@ namespace kz {
             } else {
                 _error = std::forward<G>(e.value());
             }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
             return *this;
         }
 
@@ -1038,8 +1322,17 @@ namespace kz {
         requires(
             std::is_swappable_v<E> &&
             std::is_move_constructible_v<E>) {
+            KZ_EXPECTED_SWAP_ORIGIN(rhs);
             if (_has_value) {
                 if (!rhs._has_value) {
+                    if constexpr (is_trivially_relocatable_v<E>) {
+                        if (!std::is_constant_evaluated()) {
+                            relocate_at(std::addressof(rhs._error), std::addressof(_error));
+                            _has_value = false;
+                            rhs._has_value = true;
+                            return;
+                        }
+                    }
                     construct_error(std::move(rhs._error));
                     detail::destroy_at(std::addressof(rhs._error));
                     rhs._has_value = true;
@@ -1064,11 +1357,11 @@ namespace kz {
         constexpr void operator*() const noexcept         {}
 
         constexpr void value() const& {
-            if (!_has_value) KZ_THROW(bad_expected_access(_error));
+            if (KZ_UNLIKELY(!_has_value)) KZ_THROW_BAD_EXPECTED_ACCESS(_error);
         }
 
         constexpr void value() && {
-            if (!_has_value) KZ_THROW(bad_expected_access(std::move(_error)));
+            if (KZ_UNLIKELY(!_has_value)) KZ_THROW_BAD_EXPECTED_ACCESS(std::move(_error));
         }
 
         constexpr const E&  error() const&  { return _error; }
@@ -1088,12 +1381,28 @@ namespace kz {
             return _has_value ? std::forward<G>(e) :  std::move(_error);
         }
 
+        template <class F>
+        requires(std::is_convertible_v<std::invoke_result_t<F>, E>)
+        constexpr E error_or_else(F&& f) const & {
+            if (!_has_value)
+                return _error;
+            return static_cast<E>(std::invoke(std::forward<F>(f)));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<std::invoke_result_t<F>, E>)
+        constexpr E error_or_else(F&& f) && {
+            if (!_has_value)
+                return std::move(_error);
+            return static_cast<E>(std::invoke(std::forward<F>(f)));
+        }
+
         template <class F>
         requires(std::is_copy_constructible_v<E>)
         constexpr auto and_then(F&& f) &
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
-            return _has_value ? std::invoke(std::forward<F>(f)) : U(unexpect, error());
+            return _has_value ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), error());
         }
 
         template <class F>
@@ -1101,7 +1410,7 @@ namespace kz {
         constexpr auto and_then(F&& f) const &
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
-            return _has_value ? std::invoke(std::forward<F>(f)) : U(unexpect, error());
+            return _has_value ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), error());
         }
 
         template <class F>
@@ -1109,7 +1418,7 @@ namespace kz {
         constexpr auto and_then(F&& f)  &&
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
-            return _has_value ? std::invoke(std::forward<F>(f)) : U(unexpect, std::move(error()));
+            return _has_value ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), std::move(error()));
         }
 
         template <class F>
@@ -1117,35 +1426,35 @@ namespace kz {
         constexpr auto and_then(F&& f) const &&
         {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
-            return _has_value ? std::invoke(std::forward<F>(f)) : U(unexpect, std::move(error()));
+            return _has_value ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), std::move(error()));
         }
 
         template <class F>
         constexpr auto or_else(F&& f) &
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
-            return _has_value ? G(std::in_place, value()) : std::invoke(std::forward<F>(f), error());
+            return _has_value ? G() : std::invoke(std::forward<F>(f), error());
         }
 
         template <class F>
         constexpr auto or_else(F&& f) const &
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
-            return _has_value ? G(std::in_place, value()) : std::invoke(std::forward<F>(f), error());
+            return _has_value ? G() : std::invoke(std::forward<F>(f), error());
         }
 
         template <class F>
         constexpr auto or_else(F&& f) &&
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
-            return _has_value ? G(std::in_place, std::move(value())) : std::invoke(std::forward<F>(f), std::move(error()));
+            return _has_value ? G() : std::invoke(std::forward<F>(f), std::move(error()));
         }
 
         template <class F>
         constexpr auto or_else(F&& f) const &&
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
-            return _has_value ? G(std::in_place, std::move(value())) : std::invoke(std::forward<F>(f), std::move(error()));
+            return _has_value ? G() : std::invoke(std::forward<F>(f), std::move(error()));
         }
 
         template <class F>
@@ -1155,10 +1464,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, error());
+                return expected<U,E>(detail::unexpect_from(*this), error());
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f)));
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
             else
             {
                 std::invoke(std::forward<F>(f));
@@ -1173,10 +1482,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, error());
+                return expected<U,E>(detail::unexpect_from(*this), error());
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f)));
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
             else
             {
                 std::invoke(std::forward<F>(f));
@@ -1191,10 +1500,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, std::move(error()));
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f)));
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
             else
             {
                 std::invoke(std::forward<F>(f));
@@ -1209,10 +1518,10 @@ namespace kz {
             using U = std::remove_cvref_t<std::invoke_result_t<F>>;
 
             if (!_has_value)
-                return expected<U,E>(unexpect, std::move(error()));
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
 
             if constexpr (!std::is_void_v<U>)
-                return expected<U,E>(std::invoke(std::forward<F>(f)));
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
             else
             {
                 std::invoke(std::forward<F>(f));
@@ -1224,28 +1533,28 @@ namespace kz {
         constexpr auto transform_error(F&& f) &
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), error()));
+            return _has_value ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
         }
 
         template <class F>
         constexpr auto transform_error(F&& f) const &
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), error()));
+            return _has_value ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
         }
 
         template <class F>
         constexpr auto transform_error(F&& f) &&
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
+            return _has_value ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
         }
 
         template <class F>
         constexpr auto transform_error(F&& f) const &&
         {
             using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
-            return _has_value ? expected<T,G>() : expected<T,G>(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
+            return _has_value ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
         }
 
         // Equality operators
@@ -1293,6 +1602,1555 @@ namespace kz {
             E _error;
         };
         bool _has_value;
+#if KZ_EXPECTED_TRACK_ORIGIN
+        std::uint32_t _origin = 0;
+        friend struct detail::origin_access;
+#endif
     };
 
+    /*
+        Partial specialization for a value type with a niche (see niche_traits<>)
+        and an empty error type. The state is encoded in the value: no separate
+        discriminant is stored and sizeof(expected) == sizeof(T).
+    */
+
+    template <class T, class E>
+    requires(detail::is_niche_value_v<T, E>)
+    class expected<T, E> {
+    public:
+        using value_type = T;
+        using error_type = E;
+        using unexpected_type = unexpected<E>;
+
+        template <class U>
+        using rebind = expected<U, error_type>;
+
+        // Constructors. There is no default constructor when the default
+        // value of T is its niche: the result would hold an error.
+        constexpr expected()
+        requires(std::is_default_constructible_v<T> && !detail::value_init_is_niche<T>)
+            : _value(), _error() {
+            assert(has_value());
+        }
+
+        constexpr expected(const expected&) = default;
+        constexpr expected(expected&&) = default;
+
+        template <class U, class G>
+        constexpr explicit(!std::is_convertible_v<const U&, T> ||
+                           !std::is_convertible_v<const G&, E>)
+        expected(const expected<U, G>& rhs)
+        requires(
+            std::is_constructible_v<T, const U&> &&
+            std::is_constructible_v<E, const G&> &&
+            !std::is_constructible_v<T, expected<U, G>&> &&
+            !std::is_constructible_v<T, expected<U, G>> &&
+            !std::is_constructible_v<T, const expected<U, G>&> &&
+            !std::is_constructible_v<T, const expected<U, G>> &&
+            !std::is_convertible_v<expected<U, G>&, T> &&
+            !std::is_convertible_v<expected<U, G>&&, T> &&
+            !std::is_convertible_v<const expected<U, G>&, T> &&
+            !std::is_convertible_v<const expected<U, G>&&, T> &&
+            !std::is_constructible_v<unexpected<E>, expected<U, G>&> &&
+            !std::is_constructible_v<unexpected<E>, expected<U, G>> &&
+            !std::is_constructible_v<unexpected<E>, const expected<U, G>&> &&
+            !std::is_constructible_v<unexpected<E>, const expected<U, G>>)
+            : _value(niche_traits<T>::niche()), _error() {
+            if (rhs.has_value()) {
+                construct_value(std::forward<const U&>(*rhs));
+            } else {
+                construct_error(std::forward<const G&>(rhs.error()));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        template <class U, class G>
+        constexpr explicit(!std::is_convertible_v<U, T> ||
+                           !std::is_convertible_v<G, E>)
+        expected(expected<U, G>&& rhs)
+        requires(
+            std::is_constructible_v<T, U> &&
+            std::is_constructible_v<E, G> &&
+            !std::is_constructible_v<T, expected<U, G>&> &&
+            !std::is_constructible_v<T, expected<U, G>> &&
+            !std::is_constructible_v<T, const expected<U, G>&> &&
+            !std::is_constructible_v<T, const expected<U, G>> &&
+            !std::is_convertible_v<expected<U, G>&, T> &&
+            !std::is_convertible_v<expected<U, G>&&, T> &&
+            !std::is_convertible_v<const expected<U, G>&, T> &&
+            !std::is_convertible_v<const expected<U, G>&&, T> &&
+            !std::is_constructible_v<unexpected<E>, expected<U, G>&> &&
+            !std::is_constructible_v<unexpected<E>, expected<U, G>> &&
+            !std::is_constructible_v<unexpected<E>, const expected<U, G>&> &&
+            !std::is_constructible_v<unexpected<E>, const expected<U, G>>)
+            : _value(niche_traits<T>::niche()), _error() {
+            if (rhs.has_value()) {
+                construct_value(std::forward<U>(*rhs));
+            } else {
+                construct_error(std::forward<G>(rhs.error()));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        template <class U = T>
+        constexpr explicit(!std::is_convertible_v<U, T>)
+        expected(U&& v)
+        requires(
+            !std::is_same_v<std::remove_cvref_t<U>, in_place_t> &&
+            !std::is_same_v<expected<T, E>, std::remove_cvref_t<U>> &&
+            !detail::is_specialization<std::remove_cvref_t<U>, unexpected>::value &&
+            std::is_constructible_v<T, U>)
+            : _value(std::forward<U>(v)), _error() {
+            assert(has_value());
+        }
+
+        template <class G>
+        constexpr explicit(!std::is_convertible_v<const G&, E>)
+        expected(const unexpected<G>& e)
+        requires(std::is_constructible_v<E, const G&>)
+            : _value(niche_traits<T>::niche()), _error(std::forward<const G&>(e.value())) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
+
+        template <class G>
+        constexpr explicit(!std::is_convertible_v<G, E>)
+        expected(unexpected<G>&& e)
+        requires(std::is_constructible_v<E, G>)
+            : _value(niche_traits<T>::niche()), _error(std::forward<G>(e.value())) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
+
+        template <class... Args>
+        constexpr explicit expected(in_place_t, Args&&... args)
+        requires(std::is_constructible_v<T, Args...>)
+            : _value(std::forward<Args>(args)...), _error() {
+            assert(has_value());
+        }
+
+        template <class U, class... Args>
+        constexpr explicit expected(in_place_t, initializer_list<U> il, Args&&... args)
+        requires(std::is_constructible_v<T, initializer_list<U>&, Args...>)
+            : _value(il, std::forward<Args>(args)...), _error() {
+            assert(has_value());
+        }
+
+        template <class... Args>
+        constexpr explicit expected(unexpect_t tag, Args&&... args)
+        requires(std::is_constructible_v<E, Args...>)
+            : _value(niche_traits<T>::niche()), _error(std::forward<Args>(args)...) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class U, class... Args>
+        constexpr explicit expected(unexpect_t tag, initializer_list<U> il, Args&&... args)
+        requires(std::is_constructible_v<E, initializer_list<U>&, Args...>)
+            : _value(niche_traits<T>::niche()), _error(il, std::forward<Args>(args)...) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, F&& f, Args&&... args)
+        requires(detail::is_invoke_constructible_v<T, F, Args...>)
+            : _value(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)), _error() {
+            assert(has_value());
+        }
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, unexpect_t tag, F&& f, Args&&... args)
+        requires(detail::is_invoke_constructible_v<E, F, Args...>)
+            : _value(niche_traits<T>::niche()), _error(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        // Destructor
+        KZ_CONSTEXPR_DESTRUCTOR ~expected() = default;
+
+        // Assignment
+        constexpr expected& operator=(const expected&) = default;
+        constexpr expected& operator=(expected&&) = default;
+
+        template <class U = T>
+        constexpr expected& operator=(U&& v)
+        requires(
+            !std::is_same_v<expected, std::remove_cvref_t<U>> &&
+            !detail::is_specialization<std::remove_cvref_t<U>, unexpected>::value &&
+            std::is_constructible_v<T, U> &&
+            std::is_assignable_v<T&, U>) {
+            if (has_value()) {
+                _value = std::forward<U>(v);
+            } else {
+                construct_value(std::forward<U>(v));
+            }
+            assert(has_value());
+            return *this;
+        }
+
+        template <class G>
+        constexpr expected& operator=(const unexpected<G>& e)
+        requires(
+            std::is_constructible_v<E, const G&> &&
+            std::is_assignable_v<E&, const G&>) {
+            if (has_value()) {
+                construct_error(std::forward<const G&>(e.value()));
+            } else {
+                _error = std::forward<const G&>(e.value());
+            }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+            return *this;
+        }
+
+        template <class G>
+        constexpr expected& operator=(unexpected<G>&& e)
+        requires(
+            std::is_constructible_v<E, G> &&
+            std::is_assignable_v<E&, G>) {
+            if (has_value()) {
+                construct_error(std::forward<G>(e.value()));
+            } else {
+                _error = std::forward<G>(e.value());
+            }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+            return *this;
+        }
+
+        // Modifiers
+        template <class... Args>
+        constexpr T& emplace(Args&&... args) noexcept
+        requires(std::is_nothrow_constructible_v<T, Args...>) {
+            construct_value(std::forward<Args>(args)...);
+            return _value;
+        }
+
+        template <class U, class... Args>
+        constexpr T& emplace(initializer_list<U> il, Args&&... args) noexcept
+        requires(std::is_nothrow_constructible_v<T, std::initializer_list<U>&, Args...>) {
+            construct_value(il, std::forward<Args>(args)...);
+            return _value;
+        }
+
+        // Swap
+        constexpr void swap(expected& rhs) noexcept {
+            KZ_EXPECTED_SWAP_ORIGIN(rhs);
+            using std::swap;
+            swap(_value, rhs._value);
+            swap(_error, rhs._error);
+        }
+
+        friend constexpr void swap(expected& x, expected& y) noexcept {
+            x.swap(y);
+        }
+
+        // Observers
+        constexpr const T*  operator->() const noexcept    { return std::addressof(_value); }
+        constexpr T*        operator->() noexcept          { return std::addressof(_value); }
+        constexpr const T&  operator*() const&             { return _value; }
+        constexpr T&        operator*() &                  { return _value; }
+        constexpr const T&& operator*() const&&            { return std::move(_value); }
+        constexpr T&&       operator*() &&                 { return std::move(_value); }
+        constexpr explicit  operator bool() const noexcept { return has_value(); }
+        constexpr bool      has_value() const noexcept     { return !niche_traits<T>::is_niche(_value); }
+
+        constexpr const T& value() const& {
+            if (KZ_UNLIKELY(!has_value())) KZ_THROW_BAD_EXPECTED_ACCESS(_error);
+            return _value;
+        }
+
+        constexpr T& value() & {
+            if (KZ_UNLIKELY(!has_value())) KZ_THROW_BAD_EXPECTED_ACCESS(_error);
+            return _value;
+        }
+
+        constexpr const T&& value() const&& {
+            if (KZ_UNLIKELY(!has_value())) KZ_THROW_BAD_EXPECTED_ACCESS(std::move(_error));
+            return std::move(_value);
+        }
+
+        constexpr T&& value() && {
+            if (KZ_UNLIKELY(!has_value())) KZ_THROW_BAD_EXPECTED_ACCESS(std::move(_error));
+            return std::move(_value);
+        }
+
+        constexpr const E&  error() const&  { return _error; }
+        constexpr E&        error() &       { return _error; }
+        constexpr const E&& error() const&& { return std::move(_error); }
+        constexpr E&&       error() &&      { return std::move(_error); }
+
+        template <class U>
+        constexpr T value_or(U&& v) const & {
+            return has_value() ? _value : static_cast<T>(std::forward<U>(v));
+        }
+
+        template <class U>
+        constexpr T value_or(U&& v) && {
+            return has_value() ? std::move(_value) : static_cast<T>(std::forward<U>(v));
+        }
+
+        template<class G = E>
+        constexpr E error_or(G&& e) const &
+        {
+            return has_value() ? std::forward<G>(e) :  _error;
+        }
+
+        template<class G = E>
+        constexpr E error_or(G&& e) &&
+        {
+            return has_value() ? std::forward<G>(e) :  std::move(_error);
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, const E&>, T>)
+        constexpr T value_or_else(F&& f) const & {
+            if (has_value())
+                return _value;
+            return static_cast<T>(detail::invoke_fallback(std::forward<F>(f), _error));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, E&&>, T>)
+        constexpr T value_or_else(F&& f) && {
+            if (has_value())
+                return std::move(_value);
+            return static_cast<T>(detail::invoke_fallback(std::forward<F>(f), std::move(_error)));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, const T&>, E>)
+        constexpr E error_or_else(F&& f) const & {
+            if (!has_value())
+                return _error;
+            return static_cast<E>(detail::invoke_fallback(std::forward<F>(f), _value));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, T&&>, E>)
+        constexpr E error_or_else(F&& f) && {
+            if (!has_value())
+                return std::move(_error);
+            return static_cast<E>(detail::invoke_fallback(std::forward<F>(f), std::move(_value)));
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f) &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
+            return has_value() ? std::invoke(std::forward<F>(f), value()) : U(detail::unexpect_from(*this), error());
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f) const &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
+            return has_value() ? std::invoke(std::forward<F>(f), value()) : U(detail::unexpect_from(*this), error());
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f) &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
+            return has_value() ? std::invoke(std::forward<F>(f), std::move(value())) : U(detail::unexpect_from(*this), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f) const &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
+            return has_value() ? std::invoke(std::forward<F>(f), std::move(value())) : U(detail::unexpect_from(*this), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? G(std::in_place, value()) : std::invoke(std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) const &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? G(std::in_place, value()) : std::invoke(std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? G(std::in_place, std::move(value())) : std::invoke(std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) const &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? G(std::in_place, std::move(value())) : std::invoke(std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), error());
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), value());
+            else
+            {
+                std::invoke(std::forward<F>(f), value());
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) const &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(value())>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), error());
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), value());
+            else
+            {
+                std::invoke(std::forward<F>(f), value());
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), std::move(value()));
+            else
+            {
+                std::invoke(std::forward<F>(f), std::move(value()));
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) const &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(value()))>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), std::move(value()));
+            else
+            {
+                std::invoke(std::forward<F>(f), std::move(value()));
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? expected<T,G>(std::in_place, value()) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) const &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? expected<T,G>(std::in_place, value()) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? expected<T,G>(std::in_place, std::move(value())) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) const &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? expected<T,G>(std::in_place, std::move(value())) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
+        }
+
+        // Equality operators
+        template <class T2, class E2>
+        requires(!std::is_void_v<T2>)
+        friend constexpr bool operator==(const expected& x, const expected<T2, E2>& y) {
+            if (x.has_value())
+                return y.has_value() && static_cast<bool>(x.value() == y.value());
+            else
+                return !y.has_value() && static_cast<bool>(x.error() == y.error());
+        }
+
+        template <class T2>
+        friend constexpr bool operator==(const expected& x, const T2& v) {
+            return x.has_value() && static_cast<bool>(*x == v);
+        }
+
+        template <class E2>
+        friend constexpr bool operator==(const expected& x, const unexpected<E2>& e) {
+            return !x.has_value() && static_cast<bool>(x.error() == e.value());
+        }
+
+#if defined(__GNUC__) && __GNUC__ < 10 && !defined(__clang__)
+        template <class T2, class E2>
+        requires(!std::is_void_v<T2>)
+        friend constexpr bool operator!=(const expected& x, const expected<T2, E2>& y) {
+            return !(x == y);
+        }
+
+        template <class T2>
+        friend constexpr bool operator!=(const expected& x, const T2& v) {
+            return !(x == v);
+        }
+
+        template <class E2>
+        friend constexpr bool operator!=(const expected& x, const unexpected<E2>& e) {
+            return !(x == e);
+        }
+#endif
+
+    private:
+        template <class... Args>
+        constexpr void construct_value(Args&&... args) {
+            detail::construct_at(std::addressof(_value), std::forward<Args>(args)...);
+            assert(has_value());
+        }
+
+        template <class... Args>
+        constexpr void construct_error(Args&&... args) {
+            detail::construct_at(std::addressof(_value), niche_traits<T>::niche());
+            detail::construct_at(std::addressof(_error), std::forward<Args>(args)...);
+        }
+
+        T _value;
+        KZ_NO_UNIQUE_ADDRESS E _error;
+#if KZ_EXPECTED_TRACK_ORIGIN
+        std::uint32_t _origin = 0;
+        friend struct detail::origin_access;
+#endif
+    };
+
+    /*
+        Partial specialization for void types with an error type that has a
+        niche (see niche_traits<>). The niche value of the error means "no
+        error": no separate discriminant is stored and sizeof(expected) ==
+        sizeof(E).
+    */
+
+    template <class T, class E>
+    requires(detail::is_niche_error_v<T, E>)
+    class expected<T, E> {
+    public:
+        using value_type = T;
+        using error_type = E;
+        using unexpected_type = unexpected<E>;
+
+        template <class U>
+        using rebind = expected<U, error_type>;
+
+        // Constructors
+        constexpr expected() noexcept : _error(niche_traits<E>::niche()) {}
+
+        constexpr expected(const expected&) = default;
+        constexpr expected(expected&&) = default;
+
+        template <class U, class G>
+        constexpr explicit(!std::is_convertible_v<const G&, E>)
+        expected(const expected<U, G>& rhs)
+        requires(
+                std::is_void_v<U> &&
+                std::is_constructible_v<E, const G&> &&
+                !std::is_constructible_v<unexpected<E>, expected<U, G>&> &&
+                !std::is_constructible_v<unexpected<E>, expected<U, G>> &&
+                !std::is_constructible_v<unexpected<E>, const expected<U, G>&> &&
+                !std::is_constructible_v<unexpected<E>, const expected<U, G>>)
+            : _error(niche_traits<E>::niche()) {
+            if (!bool(rhs)) {
+                construct_error(std::forward<const G&>(rhs.error()));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        template <class U, class G>
+        constexpr explicit(!std::is_convertible_v<G, E>)
+        expected(expected<U, G>&& rhs)
+        requires(
+                std::is_void_v<U> &&
+                std::is_constructible_v<E, G> &&
+                !std::is_constructible_v<unexpected<E>, expected<U, G>&> &&
+                !std::is_constructible_v<unexpected<E>, expected<U, G>> &&
+                !std::is_constructible_v<unexpected<E>, const expected<U, G>&> &&
+                !std::is_constructible_v<unexpected<E>, const expected<U, G>>)
+            : _error(niche_traits<E>::niche()) {
+            if (!bool(rhs)) {
+                construct_error(std::forward<G>(rhs.error()));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        template <class G>
+        constexpr explicit(!std::is_convertible_v<const G&, E>)
+        expected(const unexpected<G>& e)
+        requires(std::is_constructible_v<E, const G&>)
+            : _error(std::forward<const G&>(e.value())) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
+
+        template <class G>
+        constexpr explicit(!std::is_convertible_v<G, E>)
+        expected(unexpected<G>&& e)
+        requires(std::is_constructible_v<E, G>)
+            : _error(std::forward<G>(e.value())) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
+
+        constexpr explicit expected(in_place_t) noexcept : _error(niche_traits<E>::niche()) {}
+
+        template <class... Args>
+        constexpr explicit expected(unexpect_t tag, Args&&... args)
+        requires(std::is_constructible_v<E, Args...>)
+            : _error(std::forward<Args>(args)...) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class U, class... Args>
+        constexpr explicit expected(unexpect_t tag, initializer_list<U> il, Args&&... args)
+            requires(std::is_constructible_v<E, initializer_list<U>&, Args...>)
+            : _error(il, std::forward<Args>(args)...) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, unexpect_t tag, F&& f, Args&&... args)
+        requires(detail::is_invoke_constructible_v<E, F, Args...>)
+            : _error(std::invoke(std::forward<F>(f), std::forward<Args>(args)...)) {
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        // Destructor
+        KZ_CONSTEXPR_DESTRUCTOR ~expected() = default;
+
+        // Assignment
+        constexpr expected& operator=(const expected&) = default;
+        constexpr expected& operator=(expected&&) = default;
+
+        template <class G>
+        constexpr expected& operator=(const unexpected<G>& e)
+        requires(
+                std::is_constructible_v<E, const G&> &&
+                std::is_assignable_v<E&, const G&>) {
+            if (has_value()) {
+                construct_error(std::forward<const G&>(e.value()));
+            } else {
+                _error = std::forward<const G&>(e.value());
+            }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+            return *this;
+        }
+
+        template <class G>
+        constexpr expected& operator=(unexpected<G>&& e)
+        requires(
+            std::is_constructible_v<E, G> &&
+            std::is_assignable_v<E&, G>) {
+            if (has_value()) {
+                construct_error(std::forward<G>(e.value()));
+            } else {
+                _error = std::forward<G>(e.value());
+            }
+            KZ_EXPECTED_ON_ERROR(_error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+            return *this;
+        }
+
+        // Modifiers
+        constexpr void emplace() noexcept {
+            construct_value();
+        }
+
+        // Swap
+        constexpr void swap(expected& rhs) noexcept {
+            KZ_EXPECTED_SWAP_ORIGIN(rhs);
+            using std::swap;
+            swap(_error, rhs._error);
+        }
+
+        friend constexpr void swap(expected& x, expected& y) noexcept {
+            x.swap(y);
+        }
+
+        // Observers
+        constexpr explicit operator bool() const noexcept { return has_value(); }
+        constexpr bool has_value() const noexcept         { return niche_traits<E>::is_niche(_error); }
+        constexpr void operator*() const noexcept         {}
+
+        constexpr void value() const& {
+            if (KZ_UNLIKELY(!has_value())) KZ_THROW_BAD_EXPECTED_ACCESS(_error);
+        }
+
+        constexpr void value() && {
+            if (KZ_UNLIKELY(!has_value())) KZ_THROW_BAD_EXPECTED_ACCESS(std::move(_error));
+        }
+
+        constexpr const E&  error() const&  { return _error; }
+        constexpr E&        error() &       { return _error; }
+        constexpr const E&& error() const&& { return std::move(_error); }
+        constexpr E&&       error() &&      { return std::move(_error); }
+
+        template<class G = E>
+        constexpr E error_or(G&& e) const &
+        {
+            return has_value() ? std::forward<G>(e) :  _error;
+        }
+
+        template<class G = E>
+        constexpr E error_or(G&& e) &&
+        {
+            return has_value() ? std::forward<G>(e) :  std::move(_error);
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<std::invoke_result_t<F>, E>)
+        constexpr E error_or_else(F&& f) const & {
+            if (!has_value())
+                return _error;
+            return static_cast<E>(std::invoke(std::forward<F>(f)));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<std::invoke_result_t<F>, E>)
+        constexpr E error_or_else(F&& f) && {
+            if (!has_value())
+                return std::move(_error);
+            return static_cast<E>(std::invoke(std::forward<F>(f)));
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f) &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+            return has_value() ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), error());
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f) const &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+            return has_value() ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), error());
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f)  &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+            return has_value() ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto and_then(F&& f) const &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+            return has_value() ? std::invoke(std::forward<F>(f)) : U(detail::unexpect_from(*this), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? G() : std::invoke(std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) const &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? G() : std::invoke(std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? G() : std::invoke(std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) const &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? G() : std::invoke(std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), error());
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
+            else
+            {
+                std::invoke(std::forward<F>(f));
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) const &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), error());
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
+            else
+            {
+                std::invoke(std::forward<F>(f));
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
+            else
+            {
+                std::invoke(std::forward<F>(f));
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform(F&& f) const &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+
+            if (!has_value())
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f));
+            else
+            {
+                std::invoke(std::forward<F>(f));
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) const &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return has_value() ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) const &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return has_value() ? expected<T,G>() : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
+        }
+
+        // Equality operators
+        template <class T2, class E2>
+        requires(std::is_void_v<T2>)
+        friend constexpr bool operator==(const expected& x, const expected<T2, E2>& y) {
+            if (x.has_value())
+                return y.has_value();
+            else
+                return !y.has_value() &&
+                       static_cast<bool>(x.error() == y.error());
+        }
+
+        template <class E2>
+        friend constexpr bool operator==(const expected& x, const unexpected<E2>& e) {
+            return !x.has_value() && static_cast<bool>(x.error() == e.value());
+        }
+
+#if defined(__GNUC__) && __GNUC__ < 10 && !defined(__clang__)
+        template <class T2, class E2>
+        requires(std::is_void_v<T2>)
+        friend constexpr bool operator!=(const expected& x, const expected<T2, E2>& y) {
+            return !(x == y);
+        }
+
+        template <class E2>
+        friend constexpr bool operator!=(const expected& x, const unexpected<E2>& e) {
+            return !(x == e);
+        }
+#endif
+
+    private:
+        constexpr void construct_value() {
+            detail::construct_at(std::addressof(_error), niche_traits<E>::niche());
+        }
+
+        template <class... Args>
+        constexpr void construct_error(Args&&... args) {
+            detail::construct_at(
+                std::addressof(_error), std::forward<Args>(args)...);
+        }
+
+        E _error;
+#if KZ_EXPECTED_TRACK_ORIGIN
+        std::uint32_t _origin = 0;
+        friend struct detail::origin_access;
+#endif
+    };
+
+    /*
+        Partial specialization for lvalue references. The value is stored as a
+        pointer that doubles as the discriminant: it is null when holding an
+        error. Assigning a value rebinds the reference.
+    */
+
+    template <class T, class E>
+    requires(std::is_lvalue_reference_v<T>)
+    class expected<T, E> {
+        using pointer = std::remove_reference_t<T>*;
+
+    public:
+        using value_type = T;
+        using error_type = E;
+        using unexpected_type = unexpected<E>;
+
+        template <class U>
+        using rebind = expected<U, error_type>;
+
+        // Constructors
+#if KZ_P0848R3
+        constexpr expected(const expected& rhs) noexcept(std::is_nothrow_copy_constructible_v<E>)
+        requires(
+            std::is_copy_constructible_v<E> &&
+            !std::is_trivially_copy_constructible_v<E>)
+            : _value(rhs._value) {
+            if (!rhs._value) {
+                construct_error(rhs._slot._error);
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        constexpr expected(const expected&) noexcept
+        requires(std::is_trivially_copy_constructible_v<E>) = default;
+
+        constexpr expected(const expected&)
+        requires(!std::is_copy_constructible_v<E>) = delete;
+#else
+        constexpr expected(const expected& rhs) noexcept(std::is_nothrow_copy_constructible_v<E>)
+        requires(std::is_copy_constructible_v<E>)
+            : _value(rhs._value) {
+            if (!rhs._value) {
+                construct_error(rhs._slot._error);
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+#endif
+
+#if KZ_P0848R3
+        constexpr expected(expected&& rhs) noexcept(std::is_nothrow_move_constructible_v<E>)
+        requires(
+            std::is_move_constructible_v<E> &&
+            !std::is_trivially_move_constructible_v<E>)
+            : _value(rhs._value) {
+            if (!rhs._value) {
+                construct_error(std::move(rhs._slot._error));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        constexpr expected(expected&&) noexcept
+        requires(std::is_trivially_move_constructible_v<E>) = default;
+#else
+        constexpr expected(expected&& rhs) noexcept(std::is_nothrow_move_constructible_v<E>)
+        requires(std::is_move_constructible_v<E>)
+            : _value(rhs._value) {
+            if (!rhs._value) {
+                construct_error(std::move(rhs._slot._error));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+#endif
+
+        template <class U, class G>
+        constexpr explicit(!std::is_convertible_v<const G&, E>)
+        expected(const expected<U, G>& rhs)
+        requires(
+            std::is_lvalue_reference_v<U> &&
+            std::is_convertible_v<std::remove_reference_t<U>*, pointer> &&
+            std::is_constructible_v<E, const G&>)
+            : _value(nullptr) {
+            if (rhs.has_value()) {
+                _value = std::addressof(*rhs);
+            } else {
+                construct_error(std::forward<const G&>(rhs.error()));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        template <class U, class G>
+        constexpr explicit(!std::is_convertible_v<G, E>)
+        expected(expected<U, G>&& rhs)
+        requires(
+            std::is_lvalue_reference_v<U> &&
+            std::is_convertible_v<std::remove_reference_t<U>*, pointer> &&
+            std::is_constructible_v<E, G>)
+            : _value(nullptr) {
+            if (rhs.has_value()) {
+                _value = std::addressof(*rhs);
+            } else {
+                construct_error(std::forward<G>(rhs.error()));
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+        }
+
+        template <class U>
+        constexpr expected(U& v) noexcept
+        requires(std::is_convertible_v<U*, pointer>)
+            : _value(std::addressof(v)) {}
+
+        template <class G>
+        constexpr explicit(!std::is_convertible_v<const G&, E>)
+        expected(const unexpected<G>& e)
+        requires(std::is_constructible_v<E, const G&>)
+            : _value(nullptr) {
+            construct_error(std::forward<const G&>(e.value()));
+            KZ_EXPECTED_ON_ERROR(_slot._error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
+
+        template <class G>
+        constexpr explicit(!std::is_convertible_v<G, E>)
+        expected(unexpected<G>&& e)
+        requires(std::is_constructible_v<E, G>)
+            : _value(nullptr) {
+            construct_error(std::forward<G>(e.value()));
+            KZ_EXPECTED_ON_ERROR(_slot._error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+        }
+
+        template <class U>
+        constexpr explicit expected(in_place_t, U& v) noexcept
+        requires(std::is_convertible_v<U*, pointer>)
+            : _value(std::addressof(v)) {}
+
+        template <class... Args>
+        constexpr explicit expected(unexpect_t tag, Args&&... args)
+        requires(std::is_constructible_v<E, Args...>)
+            : _value(nullptr) {
+            construct_error(std::forward<Args>(args)...);
+            KZ_EXPECTED_ON_ERROR(_slot._error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class U, class... Args>
+        constexpr explicit expected(unexpect_t tag, initializer_list<U> il, Args&&... args)
+        requires(std::is_constructible_v<E, initializer_list<U>&, Args...>)
+            : _value(nullptr) {
+            construct_error(il, std::forward<Args>(args)...);
+            KZ_EXPECTED_ON_ERROR(_slot._error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, F&& f, Args&&... args)
+        requires(std::is_lvalue_reference_v<std::invoke_result_t<F, Args...>> &&
+                 std::is_convertible_v<std::remove_reference_t<std::invoke_result_t<F, Args...>>*, pointer>)
+            : _value(std::addressof(std::invoke(std::forward<F>(f), std::forward<Args>(args)...))) {}
+
+        template <class F, class... Args>
+        constexpr explicit expected(invoke_tag_t, unexpect_t tag, F&& f, Args&&... args)
+        requires(detail::is_invoke_constructible_v<E, F, Args...>)
+            : _value(nullptr), _slot(invoke_tag, std::forward<F>(f), std::forward<Args>(args)...) {
+            KZ_EXPECTED_ON_ERROR(_slot._error);
+            KZ_EXPECTED_COPY_ORIGIN(tag);
+        }
+
+        // Destructor
+        KZ_CONSTEXPR_DESTRUCTOR ~expected() {
+            if (!_value) {
+                detail::destroy_at(std::addressof(_slot._error));
+            }
+        }
+
+#if KZ_P0848R3
+        KZ_CONSTEXPR_DESTRUCTOR ~expected()
+        requires(std::is_trivially_destructible_v<E>) = default;
+#endif
+
+        // Assignment
+        constexpr expected& operator=(const expected& rhs) noexcept(
+            std::is_nothrow_copy_assignable_v<E> &&
+            std::is_nothrow_copy_constructible_v<E>)
+        requires(
+            std::is_copy_assignable_v<E> &&
+            std::is_copy_constructible_v<E>
+#if KZ_P0848R3
+            && !detail::is_trivially_copy_assignable_expected_v<pointer, E>
+#endif
+            ) {
+            if (rhs._value) {
+                assign_value(rhs._value);
+            } else if (_value) {
+                construct_error(rhs._slot._error);
+            } else {
+                _slot._error = rhs._slot._error;
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+            return *this;
+        }
+
+#if KZ_P0848R3
+        constexpr expected& operator=(const expected&) noexcept
+        requires(detail::is_trivially_copy_assignable_expected_v<pointer, E>) = default;
+#endif
+
+        constexpr expected& operator=(const expected&) = delete;
+
+        constexpr expected& operator=(expected&& rhs) noexcept(
+            std::is_nothrow_move_assignable_v<E> &&
+            std::is_nothrow_move_constructible_v<E>)
+        requires(
+            std::is_move_constructible_v<E> &&
+            std::is_move_assignable_v<E>
+#if KZ_P0848R3
+            && !detail::is_trivially_move_assignable_expected_v<pointer, E>
+#endif
+            ) {
+            if (rhs._value) {
+                assign_value(rhs._value);
+            } else if (_value) {
+                construct_error(std::move(rhs._slot._error));
+            } else {
+                _slot._error = std::move(rhs._slot._error);
+            }
+            KZ_EXPECTED_COPY_ORIGIN(rhs);
+            return *this;
+        }
+
+#if KZ_P0848R3
+        constexpr expected& operator=(expected&&) noexcept
+        requires(detail::is_trivially_move_assignable_expected_v<pointer, E>) = default;
+#endif
+
+        template <class U>
+        constexpr expected& operator=(U& v) noexcept
+        requires(
+            !std::is_same_v<expected, std::remove_cv_t<U>> &&
+            std::is_convertible_v<U*, pointer>) {
+            assign_value(std::addressof(v));
+            return *this;
+        }
+
+        template <class G>
+        constexpr expected& operator=(const unexpected<G>& e)
+        requires(
+            std::is_constructible_v<E, const G&> &&
+            std::is_assignable_v<E&, const G&>) {
+            if (_value) {
+                construct_error(std::forward<const G&>(e.value()));
+            } else {
+                _slot._error = std::forward<const G&>(e.value());
+            }
+            KZ_EXPECTED_ON_ERROR(_slot._error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+            return *this;
+        }
+
+        template <class G>
+        constexpr expected& operator=(unexpected<G>&& e)
+        requires(
+            std::is_constructible_v<E, G> &&
+            std::is_assignable_v<E&, G>) {
+            if (_value) {
+                construct_error(std::forward<G>(e.value()));
+            } else {
+                _slot._error = std::forward<G>(e.value());
+            }
+            KZ_EXPECTED_ON_ERROR(_slot._error);
+            KZ_EXPECTED_COPY_ORIGIN(e);
+            return *this;
+        }
+
+        // Modifiers
+        template <class U>
+        constexpr T emplace(U& v) noexcept
+        requires(std::is_convertible_v<U*, pointer>) {
+            assign_value(std::addressof(v));
+            return *_value;
+        }
+
+        // Swap
+        constexpr void swap(expected& rhs) noexcept(
+            std::is_nothrow_move_constructible_v<E> &&
+            std::is_nothrow_swappable_v<E>)
+        requires(
+            std::is_swappable_v<E> &&
+            std::is_move_constructible_v<E>) {
+            KZ_EXPECTED_SWAP_ORIGIN(rhs);
+            if (_value) {
+                if (rhs._value) {
+                    std::swap(_value, rhs._value);
+                } else {
+                    pointer tmp = _value;
+                    construct_error(std::move(rhs._slot._error));
+                    rhs.assign_value(tmp);
+                }
+            } else {
+                if (rhs._value) {
+                    rhs.swap(*this);
+                } else {
+                    using std::swap;
+                    swap(_slot._error, rhs._slot._error);
+                }
+            }
+        }
+
+        friend constexpr void swap(expected& x, expected& y) noexcept(noexcept(x.swap(y))) {
+            x.swap(y);
+        }
+
+        // Observers
+        constexpr pointer  operator->() const noexcept     { return _value; }
+        constexpr T        operator*() const noexcept      { return *_value; }
+        constexpr explicit operator bool() const noexcept  { return _value != nullptr; }
+        constexpr bool     has_value() const noexcept      { return _value != nullptr; }
+
+        constexpr T value() const& {
+            if (KZ_UNLIKELY(!_value)) KZ_THROW_BAD_EXPECTED_ACCESS(_slot._error);
+            return *_value;
+        }
+
+        constexpr T value() && {
+            if (KZ_UNLIKELY(!_value)) KZ_THROW_BAD_EXPECTED_ACCESS(std::move(_slot._error));
+            return *_value;
+        }
+
+        constexpr const E&  error() const&  { return _slot._error; }
+        constexpr E&        error() &       { return _slot._error; }
+        constexpr const E&& error() const&& { return std::move(_slot._error); }
+        constexpr E&&       error() &&      { return std::move(_slot._error); }
+
+        template <class U>
+        constexpr std::remove_cvref_t<T> value_or(U&& v) const {
+            return _value ? *_value : static_cast<std::remove_cvref_t<T>>(std::forward<U>(v));
+        }
+
+        template<class G = E>
+        constexpr E error_or(G&& e) const &
+        {
+            return _value ? std::forward<G>(e) :  _slot._error;
+        }
+
+        template<class G = E>
+        constexpr E error_or(G&& e) &&
+        {
+            return _value ? std::forward<G>(e) :  std::move(_slot._error);
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, const E&>, std::remove_cvref_t<T>>)
+        constexpr std::remove_cvref_t<T> value_or_else(F&& f) const {
+            if (_value)
+                return *_value;
+            return static_cast<std::remove_cvref_t<T>>(detail::invoke_fallback(std::forward<F>(f), _slot._error));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, T>, E>)
+        constexpr E error_or_else(F&& f) const & {
+            if (!_value)
+                return _slot._error;
+            return static_cast<E>(detail::invoke_fallback(std::forward<F>(f), *_value));
+        }
+
+        template <class F>
+        requires(std::is_convertible_v<detail::fallback_result_t<F, T>, E>)
+        constexpr E error_or_else(F&& f) && {
+            if (!_value)
+                return std::move(_slot._error);
+            return static_cast<E>(detail::invoke_fallback(std::forward<F>(f), *_value));
+        }
+
+        template <class F>
+        requires(std::is_copy_constructible_v<E>)
+        constexpr auto and_then(F&& f) &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, T>>;
+            return _value ? std::invoke(std::forward<F>(f), *_value) : U(detail::unexpect_from(*this), error());
+        }
+
+        template <class F>
+        requires(std::is_copy_constructible_v<E>)
+        constexpr auto and_then(F&& f) const &
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, T>>;
+            return _value ? std::invoke(std::forward<F>(f), *_value) : U(detail::unexpect_from(*this), error());
+        }
+
+        template <class F>
+        requires(std::is_move_constructible_v<E>)
+        constexpr auto and_then(F&& f) &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, T>>;
+            return _value ? std::invoke(std::forward<F>(f), *_value) : U(detail::unexpect_from(*this), std::move(error()));
+        }
+
+        template <class F>
+        requires(std::is_move_constructible_v<E>)
+        constexpr auto and_then(F&& f) const &&
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, T>>;
+            return _value ? std::invoke(std::forward<F>(f), *_value) : U(detail::unexpect_from(*this), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return _value ? G(std::in_place, *_value) : std::invoke(std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) const &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return _value ? G(std::in_place, *_value) : std::invoke(std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return _value ? G(std::in_place, *_value) : std::invoke(std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto or_else(F&& f) const &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return _value ? G(std::in_place, *_value) : std::invoke(std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        requires(std::is_copy_constructible_v<E>)
+        constexpr auto transform(F&& f) &
+        {
+            using U = detail::transform_value_t<std::invoke_result_t<F, T>>;
+
+            if (!_value)
+                return expected<U,E>(detail::unexpect_from(*this), error());
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), *_value);
+            else
+            {
+                std::invoke(std::forward<F>(f), *_value);
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        requires(std::is_copy_constructible_v<E>)
+        constexpr auto transform(F&& f) const &
+        {
+            using U = detail::transform_value_t<std::invoke_result_t<F, T>>;
+
+            if (!_value)
+                return expected<U,E>(detail::unexpect_from(*this), error());
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), *_value);
+            else
+            {
+                std::invoke(std::forward<F>(f), *_value);
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        requires(std::is_move_constructible_v<E>)
+        constexpr auto transform(F&& f) &&
+        {
+            using U = detail::transform_value_t<std::invoke_result_t<F, T>>;
+
+            if (!_value)
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), *_value);
+            else
+            {
+                std::invoke(std::forward<F>(f), *_value);
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        requires(std::is_move_constructible_v<E>)
+        constexpr auto transform(F&& f) const &&
+        {
+            using U = detail::transform_value_t<std::invoke_result_t<F, T>>;
+
+            if (!_value)
+                return expected<U,E>(detail::unexpect_from(*this), std::move(error()));
+
+            if constexpr (!std::is_void_v<U>)
+                return expected<U,E>(invoke_tag, std::forward<F>(f), *_value);
+            else
+            {
+                std::invoke(std::forward<F>(f), *_value);
+                return expected<U,E>();
+            }
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return _value ? expected<T,G>(std::in_place, *_value) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) const &
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(error())>>;
+            return _value ? expected<T,G>(std::in_place, *_value) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), error());
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return _value ? expected<T,G>(std::in_place, *_value) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
+        }
+
+        template <class F>
+        constexpr auto transform_error(F&& f) const &&
+        {
+            using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::move(error()))>>;
+            return _value ? expected<T,G>(std::in_place, *_value) : expected<T,G>(invoke_tag, detail::unexpect_from(*this), std::forward<F>(f), std::move(error()));
+        }
+
+        // Equality operators
+        template <class T2, class E2>
+        requires(!std::is_void_v<T2>)
+        friend constexpr bool operator==(const expected& x, const expected<T2, E2>& y) {
+            if (x.has_value())
+                return y.has_value() && static_cast<bool>(*x == *y);
+            else
+                return !y.has_value() && static_cast<bool>(x.error() == y.error());
+        }
+
+        template <class T2>
+        friend constexpr bool operator==(const expected& x, const T2& v) {
+            return x.has_value() && static_cast<bool>(*x == v);
+        }
+
+        template <class E2>
+        friend constexpr bool operator==(const expected& x, const unexpected<E2>& e) {
+            return !x.has_value() && static_cast<bool>(x.error() == e.value());
+        }
+
+#if defined(__GNUC__) && __GNUC__ < 10 && !defined(__clang__)
+        template <class T2, class E2>
+        requires(!std::is_void_v<T2>)
+        friend constexpr bool operator!=(const expected& x, const expected<T2, E2>& y) {
+            return !(x == y);
+        }
+
+        template <class T2>
+        friend constexpr bool operator!=(const expected& x, const T2& v) {
+            return !(x == v);
+        }
+
+        template <class E2>
+        friend constexpr bool operator!=(const expected& x, const unexpected<E2>& e) {
+            return !(x == e);
+        }
+#endif
+
+    private:
+        constexpr void assign_value(pointer p) noexcept {
+            if (!_value) {
+                detail::destroy_at(std::addressof(_slot._error));
+            }
+            _value = p;
+        }
+
+        template <class... Args>
+        constexpr void construct_error(Args&&... args) {
+            detail::construct_at(std::addressof(_slot._error), std::forward<Args>(args)...);
+            _value = nullptr;
+        }
+
+        pointer _value;
+        KZ_NO_UNIQUE_ADDRESS detail::error_slot<E> _slot;
+#if KZ_EXPECTED_TRACK_ORIGIN
+        std::uint32_t _origin = 0;
+        friend struct detail::origin_access;
+#endif
+    };
+
+    /*
+        expected is trivially relocatable when its alternatives are
+    */
+
+    template <class T, class E>
+    struct is_trivially_relocatable<expected<T, E>>
+        : std::bool_constant<
+            (std::is_void_v<T> || std::is_lvalue_reference_v<T> || is_trivially_relocatable_v<T>) &&
+            is_trivially_relocatable_v<E>> {};
+
+    template <class E>
+    struct is_trivially_relocatable<unexpected<E>> : is_trivially_relocatable<E> {};
+
 } // namespace kz
@@ -0,0 +1,480 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <kz/expected_bits/expected.hpp>
+
+namespace kz {
+
+    /*
+        expected_vector
+
+        A sequence of expected<T, E> stored as a structure of arrays: the
+        values in one contiguous array, the errors in another, and whether
+        each element holds a value in a packed bitmap.
+
+            kz::expected_vector<float, std::uint8_t> samples;
+            samples.push_back(1.5f);
+            samples.push_back(kz::unexpected<std::uint8_t>(3));
+
+            auto scaled = samples.transform_values([](float x) { return x * 2; });
+            std::size_t failures = samples.count_errors();
+
+        There is no padding between elements and loops over the values
+        vectorize. Both arrays have an entry for every element: the value
+        of an element holding an error, and the error of an element holding
+        a value, are value-initialized placeholders. T and E must therefore
+        be default constructible.
+
+        Elements are accessed through proxies that behave like a reference
+        to an expected<T, E>.
+    */
+
+    template <class T, class E>
+    class expected_vector;
+
+    template <class T, class E, bool Const>
+    class expected_vector_reference {
+        using container_type = std::conditional_t<Const, const expected_vector<T, E>, expected_vector<T, E>>;
+        using value_reference = std::conditional_t<Const, const T&, T&>;
+        using error_reference = std::conditional_t<Const, const E&, E&>;
+
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        expected_vector_reference(container_type& container, std::size_t index) noexcept
+            : _container(&container), _index(index) {}
+
+        expected_vector_reference(const expected_vector_reference&) = default;
+
+        // A mutable reference converts to a const one
+        template <bool OtherConst>
+        requires(Const && !OtherConst)
+        expected_vector_reference(const expected_vector_reference<T, E, OtherConst>& rhs) noexcept
+            : _container(rhs._container), _index(rhs._index) {}
+
+        // Assignment stores into the element, like assigning through an expected&
+        const expected_vector_reference& operator=(const expected_vector_reference& rhs) const
+        requires(!Const)
+        {
+            return *this = static_cast<expected<T, E>>(rhs);
+        }
+
+        template <class U, class G>
+        const expected_vector_reference& operator=(const expected<U, G>& rhs) const
+        requires(!Const && std::is_assignable_v<T&, const U&> && std::is_assignable_v<E&, const G&>)
+        {
+            if (rhs.has_value())
+                *this = *rhs;
+            else
+                *this = unexpected<G>(rhs.error());
+            return *this;
+        }
+
+        template <class U>
+        const expected_vector_reference& operator=(U&& value) const
+        requires(!Const && !detail::is_specialization<std::remove_cvref_t<U>, expected>::value &&
+                 !detail::is_specialization<std::remove_cvref_t<U>, unexpected>::value &&
+                 !std::is_same_v<std::remove_cvref_t<U>, expected_vector_reference> &&
+                 std::is_assignable_v<T&, U>)
+        {
+            _container->_values[_index] = std::forward<U>(value);
+            _container->set_has_value(_index, true);
+            return *this;
+        }
+
+        template <class G>
+        const expected_vector_reference& operator=(const unexpected<G>& e) const
+        requires(!Const && std::is_assignable_v<E&, const G&>)
+        {
+            _container->_errors[_index] = e.value();
+            _container->set_has_value(_index, false);
+            return *this;
+        }
+
+        bool has_value() const noexcept { return _container->has_value(_index); }
+        explicit operator bool() const noexcept { return has_value(); }
+
+        value_reference operator*() const noexcept { return _container->_values[_index]; }
+        auto operator->() const noexcept { return std::addressof(_container->_values[_index]); }
+
+        value_reference value() const {
+            if (KZ_UNLIKELY(!has_value())) KZ_THROW_BAD_EXPECTED_ACCESS(std::as_const(error()));
+            return **this;
+        }
+
+        error_reference error() const noexcept { return _container->_errors[_index]; }
+
+        template <class U>
+        T value_or(U&& default_value) const {
+            return has_value() ? **this : static_cast<T>(std::forward<U>(default_value));
+        }
+
+        // A copy of the element
+        operator expected<T, E>() const {
+            if (has_value())
+                return expected<T, E>(std::in_place, **this);
+            return expected<T, E>(unexpect, error());
+        }
+
+        template <class U, class G>
+        friend bool operator==(const expected_vector_reference& x, const expected<U, G>& y) {
+            if (x.has_value() != y.has_value())
+                return false;
+            return x.has_value() ? *x == *y : x.error() == y.error();
+        }
+
+        friend bool operator==(const expected_vector_reference& x, const expected_vector_reference& y) {
+            if (x.has_value() != y.has_value())
+                return false;
+            return x.has_value() ? *x == *y : x.error() == y.error();
+        }
+
+        template <class U>
+        requires(!detail::is_specialization<U, expected>::value && !detail::is_specialization<U, unexpected>::value &&
+                 !std::is_same_v<U, expected_vector_reference<T, E, true>> &&
+                 !std::is_same_v<U, expected_vector_reference<T, E, false>>)
+        friend bool operator==(const expected_vector_reference& x, const U& v) {
+            return x.has_value() && *x == v;
+        }
+
+        template <class G>
+        friend bool operator==(const expected_vector_reference& x, const unexpected<G>& e) {
+            return !x.has_value() && x.error() == e.value();
+        }
+
+    private:
+        template <class, class, bool>
+        friend class expected_vector_reference;
+
+        container_type* _container;
+        std::size_t _index;
+    };
+
+    template <class T, class E, bool Const>
+    class expected_vector_iterator {
+        using container_type = std::conditional_t<Const, const expected_vector<T, E>, expected_vector<T, E>>;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = expected<T, E>;
+        using difference_type = std::ptrdiff_t;
+        using reference = expected_vector_reference<T, E, Const>;
+        using pointer = void;
+
+        expected_vector_iterator() noexcept = default;
+        expected_vector_iterator(container_type* container, std::size_t index) noexcept
+            : _container(container), _index(index) {}
+
+        template <bool OtherConst>
+        requires(Const && !OtherConst)
+        expected_vector_iterator(const expected_vector_iterator<T, E, OtherConst>& rhs) noexcept
+            : _container(rhs._container), _index(rhs._index) {}
+
+        reference operator*() const noexcept { return reference(*_container, _index); }
+        reference operator[](difference_type n) const noexcept { return reference(*_container, _index + n); }
+
+        expected_vector_iterator& operator++() noexcept { ++_index; return *this; }
+        expected_vector_iterator operator++(int) noexcept { auto it = *this; ++_index; return it; }
+        expected_vector_iterator& operator--() noexcept { --_index; return *this; }
+        expected_vector_iterator operator--(int) noexcept { auto it = *this; --_index; return it; }
+        expected_vector_iterator& operator+=(difference_type n) noexcept { _index += n; return *this; }
+        expected_vector_iterator& operator-=(difference_type n) noexcept { _index -= n; return *this; }
+
+        friend expected_vector_iterator operator+(expected_vector_iterator it, difference_type n) noexcept { return it += n; }
+        friend expected_vector_iterator operator+(difference_type n, expected_vector_iterator it) noexcept { return it += n; }
+        friend expected_vector_iterator operator-(expected_vector_iterator it, difference_type n) noexcept { return it -= n; }
+        friend difference_type operator-(const expected_vector_iterator& x, const expected_vector_iterator& y) noexcept {
+            return static_cast<difference_type>(x._index) - static_cast<difference_type>(y._index);
+        }
+
+        friend bool operator==(const expected_vector_iterator& x, const expected_vector_iterator& y) noexcept { return x._index == y._index; }
+        friend auto operator<=>(const expected_vector_iterator& x, const expected_vector_iterator& y) noexcept { return x._index <=> y._index; }
+
+    private:
+        template <class, class, bool>
+        friend class expected_vector_iterator;
+
+        container_type* _container = nullptr;
+        std::size_t _index = 0;
+    };
+
+    template <class T, class E>
+    class expected_vector {
+        static_assert(std::is_default_constructible_v<T> && std::is_default_constructible_v<E>,
+                      "expected_vector stores placeholders: T and E must be default constructible");
+        static_assert(!std::is_same_v<std::remove_cv_t<T>, bool>,
+                      "std::vector<bool> has no contiguous array of values: use expected_vector<char, E>");
+
+        using word_type = std::uint64_t;
+        static constexpr std::size_t word_bits = 64;
+
+    public:
+        using value_type = expected<T, E>;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = expected_vector_reference<T, E, false>;
+        using const_reference = expected_vector_reference<T, E, true>;
+        using iterator = expected_vector_iterator<T, E, false>;
+        using const_iterator = expected_vector_iterator<T, E, true>;
+
+        expected_vector() = default;
+
+        // count elements holding value
+        explicit expected_vector(size_type count, const T& value = T())
+            : _values(count, value), _errors(count), _bits(word_count(count), ~word_type(0)), _size(count) {
+            clear_tail();
+        }
+
+        size_type size() const noexcept { return _size; }
+        bool empty() const noexcept { return _size == 0; }
+        size_type capacity() const noexcept { return _values.capacity(); }
+
+        void reserve(size_type count) {
+            _values.reserve(count);
+            _errors.reserve(count);
+            _bits.reserve(word_count(count));
+        }
+
+        void clear() noexcept {
+            _values.clear();
+            _errors.clear();
+            _bits.clear();
+            _size = 0;
+        }
+
+        reference operator[](size_type i) noexcept { return reference(*this, i); }
+        const_reference operator[](size_type i) const noexcept { return const_reference(*this, i); }
+
+        reference front() noexcept { return (*this)[0]; }
+        const_reference front() const noexcept { return (*this)[0]; }
+        reference back() noexcept { return (*this)[_size - 1]; }
+        const_reference back() const noexcept { return (*this)[_size - 1]; }
+
+        iterator begin() noexcept { return iterator(this, 0); }
+        iterator end() noexcept { return iterator(this, _size); }
+        const_iterator begin() const noexcept { return const_iterator(this, 0); }
+        const_iterator end() const noexcept { return const_iterator(this, _size); }
+        const_iterator cbegin() const noexcept { return begin(); }
+        const_iterator cend() const noexcept { return end(); }
+
+        bool has_value(size_type i) const noexcept {
+            return (_bits[i / word_bits] >> (i % word_bits)) & 1;
+        }
+
+        template <class... Args>
+        requires(std::is_constructible_v<T, Args...>)
+        reference emplace_back(Args&&... args) {
+            _values.emplace_back(std::forward<Args>(args)...);
+            finish_push(_values, _errors, true);
+            return back();
+        }
+
+        template <class... Args>
+        requires(std::is_constructible_v<E, Args...>)
+        reference emplace_back(unexpect_t, Args&&... args) {
+            _errors.emplace_back(std::forward<Args>(args)...);
+            finish_push(_errors, _values, false);
+            return back();
+        }
+
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        template <class G>
+        void push_back(const unexpected<G>& e) { emplace_back(unexpect, e.value()); }
+
+        template <class G>
+        void push_back(unexpected<G>&& e) { emplace_back(unexpect, std::move(e).value()); }
+
+        template <class U, class G>
+        void push_back(const expected<U, G>& e) {
+            if (e.has_value())
+                emplace_back(*e);
+            else
+                emplace_back(unexpect, e.error());
+        }
+
+        template <class U, class G>
+        void push_back(expected<U, G>&& e) {
+            if (e.has_value())
+                emplace_back(*std::move(e));
+            else
+                emplace_back(unexpect, std::move(e).error());
+        }
+
+        void pop_back() noexcept {
+            _values.pop_back();
+            _errors.pop_back();
+            --_size;
+            if (_size % word_bits == 0)
+                _bits.pop_back();
+            else
+                clear_tail();
+        }
+
+        // Dense storage. Entries of elements holding the other alternative are placeholders.
+        std::span<T> values() noexcept { return _values; }
+        std::span<const T> values() const noexcept { return _values; }
+        std::span<E> errors() noexcept { return _errors; }
+        std::span<const E> errors() const noexcept { return _errors; }
+
+        // has_value() of element i is bit i % 64 of word i / 64. Bits past size() are zero.
+        std::span<const word_type> bitmap() const noexcept { return _bits; }
+
+        size_type count_values() const noexcept {
+            size_type count = 0;
+#if defined(__POPCNT__) || defined(__ARM_NEON)
+            for (const word_type word : _bits)
+                count += static_cast<size_type>(std::popcount(word));
+#else
+            // Without a popcount instruction, std::popcount() is a library
+            // call: count the bits with shifts and masks, which vectorizes
+            for (word_type word : _bits) {
+                word = word - ((word >> 1) & 0x5555555555555555ull);
+                word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+                word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0full;
+                count += static_cast<size_type>((word * 0x0101010101010101ull) >> 56);
+            }
+#endif
+            return count;
+        }
+
+        size_type count_errors() const noexcept { return _size - count_values(); }
+
+        /*
+            Apply f to every value, keeping the errors:
+
+                expected_vector<U, E> result = v.transform_values(f);
+
+            f is applied 64 elements at a time: runs of values are a plain
+            loop over the dense array that the compiler vectorizes, and runs
+            of errors are skipped. The value of an element holding an error is
+            a placeholder in the result too.
+        */
+        template <class F>
+        auto transform_values(F&& f) const {
+            using U = std::remove_cvref_t<std::invoke_result_t<F&, const T&>>;
+            expected_vector<U, E> result;
+            result._values.resize(_size);
+            result._errors = _errors;
+            result._bits = _bits;
+            result._size = _size;
+
+            const T* in = _values.data();
+            U* out = result._values.data();
+            for (size_type w = 0; w != _bits.size(); ++w) {
+                const word_type word = _bits[w];
+                const size_type first = w * word_bits;
+                if (word == ~word_type(0)) {
+                    for (size_type i = first; i != first + word_bits; ++i)
+                        out[i] = f(in[i]);
+                } else {
+                    for (word_type bits = word; bits != 0; bits &= bits - 1) {
+                        const size_type i = first + static_cast<size_type>(std::countr_zero(bits));
+                        out[i] = f(in[i]);
+                    }
+                }
+            }
+            return result;
+        }
+
+    private:
+        template <class, class, bool>
+        friend class expected_vector_reference;
+
+        template <class, class>
+        friend class expected_vector;
+
+        static constexpr size_type word_count(size_type count) noexcept { return (count + word_bits - 1) / word_bits; }
+
+        // The element has been pushed to the first array: push a placeholder
+        // to the other one and its bit, or undo the first push if that fails,
+        // so that the arrays always have the same size
+        template <class First, class Second>
+        void finish_push([[maybe_unused]] First& first, Second& second, bool value) {
+#if KZ_EXCEPTIONS
+            try {
+                second.emplace_back();
+            } catch (...) {
+                first.pop_back();
+                throw;
+            }
+            try {
+                push_bit(value);
+            } catch (...) {
+                second.pop_back();
+                first.pop_back();
+                throw;
+            }
+#else
+            second.emplace_back();
+            push_bit(value);
+#endif
+        }
+
+        // Only the push to _bits can throw: nothing changes if it does
+        void push_bit(bool value) {
+            if (_size % word_bits == 0)
+                _bits.push_back(0);
+            ++_size;
+            set_has_value(_size - 1, value);
+        }
+
+        void set_has_value(size_type i, bool value) noexcept {
+            const word_type mask = word_type(1) << (i % word_bits);
+            if (value)
+                _bits[i / word_bits] |= mask;
+            else
+                _bits[i / word_bits] &= ~mask;
+        }
+
+        // Keep the bits past size() at zero
+        void clear_tail() noexcept {
+            if (const size_type used = _size % word_bits)
+                _bits.back() &= (word_type(1) << used) - 1;
+        }
+
+        std::vector<T> _values;
+        std::vector<E> _errors;
+        std::vector<word_type> _bits;
+        size_type _size = 0;
+    };
+
+} // namespace kz
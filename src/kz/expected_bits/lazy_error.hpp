@@ -0,0 +1,215 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <kz/expected_bits/exception.hpp>
+
+namespace kz {
+
+    namespace detail {
+
+        // Arguments that can be captured by value and handed to printf()
+        template <class T>
+        inline constexpr bool is_lazy_format_arg_v =
+            std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>;
+
+        template <class T>
+        constexpr auto lazy_format_arg(T arg) noexcept {
+            if constexpr (std::is_enum_v<T>)
+                return static_cast<std::underlying_type_t<T>>(arg);
+            else
+                return arg;
+        }
+
+    } // namespace detail
+
+    /*
+        lazy_error
+
+        An error code with a printf-style message that is only rendered
+        when somebody asks for it:
+
+            return kz::unexpected(kz::lazy_error(errc::bad_port, "port %d out of range [%d, %d]", port, lo, hi));
+
+        The arguments are captured by value, inline, and formatted the first
+        time message() or what() is called; the result is cached. Error
+        paths that only look at code() (retry, fall back, propagate) never
+        format anything nor touch the heap. bad_expected_access<lazy_error>
+        reports the rendered message from what().
+
+        Only arithmetic, enum and pointer arguments are accepted. The format
+        string and any const char* argument are captured by pointer and must
+        outlive the error: string literals are fine.
+
+        Copies share nothing: a copy renders its own message when asked.
+        Errors compare by code.
+    */
+
+    template <class Code, class... Args>
+    requires(detail::is_lazy_format_arg_v<Args> && ...)
+    class lazy_error {
+    public:
+        using code_type = Code;
+
+        // Constructors
+        lazy_error(Code code, const char* format, Args... args)
+        noexcept(std::is_nothrow_move_constructible_v<Code>)
+            : _code(std::move(code)), _format(format), _args(args...) {}
+
+        lazy_error(const lazy_error& rhs)
+        noexcept(std::is_nothrow_copy_constructible_v<Code>)
+            : _code(rhs._code), _format(rhs._format), _args(rhs._args) {}
+
+        lazy_error(lazy_error&& rhs)
+        noexcept(std::is_nothrow_move_constructible_v<Code>)
+            : _code(std::move(rhs._code)), _format(rhs._format), _args(rhs._args),
+              _message(rhs.release()) {}
+
+        // Destructor
+        ~lazy_error() { delete[] _message.load(std::memory_order_relaxed); }
+
+        // Assignment
+        lazy_error& operator=(const lazy_error& rhs) {
+            if (this != &rhs) {
+                _code = rhs._code;
+                _format = rhs._format;
+                _args = rhs._args;
+                delete[] release();
+            }
+            return *this;
+        }
+
+        lazy_error& operator=(lazy_error&& rhs)
+        noexcept(std::is_nothrow_move_assignable_v<Code>) {
+            if (this != &rhs) {
+                _code = std::move(rhs._code);
+                _format = rhs._format;
+                _args = rhs._args;
+                char* message = rhs.release();
+                delete[] release();
+                _message.store(message, std::memory_order_relaxed);
+            }
+            return *this;
+        }
+
+        // Observers
+        const Code& code() const noexcept { return _code; }
+        const char* format() const noexcept { return _format; }
+        const std::tuple<Args...>& args() const noexcept { return _args; }
+
+        bool rendered() const noexcept {
+            return _message.load(std::memory_order_acquire) != nullptr;
+        }
+
+        // The formatted message. Rendered on the first call, then cached:
+        // concurrent first calls are safe, one of the renderings wins.
+        // Falls back to the raw format string if memory runs out.
+        const char* what() const noexcept {
+            if (const char* message = _message.load(std::memory_order_acquire))
+                return message;
+            return render();
+        }
+
+        std::string_view message() const noexcept { return what(); }
+
+        friend bool operator==(const lazy_error& x, const lazy_error& y) {
+            return static_cast<bool>(x._code == y._code);
+        }
+
+        friend bool operator==(const lazy_error& x, const Code& code) {
+            return static_cast<bool>(x._code == code);
+        }
+
+    private:
+        // Only called from non-const members: nothing renders concurrently,
+        // no need for an atomic exchange.
+        char* release() noexcept {
+            char* message = _message.load(std::memory_order_relaxed);
+            _message.store(nullptr, std::memory_order_relaxed);
+            return message;
+        }
+
+        // The format string is only known here at run time
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+#endif
+        KZ_COLD const char* render() const noexcept {
+            // Most messages fit on the stack: format once, then copy
+            char small[256];
+            const int length = std::apply(
+                [this, &small](const Args&... args) {
+                    return std::snprintf(small, sizeof(small), _format, detail::lazy_format_arg(args)...);
+                },
+                _args);
+            if (length < 0)
+                return _format;
+
+            const std::size_t size = static_cast<std::size_t>(length) + 1;
+            char* buffer = new (std::nothrow) char[size];
+            if (!buffer)
+                return _format;
+            if (size <= sizeof(small)) {
+                std::memcpy(buffer, small, size);
+            } else {
+                std::apply(
+                    [this, buffer, size](const Args&... args) {
+                        std::snprintf(buffer, size, _format, detail::lazy_format_arg(args)...);
+                    },
+                    _args);
+            }
+
+            char* expected = nullptr;
+            if (_message.compare_exchange_strong(expected, buffer, std::memory_order_acq_rel))
+                return buffer;
+            delete[] buffer;
+            return expected;
+        }
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+        Code _code;
+        const char* _format;
+        KZ_NO_UNIQUE_ADDRESS std::tuple<Args...> _args;
+        mutable std::atomic<char*> _message{nullptr};
+    };
+
+    template <class Code, class... Args>
+    lazy_error(Code, const char*, Args...) -> lazy_error<Code, Args...>;
+
+} // namespace kz
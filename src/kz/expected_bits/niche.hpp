@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if __has_include(<bit>)
+#include <bit>
+#endif
+
+namespace kz {
+
+    /*
+        niche_traits
+
+        Opt-in customization point describing a "niche": a bit pattern of T that
+        valid code never produces. When a niche is available, expected<> uses it
+        to encode its state instead of storing a separate discriminant.
+
+        Specializations must provide:
+
+            static constexpr T niche() noexcept;
+            static constexpr bool is_niche(const T& value) noexcept;
+
+        Declaring a niche is a promise: storing the niche value as a regular
+        value (or error) is a precondition violation.
+    */
+
+    template <class T>
+    struct niche_traits {};
+
+    // User-declared sentinel, usable for pointers (nullptr), out-of-range enum
+    // values and integers.
+    template <class T, T Sentinel>
+    struct sentinel_niche {
+        static constexpr T niche() noexcept { return Sentinel; }
+        static constexpr bool is_niche(const T& value) noexcept { return value == Sentinel; }
+    };
+
+    namespace detail {
+
+    #if defined(__cpp_lib_bit_cast) && __cpp_lib_bit_cast >= 201806L
+        using std::bit_cast;
+    #else
+        template <class To, class From>
+        To bit_cast(const From& from) noexcept {
+            static_assert(sizeof(To) == sizeof(From));
+            To to;
+            std::memcpy(&to, &from, sizeof(To));
+            return to;
+        }
+    #endif
+
+        template <class T>
+        struct nan_niche_bits;
+
+        template <>
+        struct nan_niche_bits<float> {
+            using type = std::uint32_t;
+            static constexpr type value = 0x7FC0DEADu;
+        };
+
+        template <>
+        struct nan_niche_bits<double> {
+            using type = std::uint64_t;
+            static constexpr type value = 0x7FF80000DEADBEEFull;
+        };
+
+    } // namespace detail
+
+    // Quiet NaN carrying a payload that arithmetic does not produce. The
+    // comparison is on the bit pattern, other NaNs remain valid values.
+    template <class T>
+    requires(std::is_floating_point_v<T> && std::numeric_limits<T>::is_iec559)
+    struct nan_niche {
+        using bits = detail::nan_niche_bits<T>;
+
+        static constexpr T niche() noexcept {
+            return detail::bit_cast<T>(bits::value);
+        }
+
+        static constexpr bool is_niche(const T& value) noexcept {
+            return detail::bit_cast<typename bits::type>(value) == bits::value;
+        }
+    };
+
+    namespace detail {
+
+        template <class T, class = void>
+        struct has_niche : std::false_type {};
+
+        template <class T>
+        struct has_niche<T, std::void_t<decltype(niche_traits<T>::niche()),
+                                        decltype(niche_traits<T>::is_niche(std::declval<const T&>()))>>
+            : std::true_type {};
+
+        // A value-initialized T is the niche, as far as it can be told at
+        // compile time. expected<T, E>() would then hold an error.
+        template <class T>
+        concept value_init_is_niche =
+            requires { typename std::bool_constant<niche_traits<T>::is_niche(T())>; } &&
+            niche_traits<T>::is_niche(T());
+
+        // The value encodes the state and E takes no storage of its own.
+        template <class T, class E>
+        inline constexpr bool is_niche_value_v =
+            !std::is_void_v<T> &&
+            !std::is_reference_v<T> &&
+            has_niche<T>::value &&
+            std::is_trivially_copyable_v<T> &&
+            std::is_empty_v<E> &&
+            std::is_trivially_copyable_v<E> &&
+            std::is_default_constructible_v<E>;
+
+        // T is void and the error encodes the state.
+        template <class T, class E>
+        inline constexpr bool is_niche_error_v =
+            std::is_void_v<T> &&
+            has_niche<E>::value &&
+            std::is_trivially_copyable_v<E>;
+
+    } // namespace detail
+
+} // namespace kz
@@ -0,0 +1,211 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/*
+    Error origins
+
+    Opt-in: define KZ_EXPECTED_TRACK_ORIGIN to 1 to record where errors
+    come from. unexpected(e) and expected(unexpect, ...) capture their
+    caller's std::source_location, interned as a 32-bit site id that
+    follows the error into expected<> and through copies, moves, and_then(),
+    transform() and friends:
+
+        auto r = load(path);
+        if (!r) {
+            const std::source_location where = kz::origin(r);
+            log("{} ({}:{})", r.error(), where.file_name(), where.line());
+        }
+
+    Errors built with unexpected(in_place, ...) and, inside the library,
+    by containers and pipelines that construct a new error from an old one
+    report no origin or the library's own call site.
+
+    The sites are interned in a fixed-size, lock-free table: any thread can
+    add and look up sites without blocking. When it is full, new sites get
+    id 0, "unknown".
+
+    When KZ_EXPECTED_TRACK_ORIGIN is 0 (the default) nothing is recorded,
+    expected<> and unexpected<> are unchanged, and origin_id() always
+    reports an unknown origin. origin_location() and origin() are only
+    declared when tracking, so that <source_location> is not needed
+    otherwise.
+*/
+
+#include <cstdint>
+
+#if !defined(KZ_EXPECTED_TRACK_ORIGIN)
+#define KZ_EXPECTED_TRACK_ORIGIN 0
+#endif
+
+#if KZ_EXPECTED_TRACK_ORIGIN
+
+#include <atomic>
+#include <cstddef>
+#include <source_location>
+#include <type_traits>
+
+#if !defined(__cpp_lib_source_location)
+#error "KZ_EXPECTED_TRACK_ORIGIN requires std::source_location"
+#endif
+
+// Distinct error sites that can be recorded, a power of two
+#if !defined(KZ_EXPECTED_ORIGIN_SITES)
+#define KZ_EXPECTED_ORIGIN_SITES 4096
+#endif
+
+#define KZ_EXPECTED_COPY_ORIGIN(from) (_origin = ::kz::detail::origin_access::get(from))
+#define KZ_EXPECTED_SWAP_ORIGIN(other) std::swap(_origin, other._origin)
+
+#else
+
+#define KZ_EXPECTED_COPY_ORIGIN(from) ((void)(from))
+#define KZ_EXPECTED_SWAP_ORIGIN(other) ((void)0)
+
+#endif
+
+namespace kz {
+
+    template <class T, class E>
+    class expected;
+
+    template <class E>
+    class unexpected;
+
+    namespace detail {
+
+#if KZ_EXPECTED_TRACK_ORIGIN
+
+        static_assert((KZ_EXPECTED_ORIGIN_SITES & (KZ_EXPECTED_ORIGIN_SITES - 1)) == 0,
+                      "KZ_EXPECTED_ORIGIN_SITES must be a power of two");
+
+        struct origin_site {
+            // A hash of the site, 0 when the slot is free. Claiming the slot
+            // is a single CAS: lookups never wait for the writer.
+            std::atomic<std::uint64_t> key{0};
+            std::atomic<bool> ready{false};
+            std::source_location where;
+        };
+
+        struct origin_table {
+            static constexpr std::size_t size = KZ_EXPECTED_ORIGIN_SITES;
+
+            origin_site sites[size];
+        };
+
+        inline constinit origin_table origin_sites;
+
+        inline std::uint64_t origin_key(const std::source_location& where) noexcept {
+            // Sites are compared by file name address, line and column: the
+            // file name is a string literal, the same for every use of a site.
+            std::uint64_t h = reinterpret_cast<std::uintptr_t>(where.file_name());
+            h ^= (std::uint64_t(where.line()) << 32 | where.column()) * 0x9e3779b97f4a7c15ull;
+            h ^= h >> 29;
+            h *= 0xbf58476d1ce4e5b9ull;
+            h ^= h >> 32;
+            return h | 1;
+        }
+
+        inline std::uint32_t intern_origin(const std::source_location& where) noexcept {
+            const std::uint64_t key = origin_key(where);
+            std::size_t i = key & (origin_table::size - 1);
+            for (std::size_t probe = 0; probe != origin_table::size; ++probe) {
+                origin_site& site = origin_sites.sites[i];
+                std::uint64_t current = site.key.load(std::memory_order_relaxed);
+                if (current == 0 && site.key.compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+                    site.where = where;
+                    site.ready.store(true, std::memory_order_release);
+                    return static_cast<std::uint32_t>(i + 1);
+                }
+                if (current == key)
+                    return static_cast<std::uint32_t>(i + 1);
+                i = (i + 1) & (origin_table::size - 1);
+            }
+            return 0;
+        }
+
+        constexpr std::uint32_t capture_origin(const std::source_location& where) noexcept {
+            return std::is_constant_evaluated() ? 0 : intern_origin(where);
+        }
+
+        struct origin_access {
+            template <class X>
+            static constexpr std::uint32_t get(const X& x) noexcept {
+                return x._origin;
+            }
+        };
+
+        struct origin_tag_t {
+            explicit origin_tag_t() = default;
+        };
+
+        inline constexpr origin_tag_t origin_tag{};
+
+#endif
+
+    } // namespace detail
+
+    // The site id of the error held by e, 0 when unknown or when e holds a value
+    template <class T, class E>
+    constexpr std::uint32_t origin_id([[maybe_unused]] const expected<T, E>& e) noexcept {
+#if KZ_EXPECTED_TRACK_ORIGIN
+        return e.has_value() ? 0 : detail::origin_access::get(e);
+#else
+        return 0;
+#endif
+    }
+
+    template <class E>
+    constexpr std::uint32_t origin_id([[maybe_unused]] const unexpected<E>& e) noexcept {
+#if KZ_EXPECTED_TRACK_ORIGIN
+        return detail::origin_access::get(e);
+#else
+        return 0;
+#endif
+    }
+
+#if KZ_EXPECTED_TRACK_ORIGIN
+    // The location of site id, a default-constructed source_location (empty
+    // file name, line 0) when unknown
+    inline std::source_location origin_location(std::uint32_t id) noexcept {
+        if (id != 0 && id <= detail::origin_table::size) {
+            const detail::origin_site& site = detail::origin_sites.sites[id - 1];
+            if (site.ready.load(std::memory_order_acquire))
+                return site.where;
+        }
+        return std::source_location();
+    }
+
+    // Where the error held by e was created
+    template <class X>
+    std::source_location origin(const X& e) noexcept {
+        return origin_location(origin_id(e));
+    }
+#endif
+
+} // namespace kz
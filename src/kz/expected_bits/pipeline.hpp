@@ -0,0 +1,271 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <kz/expected_bits/expected.hpp>
+
+namespace kz {
+
+    /*
+        Lazy monadic pipelines:
+
+            expected<Ast, Error> r = kz::pipe(source)
+                | kz::and_then(tokenize)
+                | kz::and_then(parse)
+                | kz::transform(simplify)
+                | kz::transform_error(annotate);
+
+        Stages are only recorded by operator|. The pipeline runs in a single
+        pass when it is converted to its result (or run() is called). Values
+        and errors flow from stage to stage as references to temporaries and
+        only the final expected is materialized: an error that goes through
+        and_then() and transform() stages is never copied or moved until the
+        end.
+
+        The source is held by reference, including temporaries: a pipeline
+        must be run in the full-expression that builds it.
+    */
+
+    namespace detail {
+
+        template <class F> struct and_then_stage { F f; };
+        template <class F> struct or_else_stage { F f; };
+        template <class F> struct transform_stage { F f; };
+        template <class F> struct transform_error_stage { F f; };
+
+        template <class Stage>
+        inline constexpr bool is_pipe_stage_v =
+            is_specialization<Stage, and_then_stage>::value ||
+            is_specialization<Stage, or_else_stage>::value ||
+            is_specialization<Stage, transform_stage>::value ||
+            is_specialization<Stage, transform_error_stage>::value;
+
+        // Result of invoking F with a value V that might be void
+        template <class F, class V>
+        struct pipe_invoke { using type = std::invoke_result_t<F, V>; };
+
+        template <class F>
+        struct pipe_invoke<F, void> { using type = std::invoke_result_t<F>; };
+
+        template <class F, class V>
+        using pipe_invoke_t = typename pipe_invoke<F, V>::type;
+
+        // Types of the value and error after a stage. V is void for
+        // expected<void, E>.
+        template <class V, class E, class Stage>
+        struct pipe_step;
+
+        template <class V, class E, class F>
+        struct pipe_step<V, E, and_then_stage<F>> {
+            using result = std::remove_cvref_t<pipe_invoke_t<F, V>>;
+            static_assert(is_specialization<result, expected>::value, "and_then() must return an expected");
+            static_assert(std::is_same_v<typename result::error_type, std::remove_cvref_t<E>>,
+                          "and_then() must return an expected with the same error type");
+            using value_type = typename result::value_type;
+            using error_type = E;
+        };
+
+        template <class V, class E, class F>
+        struct pipe_step<V, E, or_else_stage<F>> {
+            using result = std::remove_cvref_t<std::invoke_result_t<F, E>>;
+            static_assert(is_specialization<result, expected>::value, "or_else() must return an expected");
+            static_assert(std::is_same_v<typename result::value_type, std::remove_cvref_t<V>>,
+                          "or_else() must return an expected with the same value type");
+            using value_type = V;
+            using error_type = typename result::error_type;
+        };
+
+        template <class V, class E, class F>
+        struct pipe_step<V, E, transform_stage<F>> {
+            using value_type = std::remove_cvref_t<pipe_invoke_t<F, V>>;
+            using error_type = E;
+        };
+
+        template <class V, class E, class F>
+        struct pipe_step<V, E, transform_error_stage<F>> {
+            using value_type = V;
+            using error_type = std::remove_cvref_t<std::invoke_result_t<F, E>>;
+        };
+
+        template <class V, class E, class... Stages>
+        struct pipe_result {
+            using type = expected<std::remove_cvref_t<V>, std::remove_cvref_t<E>>;
+        };
+
+        template <class V, class E, class Stage, class... Stages>
+        struct pipe_result<V, E, Stage, Stages...> {
+            using step = pipe_step<V, E, Stage>;
+            using type = typename pipe_result<typename step::value_type, typename step::error_type, Stages...>::type;
+        };
+
+        // Value of the source expected: void or a reference with the value category of S
+        template <class S>
+        using pipe_source_value_t = std::conditional_t<
+            std::is_void_v<typename std::remove_cvref_t<S>::value_type>,
+            void,
+            decltype(*std::declval<S>())>;
+
+    } // namespace detail
+
+    template <class S, class... Stages>
+    class pipeline {
+    public:
+        using result_type = typename detail::pipe_result<
+            detail::pipe_source_value_t<S>,
+            decltype(std::declval<S>().error()),
+            Stages...>::type;
+
+        template <class S2>
+        constexpr explicit pipeline(S2&& source, std::tuple<Stages...>&& stages)
+            : _source(std::forward<S2>(source)), _stages(std::move(stages)) {}
+
+        // Append a stage
+        template <class Stage>
+        requires(detail::is_pipe_stage_v<std::remove_cvref_t<Stage>>)
+        friend constexpr auto operator|(pipeline&& p, Stage&& stage) {
+            using Next = pipeline<S, Stages..., std::remove_cvref_t<Stage>>;
+            return Next(
+                std::forward<S>(p._source),
+                std::tuple_cat(std::move(p._stages), std::tuple<std::remove_cvref_t<Stage>>(std::forward<Stage>(stage))));
+        }
+
+        constexpr result_type run() && {
+            if (_source.has_value()) {
+                if constexpr (std::is_void_v<typename std::remove_cvref_t<S>::value_type>)
+                    return on_value<0>();
+                else
+                    return on_value<0>(*std::forward<S>(_source));
+            } else {
+                return on_error<0>(detail::unexpect_from(_source), std::forward<S>(_source).error());
+            }
+        }
+
+        constexpr operator result_type() && {
+            return std::move(*this).run();
+        }
+
+    private:
+        template <std::size_t I, class... V>
+        constexpr result_type on_value(V&&... v) {
+            if constexpr (I == sizeof...(Stages)) {
+                return result_type(std::in_place, std::forward<V>(v)...);
+            } else {
+                auto&& stage = std::get<I>(_stages);
+                using Stage = std::remove_cvref_t<decltype(stage)>;
+
+                if constexpr (detail::is_specialization<Stage, detail::and_then_stage>::value) {
+                    auto r = std::invoke(std::move(stage.f), std::forward<V>(v)...);
+                    if (!r.has_value())
+                        return on_error<I + 1>(detail::unexpect_from(r), std::move(r).error());
+                    if constexpr (std::is_void_v<typename decltype(r)::value_type>)
+                        return on_value<I + 1>();
+                    else
+                        return on_value<I + 1>(*std::move(r));
+                } else if constexpr (detail::is_specialization<Stage, detail::transform_stage>::value) {
+                    using U = std::invoke_result_t<decltype(std::move(stage.f)), V...>;
+                    if constexpr (std::is_void_v<U>) {
+                        std::invoke(std::move(stage.f), std::forward<V>(v)...);
+                        return on_value<I + 1>();
+                    } else if constexpr (I + 1 == sizeof...(Stages)) {
+                        // Last stage: construct the result in place
+                        return result_type(invoke_tag, std::move(stage.f), std::forward<V>(v)...);
+                    } else {
+                        return on_value<I + 1>(std::invoke(std::move(stage.f), std::forward<V>(v)...));
+                    }
+                } else {
+                    // or_else() and transform_error() leave values alone
+                    return on_value<I + 1>(std::forward<V>(v)...);
+                }
+            }
+        }
+
+        // The tag carries the origin of the error along the stages
+        template <std::size_t I, class G>
+        constexpr result_type on_error(unexpect_t tag, G&& e) {
+            if constexpr (I == sizeof...(Stages)) {
+                return result_type(tag, std::forward<G>(e));
+            } else {
+                auto&& stage = std::get<I>(_stages);
+                using Stage = std::remove_cvref_t<decltype(stage)>;
+
+                if constexpr (detail::is_specialization<Stage, detail::or_else_stage>::value) {
+                    auto r = std::invoke(std::move(stage.f), std::forward<G>(e));
+                    if (!r.has_value())
+                        return on_error<I + 1>(detail::unexpect_from(r), std::move(r).error());
+                    if constexpr (std::is_void_v<typename decltype(r)::value_type>)
+                        return on_value<I + 1>();
+                    else
+                        return on_value<I + 1>(*std::move(r));
+                } else if constexpr (detail::is_specialization<Stage, detail::transform_error_stage>::value) {
+                    if constexpr (I + 1 == sizeof...(Stages))
+                        return result_type(invoke_tag, tag, std::move(stage.f), std::forward<G>(e));
+                    else
+                        return on_error<I + 1>(tag, std::invoke(std::move(stage.f), std::forward<G>(e)));
+                } else {
+                    // and_then() and transform() leave errors alone
+                    return on_error<I + 1>(tag, std::forward<G>(e));
+                }
+            }
+        }
+
+        S&& _source;
+        std::tuple<Stages...> _stages;
+    };
+
+    template <class S>
+    requires(detail::is_specialization<std::remove_cvref_t<S>, expected>::value)
+    constexpr pipeline<S> pipe(S&& source) {
+        return pipeline<S>(std::forward<S>(source), std::tuple<>());
+    }
+
+    template <class F>
+    constexpr detail::and_then_stage<std::decay_t<F>> and_then(F&& f) {
+        return {std::forward<F>(f)};
+    }
+
+    template <class F>
+    constexpr detail::or_else_stage<std::decay_t<F>> or_else(F&& f) {
+        return {std::forward<F>(f)};
+    }
+
+    template <class F>
+    constexpr detail::transform_stage<std::decay_t<F>> transform(F&& f) {
+        return {std::forward<F>(f)};
+    }
+
+    template <class F>
+    constexpr detail::transform_error_stage<std::decay_t<F>> transform_error(F&& f) {
+        return {std::forward<F>(f)};
+    }
+
+} // namespace kz
@@ -0,0 +1,106 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace kz {
+
+    /*
+        is_trivially_relocatable
+
+        A type is trivially relocatable when moving an object to a new address
+        and destroying the source is equivalent to copying its bytes. This is
+        true of trivially copyable types and of most types owning their
+        resources through a pointer. Specialize this trait to opt a type in.
+
+        Types that store pointers into themselves (libstdc++'s std::string
+        with its short string buffer, for example) are not trivially
+        relocatable.
+    */
+
+    template <class T>
+    struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+    template <class T, class D>
+    struct is_trivially_relocatable<std::unique_ptr<T, D>>
+        : std::bool_constant<std::is_same_v<D, std::default_delete<T>>> {};
+
+    template <class T>
+    inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+    // Move-construct *dest from *source and destroy *source. Returns dest.
+    template <class T>
+    constexpr T* relocate_at(T* source, T* dest) noexcept(
+        is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>) {
+        if constexpr (is_trivially_relocatable_v<T>) {
+            if (!std::is_constant_evaluated()) {
+                std::memcpy(static_cast<void*>(dest), static_cast<const void*>(source), sizeof(T));
+                return std::launder(dest);
+            }
+        }
+        ::new (static_cast<void*>(dest)) T(std::move(*source));
+        source->~T();
+        return dest;
+    }
+
+    // Relocate [first, last) to the uninitialized storage at d_first and return
+    // the end of the destination range. If a move constructor throws, the
+    // source range is left intact (in a moved-from state).
+    template <class T>
+    T* uninitialized_relocate(T* first, T* last, T* d_first) noexcept(
+        is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>) {
+        if constexpr (is_trivially_relocatable_v<T>) {
+            if (first != last) {
+                std::memmove(static_cast<void*>(d_first), static_cast<const void*>(first),
+                    static_cast<std::size_t>(last - first) * sizeof(T));
+            }
+            return d_first + (last - first);
+        } else {
+            T* d_last = std::uninitialized_move(first, last, d_first);
+            std::destroy(first, last);
+            return d_last;
+        }
+    }
+
+    namespace detail {
+
+        // Uninitialized storage for a T that is relocated in and out
+        template <class T>
+        struct relocation_buffer {
+            T* get() noexcept { return reinterpret_cast<T*>(_storage); }
+
+            alignas(T) unsigned char _storage[sizeof(T)];
+        };
+
+    } // namespace detail
+
+} // namespace kz
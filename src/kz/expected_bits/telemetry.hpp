@@ -0,0 +1,316 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/*
+    Error-path telemetry
+
+    Opt-in: define KZ_EXPECTED_TELEMETRY to 1 to count, per error type E,
+    how many errors enter an expected<T, E>. An error is counted when an
+    expected is constructed from an unexpected or with unexpect_t, or is
+    assigned an unexpected. Copies and moves of an expected do not count,
+    but an error that and_then() or transform() forward into a new
+    expected does.
+
+    Counters are per thread, padded to a cache line and only written by
+    their thread: counting an error is a couple of plain loads and stores,
+    no atomic read-modify-write. snapshot() adds up every thread's counters.
+
+    When E is an enum or an integer, or has a code() that is, errors are
+    also counted per value: 0 to max_values - 1, and everything else.
+
+    When KZ_EXPECTED_TELEMETRY is 0 (the default) nothing here is defined
+    and expected<> compiles exactly as without it.
+*/
+
+#if !defined(KZ_EXPECTED_TELEMETRY)
+#define KZ_EXPECTED_TELEMETRY 0
+#endif
+
+#if KZ_EXPECTED_TELEMETRY
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <kz/expected_bits/exception.hpp>
+#include <kz/expected_bits/type_name.hpp>
+
+#if !defined(KZ_CACHE_LINE_SIZE)
+#define KZ_CACHE_LINE_SIZE 64
+#endif
+
+// Distinct error types that get their own counters. Further types are
+// counted together, as "<other>".
+#if !defined(KZ_EXPECTED_TELEMETRY_MAX_TYPES)
+#define KZ_EXPECTED_TELEMETRY_MAX_TYPES 64
+#endif
+
+// Error values counted separately for each type
+#if !defined(KZ_EXPECTED_TELEMETRY_MAX_VALUES)
+#define KZ_EXPECTED_TELEMETRY_MAX_VALUES 16
+#endif
+
+#define KZ_EXPECTED_TELEMETRY_HOOK(error) ::kz::telemetry::detail::on_error(error)
+
+namespace kz::telemetry {
+
+    inline constexpr std::size_t max_types = KZ_EXPECTED_TELEMETRY_MAX_TYPES;
+    inline constexpr std::size_t max_values = KZ_EXPECTED_TELEMETRY_MAX_VALUES;
+
+    struct error_counts {
+        std::string_view type;                              // E
+        std::uint64_t errors = 0;
+        bool keyed = false;                                 // E has values counted below
+        std::array<std::uint64_t, max_values> by_value{};   // errors with value 0, 1, ...
+        std::uint64_t other_values = 0;                     // errors with any other value
+    };
+
+    namespace detail {
+
+        template <class E>
+        inline constexpr bool is_value_key_v = std::is_enum_v<E> || std::is_integral_v<E>;
+
+        template <class E>
+        constexpr bool is_keyed() noexcept {
+            if constexpr (is_value_key_v<E>)
+                return true;
+            else if constexpr (requires(const E& e) { e.code(); })
+                return is_value_key_v<std::remove_cvref_t<decltype(std::declval<const E&>().code())>>;
+            else
+                return false;
+        }
+
+        template <class K>
+        std::size_t value_bucket(K key) noexcept {
+            if constexpr (std::is_enum_v<K>) {
+                return value_bucket(static_cast<std::underlying_type_t<K>>(key));
+            } else if constexpr (std::is_same_v<K, bool>) {
+                return key ? 1 : 0;
+            } else {
+                if constexpr (std::is_signed_v<K>) {
+                    if (key < 0)
+                        return max_values;
+                }
+                const auto value = static_cast<std::make_unsigned_t<K>>(key);
+                return value < max_values ? static_cast<std::size_t>(value) : max_values;
+            }
+        }
+
+        template <class E>
+        std::size_t error_bucket(const E& e) noexcept {
+            if constexpr (is_value_key_v<E>)
+                return value_bucket(e);
+            else
+                return value_bucket(e.code());
+        }
+
+        struct type_entry {
+            std::string_view name;
+            bool keyed;
+        };
+
+        template <class E>
+        inline constexpr type_entry type_entry_v{kz::detail::type_name<E>(), is_keyed<E>()};
+
+        inline constexpr type_entry other_type_entry{"<other>", false};
+
+        struct alignas(KZ_CACHE_LINE_SIZE) type_counters {
+            std::atomic<std::uint64_t> errors{0};
+            std::atomic<std::uint64_t> values[max_values + 1] = {};
+        };
+
+        // One per thread. Kept when the thread exits, for snapshot(), and
+        // handed over to the next thread that starts counting.
+        struct thread_counters {
+            type_counters types[max_types];
+            thread_counters* next = nullptr;
+            std::atomic<bool> in_use{true};
+        };
+
+        struct registry {
+            // Type 0 is "<other>"
+            std::atomic<std::uint32_t> type_count{1};
+            std::atomic<const type_entry*> types[max_types] = {&other_type_entry};
+            std::atomic<thread_counters*> threads{nullptr};
+            // Counts from threads in the middle of exiting
+            thread_counters exiting;
+        };
+
+        inline constinit registry telemetry_registry;
+
+        inline std::uint32_t register_type(const type_entry* entry) noexcept {
+            const std::uint32_t id = telemetry_registry.type_count.fetch_add(1, std::memory_order_relaxed);
+            if (id >= max_types)
+                return 0;
+            telemetry_registry.types[id].store(entry, std::memory_order_release);
+            return id;
+        }
+
+        // Zero, hence "<other>", for errors counted during static
+        // initialization before the type is registered
+        template <class E>
+        inline const std::uint32_t type_id = register_type(&type_entry_v<E>);
+
+        inline constinit thread_local thread_counters* current_counters = nullptr;
+
+        inline void push_counters(thread_counters* counters) noexcept {
+            thread_counters* head = telemetry_registry.threads.load(std::memory_order_relaxed);
+            do {
+                counters->next = head;
+            } while (!telemetry_registry.threads.compare_exchange_weak(head, counters, std::memory_order_release,
+                                                                        std::memory_order_relaxed));
+        }
+
+        struct counters_releaser {
+            ~counters_releaser() {
+                current_counters->in_use.store(false, std::memory_order_release);
+                current_counters = &telemetry_registry.exiting;
+            }
+        };
+
+        KZ_COLD inline thread_counters* attach() {
+            thread_counters* counters = nullptr;
+            for (thread_counters* c = telemetry_registry.threads.load(std::memory_order_acquire); c; c = c->next) {
+                bool in_use = false;
+                if (!c->in_use.load(std::memory_order_relaxed) &&
+                    c->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+                    counters = c;
+                    break;
+                }
+            }
+            if (!counters) {
+                counters = new thread_counters;
+                push_counters(counters);
+            }
+            current_counters = counters;
+            thread_local counters_releaser releaser;
+            (void)releaser;
+            return counters;
+        }
+
+        // Counters of a thread only have one writer: a plain load and store
+        // is enough. The block of exiting threads is shared by all of them.
+        inline void increment(std::atomic<std::uint64_t>& counter, bool shared) noexcept {
+            if (KZ_UNLIKELY(shared))
+                counter.fetch_add(1, std::memory_order_relaxed);
+            else
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        template <class E>
+        void record(const E& e) noexcept {
+            thread_counters* counters = current_counters;
+            if (KZ_UNLIKELY(!counters))
+                counters = attach();
+            const bool shared = counters == &telemetry_registry.exiting;
+            type_counters& c = counters->types[type_id<E>];
+            increment(c.errors, shared);
+            if constexpr (is_keyed<E>())
+                increment(c.values[error_bucket(e)], shared);
+        }
+
+        // The hook called by expected<>
+        template <class E>
+        constexpr void on_error(const E& e) noexcept {
+            if (!std::is_constant_evaluated())
+                record(e);
+        }
+
+        inline void add(std::vector<error_counts>& counts, const thread_counters& counters) {
+            for (std::size_t i = 0; i != counts.size(); ++i) {
+                const type_counters& c = counters.types[i];
+                counts[i].errors += c.errors.load(std::memory_order_relaxed);
+                for (std::size_t v = 0; v != max_values; ++v)
+                    counts[i].by_value[v] += c.values[v].load(std::memory_order_relaxed);
+                counts[i].other_values += c.values[max_values].load(std::memory_order_relaxed);
+            }
+        }
+
+        inline std::vector<error_counts> make_counts() {
+            const std::size_t count = telemetry_registry.type_count.load(std::memory_order_acquire);
+            std::vector<error_counts> counts(count < max_types ? count : max_types);
+            for (std::size_t i = 0; i != counts.size(); ++i) {
+                // Registered but not published yet: count it as "<other>"
+                const type_entry* entry = telemetry_registry.types[i].load(std::memory_order_acquire);
+                if (!entry)
+                    entry = &other_type_entry;
+                counts[i].type = entry->name;
+                counts[i].keyed = entry->keyed;
+            }
+            return counts;
+        }
+
+        inline std::vector<error_counts> aggregate() {
+            std::vector<error_counts> counts = make_counts();
+            for (auto c = telemetry_registry.threads.load(std::memory_order_acquire); c; c = c->next)
+                add(counts, *c);
+            add(counts, telemetry_registry.exiting);
+            return counts;
+        }
+
+        inline std::vector<error_counts> seen(std::vector<error_counts>&& counts) {
+            std::erase_if(counts, [](const error_counts& c) { return c.errors == 0; });
+            return std::move(counts);
+        }
+
+    } // namespace detail
+
+    // Counts summed over every thread, running or exited: one entry per error
+    // type that has been counted at least once. Taken while other threads are
+    // counting, it is a consistent enough sample, not an atomic snapshot.
+    inline std::vector<error_counts> snapshot() {
+        return detail::seen(detail::aggregate());
+    }
+
+    // The calling thread's counts only. A thread reuses the counters of an
+    // exited one, so they include that thread's errors.
+    inline std::vector<error_counts> thread_snapshot() {
+        std::vector<error_counts> counts = detail::make_counts();
+        if (const detail::thread_counters* c = detail::current_counters)
+            detail::add(counts, *c);
+        return detail::seen(std::move(counts));
+    }
+
+    // Counts for one error type, summed over every thread. Types past
+    // max_types get the "<other>" counts.
+    template <class E>
+    error_counts counts() {
+        return detail::aggregate()[detail::type_id<E>];
+    }
+
+} // namespace kz::telemetry
+
+#else
+
+#define KZ_EXPECTED_TELEMETRY_HOOK(error) ((void)0)
+
+#endif
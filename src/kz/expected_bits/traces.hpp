@@ -0,0 +1,346 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/*
+    Sampled error traces
+
+    Opt-in: define KZ_EXPECTED_SAMPLE_TRACES to 1 to capture the call
+    stack of one error in N, per thread, when it enters an expected (see
+    telemetry.hpp for what counts as an error entering an expected):
+
+        kz::traces::set_sample_rate(1000);
+        ...
+        kz::traces::dump(stderr);
+
+    Errors that are not sampled cost a thread-local decrement. Sampled ones
+    walk the stack with the unwinder, without allocating, into a fixed ring
+    buffer of the last kz::traces::capacity samples, shared by all threads.
+
+    dump() groups identical stacks, most frequent first, and prints each
+    frame as module+address, to be symbolized offline:
+
+        addr2line -f -C -e ./server 0x1a2b3c
+
+    The address is what addr2line expects: an offset from the load address
+    for shared objects and position-independent executables, the absolute
+    address for other executables.
+
+    dump() names the modules with dladdr(), which lives in libdl with older
+    C libraries: programs that turn sampling on link it (CMAKE_DL_LIBS).
+
+    Stacks are captured with _Unwind_Backtrace() where <unwind.h> is
+    available, and are empty elsewhere. As with any unwinder, a function
+    that ends in a tail call does not appear in them.
+*/
+
+#if !defined(KZ_EXPECTED_SAMPLE_TRACES)
+#define KZ_EXPECTED_SAMPLE_TRACES 0
+#endif
+
+#if KZ_EXPECTED_SAMPLE_TRACES
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <kz/expected_bits/exception.hpp>
+#include <kz/expected_bits/type_name.hpp>
+
+#if __has_include(<unwind.h>)
+#include <unwind.h>
+#define KZ_TRACES_UNWIND 1
+#else
+#define KZ_TRACES_UNWIND 0
+#endif
+
+#if __has_include(<dlfcn.h>)
+#include <dlfcn.h>
+#define KZ_TRACES_DLADDR 1
+#else
+#define KZ_TRACES_DLADDR 0
+#endif
+
+#if KZ_TRACES_DLADDR && __has_include(<link.h>)
+#include <link.h>
+#define KZ_TRACES_ELF 1
+#else
+#define KZ_TRACES_ELF 0
+#endif
+
+// Default sampling rate: one error in N per thread, 0 to start disabled
+#if !defined(KZ_EXPECTED_TRACE_RATE)
+#define KZ_EXPECTED_TRACE_RATE 1024
+#endif
+
+// Samples kept in the ring buffer
+#if !defined(KZ_EXPECTED_TRACE_CAPACITY)
+#define KZ_EXPECTED_TRACE_CAPACITY 256
+#endif
+
+// Frames kept per sample
+#if !defined(KZ_EXPECTED_TRACE_DEPTH)
+#define KZ_EXPECTED_TRACE_DEPTH 32
+#endif
+
+#define KZ_EXPECTED_TRACE_HOOK(error) ::kz::traces::detail::on_error(error)
+
+namespace kz::traces {
+
+    inline constexpr std::size_t capacity = KZ_EXPECTED_TRACE_CAPACITY;
+    inline constexpr std::size_t max_depth = KZ_EXPECTED_TRACE_DEPTH;
+
+    struct trace {
+        std::uint64_t sequence = 0;             // sample number, from 0
+        std::string_view type;                  // E
+        std::size_t depth = 0;
+        std::array<void*, max_depth> frames{};  // return addresses, innermost first
+    };
+
+    namespace detail {
+
+        template <class E>
+        inline constexpr std::string_view type_name_v = kz::detail::type_name<E>();
+
+        // A seqlock: sequence is odd while the record is being written, by
+        // the one thread that claimed it
+        struct record {
+            std::atomic<std::uint64_t> sequence{0};
+            std::atomic<const std::string_view*> type{nullptr};
+            std::atomic<std::size_t> depth{0};
+            std::atomic<void*> frames[max_depth] = {};
+        };
+
+        struct sampler {
+            std::atomic<std::uint32_t> rate{KZ_EXPECTED_TRACE_RATE};
+            // Bumped by set_sample_rate() so that threads pick the new rate up
+            std::atomic<std::uint32_t> generation{1};
+            std::atomic<std::uint64_t> samples{0};
+            record records[capacity];
+        };
+
+        inline constinit sampler trace_sampler;
+
+        // Errors left until the next sample, and the generation of the rate
+        // it was computed from
+        inline constinit thread_local std::uint32_t countdown = 0;
+        inline constinit thread_local std::uint32_t countdown_generation = 0;
+
+#if KZ_TRACES_UNWIND
+        struct unwind_state {
+            void** frames;
+            std::size_t depth;
+            std::size_t skip;
+        };
+
+        inline _Unwind_Reason_Code unwind_frame(_Unwind_Context* context, void* arg) {
+            auto& state = *static_cast<unwind_state*>(arg);
+            if (state.skip) {
+                --state.skip;
+                return _URC_NO_REASON;
+            }
+            const auto ip = _Unwind_GetIP(context);
+            if (!ip || state.depth == max_depth)
+                return _URC_END_OF_STACK;
+            state.frames[state.depth++] = reinterpret_cast<void*>(ip);
+            return _URC_NO_REASON;
+        }
+#endif
+
+        // Called on the errors that are not simply counted down. Captures
+        // the stack itself, so that its caller, the function that created
+        // the error, is the first frame.
+        KZ_COLD inline void tick_slow(const std::string_view* type) noexcept {
+            sampler& s = trace_sampler;
+            const std::uint32_t generation = s.generation.load(std::memory_order_acquire);
+            const std::uint32_t rate = s.rate.load(std::memory_order_relaxed);
+            if (countdown_generation != generation) {
+                // New rate: start counting from this error
+                countdown_generation = generation;
+                countdown = rate != 0 ? rate : UINT32_MAX;
+            }
+            if (rate == 0 || countdown > 1) {
+                --countdown;
+                return;
+            }
+            countdown = rate;
+
+            void* frames[max_depth];
+            std::size_t depth = 0;
+#if KZ_TRACES_UNWIND
+            unwind_state state{frames, 0, 1};
+            _Unwind_Backtrace(&unwind_frame, &state);
+            depth = state.depth;
+#endif
+            const std::uint64_t sequence = s.samples.fetch_add(1, std::memory_order_relaxed);
+            record& r = s.records[sequence % capacity];
+            // Claim the record: a thread a whole ring behind or ahead may be
+            // writing it too. The sample is dropped if the record is busy, or
+            // already holds a later one.
+            std::uint64_t current = r.sequence.load(std::memory_order_relaxed);
+            if (current % 2 != 0 || current > 2 * sequence ||
+                !r.sequence.compare_exchange_strong(current, 2 * sequence + 1, std::memory_order_relaxed))
+                return;
+            std::atomic_thread_fence(std::memory_order_release);
+            r.type.store(type, std::memory_order_relaxed);
+            r.depth.store(depth, std::memory_order_relaxed);
+            for (std::size_t i = 0; i != depth; ++i)
+                r.frames[i].store(frames[i], std::memory_order_relaxed);
+            r.sequence.store(2 * sequence + 2, std::memory_order_release);
+        }
+
+        inline void tick(const std::string_view* type) noexcept {
+            if (KZ_LIKELY(countdown > 1 &&
+                          countdown_generation == trace_sampler.generation.load(std::memory_order_relaxed))) {
+                --countdown;
+                return;
+            }
+            tick_slow(type);
+        }
+
+        // The hook called by expected<>
+        template <class E>
+        constexpr void on_error(const E&) noexcept {
+            if (!std::is_constant_evaluated())
+                tick(&type_name_v<E>);
+        }
+
+        // Whether the module loaded at base is an executable linked at a
+        // fixed address (not position-independent)
+        inline bool is_fixed_address([[maybe_unused]] const void* base) noexcept {
+#if KZ_TRACES_ELF
+            return static_cast<const ElfW(Ehdr)*>(base)->e_type == ET_EXEC;
+#else
+            return false;
+#endif
+        }
+
+    } // namespace detail
+
+    // Sample one error in rate, per thread; 0 disables sampling. Takes
+    // effect on every thread at its next error.
+    inline void set_sample_rate(std::uint32_t rate) noexcept {
+        detail::trace_sampler.rate.store(rate, std::memory_order_relaxed);
+        detail::trace_sampler.generation.fetch_add(1, std::memory_order_release);
+    }
+
+    inline std::uint32_t sample_rate() noexcept {
+        return detail::trace_sampler.rate.load(std::memory_order_relaxed);
+    }
+
+    // Samples taken since the start of the program, including those the
+    // ring buffer no longer holds and those dropped because another thread
+    // was writing their record
+    inline std::uint64_t samples_taken() noexcept {
+        return detail::trace_sampler.samples.load(std::memory_order_relaxed);
+    }
+
+    // The samples in the ring buffer, oldest first. Samples being written
+    // while it is read are left out.
+    inline std::vector<trace> snapshot() {
+        std::vector<trace> traces;
+        traces.reserve(capacity);
+        for (const detail::record& r : detail::trace_sampler.records) {
+            const std::uint64_t before = r.sequence.load(std::memory_order_acquire);
+            if (before == 0 || before % 2 != 0)
+                continue;
+            trace t;
+            t.sequence = before / 2 - 1;
+            const std::string_view* type = r.type.load(std::memory_order_relaxed);
+            t.depth = std::min(r.depth.load(std::memory_order_relaxed), max_depth);
+            for (std::size_t i = 0; i != t.depth; ++i)
+                t.frames[i] = r.frames[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (r.sequence.load(std::memory_order_relaxed) != before)
+                continue;
+            t.type = *type;
+            traces.push_back(t);
+        }
+        std::sort(traces.begin(), traces.end(),
+                  [](const trace& x, const trace& y) { return x.sequence < y.sequence; });
+        return traces;
+    }
+
+    // Prints the samples in the ring buffer, identical stacks together, the
+    // most frequent first. Returns the number of samples printed.
+    inline std::size_t dump(std::FILE* out = stderr) {
+        const std::vector<trace> traces = snapshot();
+
+        struct group {
+            const trace* first;
+            std::size_t count;
+        };
+        std::vector<group> groups;
+        for (const trace& t : traces) {
+            auto same = [&t](const group& g) {
+                return g.first->type == t.type && g.first->depth == t.depth &&
+                       std::equal(t.frames.begin(), t.frames.begin() + t.depth, g.first->frames.begin());
+            };
+            if (auto g = std::find_if(groups.begin(), groups.end(), same); g != groups.end())
+                ++g->count;
+            else
+                groups.push_back({&t, 1});
+        }
+        std::stable_sort(groups.begin(), groups.end(),
+                         [](const group& x, const group& y) { return x.count > y.count; });
+
+        std::fprintf(out, "# %zu error samples, 1 in %u per thread, %llu taken in total\n", traces.size(),
+                     sample_rate(), static_cast<unsigned long long>(samples_taken()));
+        for (const group& g : groups) {
+            std::fprintf(out, "%zu x %.*s\n", g.count, static_cast<int>(g.first->type.size()), g.first->type.data());
+            for (std::size_t i = 0; i != g.first->depth; ++i) {
+                void* frame = g.first->frames[i];
+#if KZ_TRACES_DLADDR
+                Dl_info info;
+                if (dladdr(frame, &info) && info.dli_fname) {
+                    // Return addresses point after the call: step back into it
+                    auto address = reinterpret_cast<std::uintptr_t>(frame) - 1;
+                    if (!detail::is_fixed_address(info.dli_fbase))
+                        address -= reinterpret_cast<std::uintptr_t>(info.dli_fbase);
+                    std::fprintf(out, "    #%zu %s+0x%llx\n", i, info.dli_fname, static_cast<unsigned long long>(address));
+                    continue;
+                }
+#endif
+                std::fprintf(out, "    #%zu %p\n", i, frame);
+            }
+        }
+        return traces.size();
+    }
+
+} // namespace kz::traces
+
+#else
+
+#define KZ_EXPECTED_TRACE_HOOK(error) ((void)0)
+
+#endif
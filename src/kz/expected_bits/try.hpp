@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+#include <kz/expected_bits/exception.hpp>
+#include <kz/expected_bits/expected.hpp>
+
+/*
+    Early return on error:
+
+        kz::expected<Config, Error> load(const char* path) {
+            KZ_TRY_ASSIGN(auto text, read_file(path));
+            KZ_TRY(validate(text));
+            return parse(text);
+        }
+
+    KZ_TRY(expr) evaluates expr, an expected. On error it returns that error
+    from the enclosing function, which must return an expected with a
+    compatible error type. Otherwise KZ_TRY(expr) evaluates to the value
+    with GCC and clang, so that `int x = KZ_TRY(f());` works. Other compilers
+    don't have statement expressions: KZ_TRY() is then a statement and the
+    value is discarded.
+
+    KZ_TRY_ASSIGN(var, expr) is a statement that works everywhere. var is
+    either a declaration (`auto x`, `const std::string& s`) or an existing
+    lvalue.
+
+    The error is moved (copied if expr is an lvalue) straight into the
+    return value of the enclosing function, without going through an
+    intermediate unexpected<E>.
+*/
+
+namespace kz {
+    namespace detail {
+
+        // Converts to any expected<T, G> by constructing its error in place
+        template <class E>
+        class propagated_error {
+        public:
+            constexpr propagated_error(E&& e, [[maybe_unused]] std::uint32_t origin) noexcept
+                : _error(std::forward<E>(e))
+#if KZ_EXPECTED_TRACK_ORIGIN
+                , _origin(origin)
+#endif
+            {}
+
+            propagated_error(const propagated_error&) = delete;
+            propagated_error& operator=(const propagated_error&) = delete;
+
+            template <class T, class G>
+            requires(std::is_constructible_v<G, E>)
+            constexpr operator expected<T, G>() && {
+#if KZ_EXPECTED_TRACK_ORIGIN
+                return expected<T, G>(unexpect_t(origin_tag, _origin), std::forward<E>(_error));
+#else
+                return expected<T, G>(unexpect, std::forward<E>(_error));
+#endif
+            }
+
+        private:
+            E&& _error;
+#if KZ_EXPECTED_TRACK_ORIGIN
+            std::uint32_t _origin;
+#endif
+        };
+
+        template <class R>
+        constexpr auto propagate_error(R&& r) noexcept {
+            using E = decltype(std::forward<R>(r).error());
+            return propagated_error<E>(std::forward<R>(r).error(), origin_id(r));
+        }
+
+        template <class R>
+        constexpr decltype(auto) try_value(R&& r) noexcept {
+            if constexpr (!std::is_void_v<typename std::remove_cvref_t<R>::value_type>)
+                return *std::forward<R>(r);
+        }
+
+    } // namespace detail
+} // namespace kz
+
+#define KZ_TRY_CONCAT_IMPL(a, b) a##b
+#define KZ_TRY_CONCAT(a, b) KZ_TRY_CONCAT_IMPL(a, b)
+#define KZ_TRY_NAME KZ_TRY_CONCAT(kz_try_result_, __LINE__)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define KZ_HAS_STATEMENT_EXPRESSIONS 1
+#else
+#define KZ_HAS_STATEMENT_EXPRESSIONS 0
+#endif
+
+#if KZ_HAS_STATEMENT_EXPRESSIONS
+#define KZ_TRY(...)                                                                         \
+    __extension__({                                                                         \
+        auto&& kz_try_result = (__VA_ARGS__);                                               \
+        if (KZ_UNLIKELY(!kz_try_result.has_value()))                                        \
+            return ::kz::detail::propagate_error(std::forward<decltype(kz_try_result)>(kz_try_result)); \
+        ::kz::detail::try_value(std::forward<decltype(kz_try_result)>(kz_try_result));      \
+    })
+#else
+#define KZ_TRY(...)                                                                         \
+    do {                                                                                    \
+        auto&& kz_try_result = (__VA_ARGS__);                                               \
+        if (KZ_UNLIKELY(!kz_try_result.has_value()))                                        \
+            return ::kz::detail::propagate_error(std::forward<decltype(kz_try_result)>(kz_try_result)); \
+    } while (false)
+#endif
+
+#define KZ_TRY_ASSIGN(var, ...)                                                             \
+    auto&& KZ_TRY_NAME = (__VA_ARGS__);                                                     \
+    if (KZ_UNLIKELY(!KZ_TRY_NAME.has_value()))                                              \
+        return ::kz::detail::propagate_error(std::forward<decltype(KZ_TRY_NAME)>(KZ_TRY_NAME)); \
+    var = *std::forward<decltype(KZ_TRY_NAME)>(KZ_TRY_NAME)
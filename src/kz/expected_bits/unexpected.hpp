@@ -34,6 +34,7 @@
 #include <initializer_list>
 #include <type_traits>
 #include <utility>
+#include <kz/expected_bits/origin.hpp>
 
 namespace kz {
 
@@ -42,10 +43,54 @@ namespace kz {
 
     struct unexpect_t{
         explicit unexpect_t() = default;
+
+#if KZ_EXPECTED_TRACK_ORIGIN
+        // expected(unexpect_t, ...) takes the tag by value: the copy made at
+        // the call site records that site. Copies of a tag that already has
+        // an origin, forwarded by emplace() and the like, keep it.
+        constexpr unexpect_t(const unexpect_t& rhs, std::source_location where = std::source_location::current()) noexcept
+            : _origin(rhs._origin ? rhs._origin : detail::capture_origin(where)) {}
+
+        constexpr unexpect_t(detail::origin_tag_t, std::uint32_t origin) noexcept : _origin(origin) {}
+
+        constexpr unexpect_t& operator=(const unexpect_t&) = default;
+
+        std::uint32_t _origin = 0;
+#endif
     };
 
     inline constexpr unexpect_t unexpect{};
 
+    namespace detail {
+
+        // The tag to construct a new expected from the error of e, passing
+        // the origin of that error along
+        template <class X>
+        constexpr unexpect_t unexpect_from(const X&) noexcept {
+#if KZ_EXPECTED_TRACK_ORIGIN
+            return unexpect_t(origin_tag, 0);
+#else
+            return unexpect;
+#endif
+        }
+
+#if KZ_EXPECTED_TRACK_ORIGIN
+        template <class T, class E>
+        constexpr unexpect_t unexpect_from(const expected<T, E>& e) noexcept {
+            return unexpect_t(origin_tag, origin_access::get(e));
+        }
+#endif
+
+    } // namespace detail
+
+    // Selects the constructors of expected that initialize the value (or the
+    // error) with the result of invoking a callable
+    struct invoke_tag_t{
+        explicit invoke_tag_t() = default;
+    };
+
+    inline constexpr invoke_tag_t invoke_tag{};
+
 
     template <class E>
     class unexpected {
@@ -64,6 +109,15 @@ namespace kz {
         requires(std::is_constructible_v<E, initializer_list<U>&, Args...>)
             : _value(il, std::forward<Args>(args)...) {}
 
+#if KZ_EXPECTED_TRACK_ORIGIN
+        template <class Err = E>
+        constexpr explicit unexpected(Err&& e, std::source_location where = std::source_location::current())
+        requires(
+            !std::is_same_v<std::remove_cvref_t<Err>, unexpected> &&
+            !std::is_same_v<std::remove_cvref_t<Err>, in_place_t> &&
+            std::is_constructible_v<E, Err>)
+            : _value(std::forward<Err>(e)), _origin(detail::capture_origin(where)) {}
+#else
         template <class Err = E>
         constexpr explicit unexpected(Err&& e)
         requires(
@@ -71,6 +125,7 @@ namespace kz {
             !std::is_same_v<std::remove_cvref_t<Err>, in_place_t> &&
             std::is_constructible_v<E, Err>)
             : _value(std::forward<Err>(e)) {}
+#endif
 
         // Assignment
         constexpr unexpected& operator=(const unexpected&) = default;
@@ -86,6 +141,7 @@ namespace kz {
         constexpr void swap(unexpected& other) noexcept(std::is_nothrow_swappable_v<E>) {
             using std::swap;
             swap(_value, other._value);
+            KZ_EXPECTED_SWAP_ORIGIN(other);
         }
 
         friend void swap(unexpected<E>& x, unexpected<E>& y) noexcept(noexcept(x.swap(y)))
@@ -107,9 +163,24 @@ namespace kz {
 
     private:
         E _value;
+#if KZ_EXPECTED_TRACK_ORIGIN
+        std::uint32_t _origin = 0;
+        friend struct detail::origin_access;
+#endif
     };
 
     template <class E>
     unexpected(E) -> unexpected<E>;
 
+#if KZ_EXPECTED_TRACK_ORIGIN
+    namespace detail {
+
+        template <class E>
+        constexpr unexpect_t unexpect_from(const unexpected<E>& e) noexcept {
+            return unexpect_t(origin_tag, origin_access::get(e));
+        }
+
+    } // namespace detail
+#endif
+
 } // namespace kz
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <kz/expected_bits/expected.hpp>
+
+namespace kz {
+
+    /*
+        Range adaptors over ranges of expected. Over ranges of lvalues they
+        yield references to the values and errors stored in the elements,
+        nothing is copied. Over ranges yielding prvalues the elements are
+        temporaries, so the values and errors are moved out of them instead:
+
+            for (Row& row : rows | kz::views::values)
+                ...
+            auto messages = results | kz::views::errors
+                                    | std::views::transform(&Error::message);
+    */
+
+    namespace views {
+
+        namespace detail {
+
+            struct has_value_fn {
+                template <class X>
+                constexpr bool operator()(const X& e) const noexcept { return e.has_value(); }
+            };
+
+            struct has_error_fn {
+                template <class X>
+                constexpr bool operator()(const X& e) const noexcept { return !e.has_value(); }
+            };
+
+            // Referring into an rvalue element would dangle once the transform
+            // step returns, so those yield by value
+            struct value_fn {
+                template <class X>
+                constexpr decltype(auto) operator()(X&& e) const {
+                    if constexpr (std::is_lvalue_reference_v<X>)
+                        return *e;
+                    else
+                        return std::remove_cvref_t<decltype(*e)>(*std::move(e));
+                }
+            };
+
+            struct error_fn {
+                template <class X>
+                constexpr decltype(auto) operator()(X&& e) const {
+                    if constexpr (std::is_lvalue_reference_v<X>)
+                        return e.error();
+                    else
+                        return std::remove_cvref_t<decltype(e.error())>(std::move(e).error());
+                }
+            };
+
+            // Yields the value, or a reference to the default stored in the view
+            template <class U>
+            struct value_or_fn {
+                U default_value;
+
+                template <class X>
+                constexpr decltype(auto) operator()(X&& e) const {
+                    return e.has_value() ? *std::forward<X>(e) : default_value;
+                }
+            };
+
+        } // namespace detail
+
+        // The values of the elements holding one
+        inline constexpr auto values = std::views::filter(detail::has_value_fn{}) | std::views::transform(detail::value_fn{});
+
+        // The errors of the elements holding one
+        inline constexpr auto errors = std::views::filter(detail::has_error_fn{}) | std::views::transform(detail::error_fn{});
+
+        // The value of every element, or default_value for those holding an error
+        template <class U>
+        constexpr auto unwrap_or(U&& default_value) {
+            return std::views::transform(detail::value_or_fn<std::decay_t<U>>{std::forward<U>(default_value)});
+        }
+
+    } // namespace views
+
+    /*
+        Reorder a range of expected so that the elements holding a value
+        come first, keeping their relative order in both groups. Returns the
+        elements holding an error, like std::ranges::stable_partition().
+    */
+
+    template <std::ranges::bidirectional_range R>
+    requires(std::permutable<std::ranges::iterator_t<R>>)
+    std::ranges::borrowed_subrange_t<R> partition_results(R&& range) {
+        return std::ranges::stable_partition(std::forward<R>(range), views::detail::has_value_fn{});
+    }
+
+} // namespace kz
@@ -0,0 +1,52 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Calls value() on an expected holding an error in a build without
+// exceptions. Used to check the diagnostic printed by the access policy: the
+// expected abort is turned into a successful exit so that ctest only has to
+// match the output.
+
+#include <expected>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+
+// The handler policy prints the same diagnostic: make sure this is not it
+static_assert(KZ_EXPECTED_ACCESS_POLICY == KZ_EXPECTED_ACCESS_TERMINATE);
+
+extern "C" void on_abort(int) {
+    std::_Exit(EXIT_SUCCESS);
+}
+
+int main() {
+    std::signal(SIGABRT, on_abort);
+
+    std::expected<int, int> e{std::unexpected(1)};
+    const int value = e.value();
+    std::printf("value() returned %d\n", value);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/batch.hpp>
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+    // Every set of kernels this processor can run
+    std::vector<kz::batch::isa> available_kernels() {
+        std::vector<kz::batch::isa> kernels{kz::batch::isa::scalar};
+        if (kz::batch::selected_isa() != kz::batch::isa::scalar)
+            kernels.push_back(kz::batch::isa::sse2);
+        if (kz::batch::selected_isa() == kz::batch::isa::avx2)
+            kernels.push_back(kz::batch::isa::avx2);
+        return kernels;
+    }
+
+    template <class T, class E>
+    std::vector<std::expected<T, E>> make_values(std::size_t n) {
+        std::vector<std::expected<T, E>> v;
+        for (std::size_t i = 0; i != n; ++i)
+            v.emplace_back(static_cast<T>(i + 1));
+        return v;
+    }
+
+} // namespace
+
+TEMPLATE_TEST_CASE("batch kernels", "[batch]", float, double, std::int32_t, std::uint64_t, std::int16_t) {
+    using E = std::uint8_t;
+    static_assert(kz::batch::detail::lane_size_v<std::expected<TestType, E>> == (sizeof(TestType) >= 4 ? sizeof(TestType) : 0));
+
+    for (const auto kernels : available_kernels()) {
+        for (std::size_t n : {0, 1, 3, 7, 8, 16, 31, 33, 64, 100}) {
+            auto v = make_values<TestType, E>(n);
+            const auto total = static_cast<TestType>(n * (n + 1) / 2);
+
+            REQUIRE(!kz::batch::any_error(v, kernels));
+            REQUIRE(kz::batch::first_error_index(v, kernels) == n);
+            REQUIRE(kz::batch::sum_values(v, kernels) == total);
+
+            // One error at every position
+            for (std::size_t e = 0; e != n; ++e) {
+                auto w = v;
+                w[e] = std::unexpected<E>(static_cast<E>(e));
+                if (e + 3 < n)
+                    w[e + 3] = std::unexpected<E>(0);
+                REQUIRE(kz::batch::any_error(w, kernels));
+                REQUIRE(kz::batch::first_error_index(w, kernels) == e);
+                const auto expected_sum = static_cast<TestType>(total - static_cast<TestType>(e + 1) - (e + 3 < n ? static_cast<TestType>(e + 4) : 0));
+                REQUIRE(kz::batch::sum_values(w, kernels) == expected_sum);
+            }
+        }
+    }
+}
+
+TEST_CASE("batch::transform", "[batch]") {
+    for (const auto kernels : available_kernels()) {
+        for (std::size_t n : {0, 5, 16, 37}) {
+            auto in = make_values<float, int>(n);
+            for (std::size_t i = 0; i < n; i += 3)
+                in[i] = std::unexpected(static_cast<int>(i));
+
+            std::vector<std::expected<std::int32_t, int>> out(n);
+            kz::batch::transform(in, out, [](float x) { return static_cast<std::int32_t>(x * 2); }, kernels);
+
+            for (std::size_t i = 0; i != n; ++i) {
+                if (i % 3 == 0)
+                    REQUIRE(out[i] == std::unexpected(static_cast<int>(i)));
+                else
+                    REQUIRE(out[i] == static_cast<std::int32_t>((i + 1) * 2));
+            }
+        }
+    }
+
+    // f is only given values and fill, never the bits of an error
+    for (const auto kernels : available_kernels()) {
+        std::vector<std::expected<std::int32_t, int>> in(37, 4);
+        for (std::size_t i = 0; i < in.size(); i += 3)
+            in[i] = std::unexpected(0);
+        std::vector<std::expected<std::int32_t, int>> out(in.size());
+        kz::batch::transform(in, out, [](std::int32_t x) { return 100 / x; }, 1, kernels);
+        for (std::size_t i = 0; i != in.size(); ++i) {
+            if (i % 3 == 0)
+                REQUIRE(out[i] == std::unexpected(0));
+            else
+                REQUIRE(out[i] == 25);
+        }
+    }
+
+    // Scalar path for values the kernels don't handle
+    std::vector<std::expected<std::int16_t, int>> in{1, std::unexpected(4), 3};
+    std::vector<std::expected<std::int16_t, int>> out(3);
+    kz::batch::transform(in, out, [](std::int16_t x) { return static_cast<std::int16_t>(-x); });
+    REQUIRE(out == std::vector<std::expected<std::int16_t, int>>{-1, std::unexpected(4), -3});
+}
@@ -0,0 +1,150 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/boxed_error.hpp>
+#include <catch2/catch.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    struct Diagnostic {
+        std::string message;
+        std::string file;
+        int line;
+        std::vector<std::string> context;
+
+        friend bool operator==(const Diagnostic&, const Diagnostic&) = default;
+    };
+
+} // namespace
+
+TEST_CASE("boxed_error layout", "[boxed_error]") {
+    using Boxed = std::expected<int, kz::boxed_error<Diagnostic>>;
+    static_assert(sizeof(kz::boxed_error<Diagnostic>) == sizeof(void*));
+    static_assert(sizeof(Boxed) == sizeof(std::expected<int, void*>));
+    static_assert(sizeof(Boxed) < sizeof(std::expected<int, Diagnostic>));
+    static_assert(std::is_nothrow_move_constructible_v<Boxed>);
+}
+
+TEST_CASE("boxed_error", "[boxed_error]") {
+    using Boxed = std::expected<int, kz::boxed_error<Diagnostic>>;
+    const Diagnostic diag{"bad token", "parser.cpp", 42, {"in expression", "in statement"}};
+
+    SECTION("Value") {
+        Boxed a(7);
+        REQUIRE(a);
+        REQUIRE(*a == 7);
+    }
+
+    SECTION("Construct from unexpected") {
+        Boxed a = std::unexpected(diag);
+        REQUIRE(!a);
+        REQUIRE(a.error()->message == "bad token");
+        REQUIRE(*a.error() == diag);
+        REQUIRE(a.error() == diag);
+    }
+
+    SECTION("Construct using unexpect_t") {
+        Boxed a(std::unexpect, std::in_place, "oops", "main.cpp", 1, std::vector<std::string>{});
+        REQUIRE(!a);
+        REQUIRE(a.error()->file == "main.cpp");
+        REQUIRE(a.error()->context.empty());
+    }
+
+    SECTION("Copy and move") {
+        Boxed a = std::unexpected(diag);
+        Boxed b(a);
+        REQUIRE(&*b.error() != &*a.error());
+        REQUIRE(b.error() == a.error());
+
+        const Diagnostic* p = &*a.error();
+        Boxed c(std::move(a));
+        REQUIRE(&*c.error() == p);
+
+        b = Boxed(3);
+        REQUIRE(*b == 3);
+        b = c;
+        REQUIRE(b.error() == diag);
+    }
+
+    SECTION("Blocks are reused") {
+        const Diagnostic* p;
+        {
+            kz::boxed_error<Diagnostic> a(diag);
+            p = &*a;
+        }
+        kz::boxed_error<Diagnostic> b(diag);
+        REQUIRE(&*b == p);
+    }
+
+    SECTION("Freed on another thread") {
+        std::vector<kz::boxed_error<Diagnostic>> errors;
+        for (int i = 0; i != 100; ++i) {
+            errors.emplace_back(diag);
+        }
+        std::thread t([&] { errors.clear(); });
+        t.join();
+        REQUIRE(errors.empty());
+    }
+
+    SECTION("Freed after the thread's pool is released") {
+        std::thread t([&] {
+            // Constructed before the pool's releaser, so destroyed after it
+            thread_local std::vector<kz::boxed_error<Diagnostic>> late;
+            late.reserve(2);
+            late.emplace_back(diag);
+            late.emplace_back(diag);
+        });
+        t.join();
+    }
+
+    SECTION("Moved-from boxes") {
+        kz::boxed_error<Diagnostic> a(diag);
+        kz::boxed_error<Diagnostic> b(std::move(a));
+        kz::boxed_error<Diagnostic> c(std::move(b));
+        REQUIRE(a == b);
+        REQUIRE(!(a == c));
+        REQUIRE(!(c == a));
+        REQUIRE(!(a == diag));
+        REQUIRE(c == diag);
+    }
+
+#if KZ_EXCEPTIONS
+    SECTION("value() throws") {
+        Boxed a = std::unexpected(diag);
+        try {
+            a.value();
+            FAIL();
+        } catch (const std::bad_expected_access<kz::boxed_error<Diagnostic>>& e) {
+            REQUIRE(e.error()->line == 42);
+        }
+    }
+#endif
+}
@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/channel.hpp>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("result_channel layout", "[channel]") {
+    static_assert(alignof(kz::result_channel<int, int>) == KZ_CACHE_LINE_SIZE);
+    static_assert(sizeof(kz::result_channel<int, int>) == KZ_CACHE_LINE_SIZE);
+}
+
+TEST_CASE("result_channel", "[channel]") {
+    SECTION("value") {
+        kz::result_channel<std::string, int> channel;
+        auto future = channel.get_future();
+        REQUIRE(future.valid());
+        REQUIRE(!future.ready());
+
+        channel.set_value("hello");
+        REQUIRE(future.ready());
+
+        const auto r = std::move(future).get();
+        REQUIRE(r == "hello");
+        REQUIRE(!future.valid());
+    }
+
+    SECTION("error") {
+        kz::result_channel<void, std::string> channel;
+        auto future = channel.get_future();
+        channel.set_error("failed");
+        REQUIRE(std::move(future).get() == std::unexpected("failed"));
+    }
+
+    SECTION("emplace an expected") {
+        kz::result_channel<int, int> channel;
+        auto future = channel.get_future();
+        channel.emplace(std::expected<int, int>(std::unexpect, 3));
+        REQUIRE(std::move(future).get().error() == 3);
+    }
+
+    SECTION("continuations") {
+        kz::result_channel<int, int> channel;
+        auto future = channel.get_future()
+            | kz::transform([](int x) { return x * 2; })
+            | kz::and_then([](int x) -> std::expected<std::string, int> {
+                  if (x > 100)
+                      return std::unexpected(x);
+                  return std::to_string(x);
+              })
+            | kz::transform_error([](int e) { return "too large: " + std::to_string(e); });
+
+        static_assert(std::is_same_v<decltype(std::move(future).get()), std::expected<std::string, std::string>>);
+
+        channel.set_value(21);
+        REQUIRE(std::move(future).get() == "42");
+
+        kz::result_channel<int, int> channel2;
+        auto future2 = channel2.get_future()
+            | kz::transform([](int x) { return x * 2; })
+            | kz::transform_error([](int e) { return std::to_string(e); });
+        channel2.set_value(60);
+        REQUIRE(std::move(future2).get() == 120);
+    }
+
+    SECTION("across threads") {
+        kz::result_channel<std::vector<int>, std::string> channel;
+        auto future = channel.get_future();
+
+        std::thread producer([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            channel.set_value(std::vector<int>{1, 2, 3});
+        });
+
+        // Blocks until the producer publishes
+        const auto r = std::move(future).get();
+        producer.join();
+
+        REQUIRE(r == std::vector<int>{1, 2, 3});
+    }
+
+    SECTION("many handoffs") {
+        for (int i = 0; i != 200; ++i) {
+            auto channel = std::make_unique<kz::result_channel<int, int>>();
+            auto future = channel->get_future();
+            std::thread producer([&] {
+                if (i % 2)
+                    channel->set_value(i);
+                else
+                    channel->set_error(-i);
+            });
+            const auto r = std::move(future).get();
+            producer.join();
+            REQUIRE(r.has_value() == (i % 2 == 1));
+        }
+    }
+}
@@ -0,0 +1,94 @@
+# Disassemble one function of an object file and check its instruction budget.
+#
+# cmake -DOBJDUMP=<path> -DOBJECT=<file> -DSYMBOL=<name>
+#       [-DMAX_INSTRUCTIONS=<n>] [-DMAX_BRANCHES=<n>] [-DALLOW_CALLS=ON]
+#       [-DMAX_STACK=<bytes>] [-DNO_STORES=ON]
+#       -P check.cmake
+#
+# Every instruction of the function is counted, whichever arm the compiler
+# lays out first: a spill or a branch added to the error arm is caught too.
+# Only code moved to a separate .cold section is ignored.
+#
+# The stack used is what the function pushes and subtracts from %rsp, summed
+# over all its arms: spills and locals show up there. NO_STORES fails on any write to memory, which is
+# how a result returned through a hidden pointer, rather than in registers,
+# shows up.
+
+execute_process(
+    COMMAND ${OBJDUMP} -d --no-show-raw-insn ${OBJECT}
+    OUTPUT_VARIABLE disassembly
+    RESULT_VARIABLE result
+)
+
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${OBJDUMP} failed on ${OBJECT}")
+endif()
+
+string(REPLACE "\n" ";" lines "${disassembly}")
+
+set(in_function FALSE)
+set(instructions 0)
+set(branches 0)
+set(calls 0)
+set(stack 0)
+set(stores 0)
+set(listing "")
+
+foreach (line IN LISTS lines)
+    if (line MATCHES "^[0-9a-f]+ <${SYMBOL}>:$")
+        set(in_function TRUE)
+    elseif (in_function)
+        if (NOT line MATCHES "^ +[0-9a-f]+:\t")
+            break()
+        endif()
+        string(REGEX REPLACE "^ +[0-9a-f]+:\t *" "" instruction "${line}")
+        string(APPEND listing "    ${instruction}\n")
+        if (instruction MATCHES "^(nop|xchg +%ax,%ax|data16|cs nopw)")
+            continue()
+        endif()
+        math(EXPR instructions "${instructions} + 1")
+        if (instruction MATCHES "^j[a-z]+ ")
+            math(EXPR branches "${branches} + 1")
+        endif()
+        if (instruction MATCHES "^call")
+            math(EXPR calls "${calls} + 1")
+        endif()
+        if (instruction MATCHES "^push")
+            math(EXPR stack "${stack} + 8")
+        elseif (instruction MATCHES "^sub +\\$0x([0-9a-f]+),%rsp$")
+            math(EXPR stack "${stack} + 0x${CMAKE_MATCH_1}")
+        endif()
+        # AT&T syntax: the destination is the last operand
+        string(REGEX REPLACE " *#.*$" "" operands "${instruction}")
+        if (NOT operands MATCHES "^(cmp|test|bt[wlq]? |call|j[a-z]+ |push|prefetch)" AND
+            operands MATCHES "^[a-z0-9]+ +([^,]*,)*[^,]*\\)$")
+            math(EXPR stores "${stores} + 1")
+        endif()
+    endif()
+endforeach()
+
+if (NOT in_function)
+    message(FATAL_ERROR "Symbol ${SYMBOL} not found in ${OBJECT}")
+endif()
+
+message("${SYMBOL}: ${instructions} instructions, ${branches} branches, ${calls} calls, ${stack} bytes of stack, ${stores} stores\n${listing}")
+
+if (DEFINED MAX_INSTRUCTIONS AND instructions GREATER MAX_INSTRUCTIONS)
+    message(FATAL_ERROR "${SYMBOL}: ${instructions} instructions, budget is ${MAX_INSTRUCTIONS}")
+endif()
+
+if (DEFINED MAX_BRANCHES AND branches GREATER MAX_BRANCHES)
+    message(FATAL_ERROR "${SYMBOL}: ${branches} branches, budget is ${MAX_BRANCHES}")
+endif()
+
+if (NOT ALLOW_CALLS AND calls GREATER 0)
+    message(FATAL_ERROR "${SYMBOL}: calls out of line")
+endif()
+
+if (DEFINED MAX_STACK AND stack GREATER MAX_STACK)
+    message(FATAL_ERROR "${SYMBOL}: ${stack} bytes of stack, budget is ${MAX_STACK}")
+endif()
+
+if (NO_STORES AND stores GREATER 0)
+    message(FATAL_ERROR "${SYMBOL}: stores to memory")
+endif()
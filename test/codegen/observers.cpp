@@ -0,0 +1,53 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// has_value() and operator* on the common shapes of expected: a flag test and
+// a load, inlined, with no call and no stack frame.
+
+#include <kz/expected.hpp>
+#include <string>
+
+extern "C" bool codegen_has_value(const kz::expected<int, int>& e) {
+    return e.has_value();
+}
+
+extern "C" bool codegen_has_value_string(const kz::expected<std::string, int>& e) {
+    return e.has_value();
+}
+
+extern "C" int codegen_dereference(const kz::expected<int, int>& e) {
+    return *e;
+}
+
+extern "C" std::size_t codegen_dereference_string(const kz::expected<std::string, int>& e) {
+    return e->size();
+}
+
+// The usual test-then-use: a single branch
+extern "C" int codegen_has_value_dereference(const kz::expected<int, int>& e) {
+    return e.has_value() ? *e : -1;
+}
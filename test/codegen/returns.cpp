@@ -0,0 +1,59 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// expected<int, int> is 8 bytes and trivially copyable: it must be returned
+// in a register, never through a hidden pointer to the caller's stack.
+
+#include <kz/expected.hpp>
+#include <type_traits>
+
+static_assert(sizeof(kz::expected<int, int>) == 8);
+static_assert(std::is_trivially_copyable_v<kz::expected<int, int>>);
+
+extern "C" kz::expected<int, int> codegen_return_value(int x) {
+    return x;
+}
+
+extern "C" kz::expected<int, int> codegen_return_error(int x) {
+    return kz::unexpected(x);
+}
+
+extern "C" kz::expected<int, int> codegen_return_either(int x) {
+    if (x < 0)
+        return kz::unexpected(-x);
+    return x;
+}
+
+kz::expected<int, int> codegen_callee(int x);
+
+// Passing a result through must not bounce it off the stack
+extern "C" kz::expected<int, int> codegen_return_forward(int x) {
+    auto r = codegen_callee(x);
+    if (!r)
+        return kz::unexpected(r.error() + 1);
+    return r;
+}
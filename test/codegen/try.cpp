@@ -0,0 +1,48 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// KZ_TRY_ASSIGN against the equivalent and_then() chain: both should compile
+// to the same calls and tests, with no closure left behind.
+
+#include <kz/expected.hpp>
+#include <kz/expected_bits/try.hpp>
+
+kz::expected<int, int> codegen_step(int x);
+
+extern "C" kz::expected<int, int> codegen_try_chain(int x) {
+    KZ_TRY_ASSIGN(auto a, codegen_step(x));
+    KZ_TRY_ASSIGN(auto b, codegen_step(a));
+    KZ_TRY_ASSIGN(auto c, codegen_step(b));
+    return c + 1;
+}
+
+extern "C" kz::expected<int, int> codegen_and_then_chain(int x) {
+    return codegen_step(x)
+        .and_then([](int a) { return codegen_step(a); })
+        .and_then([](int b) { return codegen_step(b); })
+        .transform([](int c) { return c + 1; });
+}
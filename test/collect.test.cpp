@@ -0,0 +1,194 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/collect.hpp>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Runs each task on a thread of its own, joined on destruction
+    struct ThreadExecutor {
+        std::vector<std::thread> threads;
+        int concurrency() const { return 4; }
+        template <class F>
+        void execute(F&& f) { threads.emplace_back(std::forward<F>(f)); }
+        ~ThreadExecutor() {
+            for (auto& thread : threads)
+                thread.join();
+        }
+    };
+
+    // Only runs the tasks when asked to, after the call has returned
+    struct DeferredExecutor {
+        std::vector<std::function<void()>> tasks;
+        int concurrency() const { return 3; }
+        void execute(std::function<void()> f) { tasks.push_back(std::move(f)); }
+        void drain() {
+            for (auto& task : tasks)
+                task();
+            tasks.clear();
+        }
+    };
+
+    std::expected<int, std::string> checked(int x) {
+        if (x < 0)
+            return std::unexpected("negative: " + std::to_string(x));
+        return x * 2;
+    }
+
+} // namespace
+
+TEST_CASE("collect", "[collect]") {
+    SECTION("values") {
+        std::vector<std::expected<std::string, int>> v{"a", "b", "c"};
+        const auto r = kz::collect(v);
+        static_assert(std::is_same_v<decltype(r), const std::expected<std::vector<std::string>, int>>);
+        REQUIRE(r == std::vector<std::string>{"a", "b", "c"});
+        REQUIRE(r->capacity() == 3);
+        REQUIRE(v[0] == "a");
+    }
+
+    SECTION("rvalue range is moved from") {
+        std::vector<std::expected<std::unique_ptr<int>, int>> v;
+        v.emplace_back(std::make_unique<int>(1));
+        v.emplace_back(std::make_unique<int>(2));
+        const auto r = kz::collect(std::move(v));
+        REQUIRE(r.has_value());
+        REQUIRE(*(*r)[1] == 2);
+    }
+
+    SECTION("stops at the first error") {
+        int visited = 0;
+        std::vector<std::expected<int, std::string>> v{1, std::unexpected("first"), 3, std::unexpected("second")};
+        const auto r = kz::collect(v | std::views::transform([&](const auto& e) { ++visited; return e; }));
+        REQUIRE(r == std::unexpected("first"));
+        REQUIRE(visited == 2);
+    }
+
+    SECTION("views are not moved from") {
+        std::vector<std::expected<std::string, int>> v{"a", "b"};
+        const auto r = kz::collect(std::views::all(v));
+        REQUIRE(r == std::vector<std::string>{"a", "b"});
+        REQUIRE(v[1] == "b");
+    }
+
+    SECTION("input range") {
+        std::list<std::expected<int, int>> l{1, 2};
+        REQUIRE(kz::collect(l) == std::vector<int>{1, 2});
+    }
+
+    SECTION("void") {
+        std::vector<std::expected<void, int>> v(3);
+        REQUIRE(kz::collect(v).has_value());
+        v[1] = std::unexpected(7);
+        REQUIRE(kz::collect(v) == std::unexpected(7));
+    }
+
+    SECTION("empty") {
+        std::vector<std::expected<int, int>> v;
+        REQUIRE(kz::collect(v) == std::vector<int>{});
+    }
+}
+
+TEST_CASE("parallel_transform_collect", "[collect]") {
+    std::vector<int> input(1000);
+    for (int i = 0; i != 1000; ++i)
+        input[i] = i;
+
+    SECTION("values in order") {
+        ThreadExecutor executor;
+        const auto r = kz::parallel_transform_collect(input, checked, executor);
+        REQUIRE(r.has_value());
+        REQUIRE(r->size() == 1000);
+        for (int i = 0; i != 1000; ++i)
+            REQUIRE((*r)[i] == i * 2);
+    }
+
+    SECTION("first error in order, later items cancelled") {
+        input[700] = -1;
+        input[300] = -2;
+        std::atomic<int> calls{0};
+        ThreadExecutor executor;
+        const auto r = kz::parallel_transform_collect(input, [&](int x) { ++calls; return checked(x); }, executor);
+        REQUIRE(r == std::unexpected("negative: -2"));
+        REQUIRE(calls < 1000);
+    }
+
+    SECTION("the caller does the work when the executor does not run anything") {
+        DeferredExecutor executor;
+        input[10] = -3;
+        const auto r = kz::parallel_transform_collect(input, checked, executor);
+        REQUIRE(r == std::unexpected("negative: -3"));
+        REQUIRE(executor.tasks.size() == 2);
+
+        // Late tasks find nothing to do
+        executor.drain();
+
+        input[10] = 10;
+        const auto r2 = kz::parallel_transform_collect(std::views::all(input) | std::views::take(5), checked, executor);
+        REQUIRE(r2 == std::vector<int>{0, 2, 4, 6, 8});
+        executor.drain();
+    }
+
+    SECTION("void") {
+        std::atomic<int> sum{0};
+        ThreadExecutor executor;
+        const auto r = kz::parallel_transform_collect(input, [&](int x) -> std::expected<void, int> {
+            sum += x;
+            return {};
+        }, executor);
+        REQUIRE(r.has_value());
+        REQUIRE(sum == 999 * 1000 / 2);
+    }
+
+    SECTION("empty") {
+        DeferredExecutor executor;
+        const auto r = kz::parallel_transform_collect(std::vector<int>{}, checked, executor);
+        REQUIRE(r == std::vector<int>{});
+        REQUIRE(executor.tasks.empty());
+    }
+
+#if KZ_EXCEPTIONS
+    SECTION("exceptions are rethrown") {
+        ThreadExecutor executor;
+        REQUIRE_THROWS_AS(kz::parallel_transform_collect(input, [](int x) -> std::expected<int, int> {
+            if (x == 500)
+                throw std::runtime_error("oops");
+            return x;
+        }, executor), std::runtime_error);
+    }
+#endif
+}
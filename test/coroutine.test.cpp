@@ -0,0 +1,188 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/coroutine.hpp>
+#include <catch2/catch.hpp>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#if KZ_EXPECTED_COROUTINES
+
+// Count heap allocations made by this thread
+namespace {
+    thread_local std::size_t allocations = 0;
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+#if KZ_EXCEPTIONS
+    throw std::bad_alloc();
+#else
+    std::abort();
+#endif
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+    enum class Error { Negative, TooLarge, Empty };
+
+    std::expected<int, Error> parse(int x) {
+        if (x < 0)
+            return std::unexpected(Error::Negative);
+        return x;
+    }
+
+    std::expected<int, Error> twice(int x) {
+        const int a = co_await parse(x);
+        if (a > 1000)
+            co_await std::unexpected(Error::TooLarge);
+        co_return a * 2;
+    }
+
+    std::expected<void, Error> check(int x) {
+        co_await twice(x);
+    }
+
+    std::expected<int, Error> nested(int x) {
+        co_await check(x);
+        const int a = co_await twice(x);
+        const int b = co_await twice(a);
+        co_return a + b;
+    }
+
+    // Error types only have to be convertible
+    std::expected<std::string, std::string> describe(int x) {
+        auto r = parse(x).transform_error([](Error) { return std::string("negative"); });
+        co_return std::to_string(co_await std::move(r));
+    }
+
+    // Large frame: doesn't fit in the per-thread frame stack
+    std::expected<int, Error> large(int x) {
+        volatile char buffer[128 * 1024];
+        buffer[x] = static_cast<char>(x);
+        co_return co_await parse(buffer[x]);
+    }
+
+    struct AllocatorCounts {
+        std::size_t allocations = 0;
+        std::size_t deallocations = 0;
+    };
+
+    // Allocator that counts what it hands out and gets back
+    template <class T>
+    struct CountingAllocator {
+        using value_type = T;
+
+        AllocatorCounts* counts;
+
+        explicit CountingAllocator(AllocatorCounts* c) : counts(c) {}
+        template <class U>
+        CountingAllocator(const CountingAllocator<U>& other) : counts(other.counts) {}
+
+        T* allocate(std::size_t n) {
+            ++counts->allocations;
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n) {
+            ++counts->deallocations;
+            std::allocator<T>().deallocate(p, n);
+        }
+    };
+
+    std::expected<int, Error> with_allocator(std::allocator_arg_t, CountingAllocator<int>, int x) {
+        co_return co_await twice(x);
+    }
+
+} // namespace
+
+TEST_CASE("coroutines", "[coroutine]") {
+    SECTION("value") {
+        REQUIRE(twice(21) == 42);
+        REQUIRE(nested(3) == 6 + 12);
+
+        std::expected<void, Error> c = check(1);
+        REQUIRE(c.has_value());
+    }
+
+    SECTION("errors short-circuit") {
+        REQUIRE(twice(-1) == std::unexpected(Error::Negative));
+        REQUIRE(twice(2000) == std::unexpected(Error::TooLarge));
+        REQUIRE(check(-1) == std::unexpected(Error::Negative));
+        REQUIRE(nested(-1) == std::unexpected(Error::Negative));
+        REQUIRE(nested(600) == std::unexpected(Error::TooLarge));
+    }
+
+    SECTION("error conversion") {
+        REQUIRE(describe(7) == "7");
+        REQUIRE(describe(-7) == std::unexpected("negative"));
+    }
+
+    SECTION("large frames come from the heap") {
+        REQUIRE(large(5) == 5);
+    }
+
+    SECTION("custom allocator") {
+        AllocatorCounts counts;
+        REQUIRE(with_allocator(std::allocator_arg, CountingAllocator<int>(&counts), 4) == 8);
+        REQUIRE(with_allocator(std::allocator_arg, CountingAllocator<int>(&counts), -4) == std::unexpected(Error::Negative));
+        REQUIRE(counts.allocations > 0);
+        REQUIRE(counts.allocations == counts.deallocations);
+    }
+
+    SECTION("no heap allocation") {
+        // The first coroutine on this thread sets up the frame stack
+        REQUIRE(nested(1) == 6);
+
+        allocations = 0;
+        int sum = 0;
+        for (int i = -10; i != 10; ++i) {
+            sum += nested(i).value_or(0);
+            sum += check(i).has_value();
+        }
+        const std::size_t count = allocations;
+
+        REQUIRE(sum == 6 * 45 + 10);
+        REQUIRE(count == 0);
+    }
+}
+
+#endif
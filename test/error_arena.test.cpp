@@ -0,0 +1,178 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/error_arena.hpp>
+#include <catch2/catch.hpp>
+#include <iterator>
+#include <string>
+#include <thread>
+
+namespace {
+
+    std::expected<int, kz::arena_error> parse_port(int port) {
+        if (port < 0 || port > 65535)
+            return std::unexpected(kz::arena_error::format("invalid port %d", port).with_context("field", "port"));
+        return port;
+    }
+
+} // namespace
+
+TEST_CASE("error_arena", "[error_arena]") {
+    kz::error_arena arena;
+    const auto capacity = arena.capacity();
+    REQUIRE(capacity == kz::error_arena::inline_size);
+
+    SECTION("allocate and rewind") {
+        const auto mark = arena.mark();
+        void* a = arena.allocate(10);
+        void* b = arena.allocate(8, 8);
+        REQUIRE(a != b);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(b) % 8 == 0);
+        arena.rewind(mark);
+        REQUIRE(arena.allocate(10) == a);
+    }
+
+    SECTION("copy and format") {
+        const auto s = arena.copy("hello");
+        REQUIRE(s == "hello");
+        REQUIRE(arena.format("%s %d", "value", 42) == "value 42");
+        REQUIRE(s == "hello");
+    }
+
+    SECTION("grows, then reuses its blocks") {
+        const std::string large(10000, 'x');
+        REQUIRE(arena.copy(large) == large);
+        REQUIRE(arena.format("%s!", large.c_str()) == large + "!");
+        const auto grown = arena.capacity();
+        REQUIRE(grown > capacity);
+
+        for (int i = 0; i != 10; ++i) {
+            arena.reset();
+            REQUIRE(arena.copy(large) == large);
+            REQUIRE(arena.format("%s!", large.c_str()) == large + "!");
+        }
+        REQUIRE(arena.capacity() == grown);
+    }
+
+    SECTION("scope") {
+        const auto mark = arena.mark();
+        void* before = nullptr;
+        {
+            kz::error_arena::scope scope(arena);
+            before = arena.allocate(100);
+            {
+                kz::error_arena::scope inner(arena);
+                arena.allocate(10000);
+            }
+            REQUIRE(arena.allocate(1) != nullptr);
+        }
+        arena.rewind(mark);
+        REQUIRE(arena.allocate(100) == before);
+    }
+}
+
+TEST_CASE("arena_error", "[error_arena]") {
+    kz::error_arena::scope scope;
+
+    SECTION("message and context") {
+        auto e = kz::arena_error("connection refused").with_context("host", "example.com").with_context("port", "80");
+        REQUIRE(e.message() == "connection refused");
+        REQUIRE(e.context("host") == "example.com");
+        REQUIRE(e.context("port") == "80");
+        REQUIRE(e.context("missing").empty());
+
+        int count = 0;
+        for (const auto& entry : e.context()) {
+            REQUIRE(!entry.key.empty());
+            ++count;
+        }
+        REQUIRE(count == 2);
+    }
+
+    SECTION("copies are independent") {
+        const auto original = kz::arena_error("timeout").with_context("host", "example.com");
+        auto copy = original;
+        copy.with_context("port", "80");
+        REQUIRE(original.context("port").empty());
+        REQUIRE(std::distance(original.context().begin(), original.context().end()) == 1);
+        REQUIRE(copy.context("host") == "example.com");
+        REQUIRE(copy.context("port") == "80");
+
+        // The original's last entry already has a successor: its entries are copied
+        auto other = original;
+        other.with_context("retry", "3");
+        REQUIRE(other.context("port").empty());
+        REQUIRE(other.context("retry") == "3");
+        REQUIRE(std::distance(other.context().begin(), other.context().end()) == 2);
+        REQUIRE(copy.context("retry").empty());
+        REQUIRE(std::distance(copy.context().begin(), copy.context().end()) == 2);
+
+        kz::arena_error empty;
+        auto filled = empty;
+        filled.with_context("key", "value");
+        REQUIRE(empty.context().empty());
+        REQUIRE(filled.context("key") == "value");
+    }
+
+    SECTION("default") {
+        const kz::arena_error e;
+        REQUIRE(e.message().empty());
+        REQUIRE(e.context().empty());
+    }
+
+    SECTION("in an expected") {
+        static_assert(sizeof(kz::arena_error) == sizeof(void*));
+        static_assert(std::is_trivially_copyable_v<std::expected<int, kz::arena_error>>);
+
+        REQUIRE(parse_port(80) == 80);
+        const auto r = parse_port(70000);
+        REQUIRE(!r);
+        REQUIRE(r.error().message() == "invalid port 70000");
+        REQUIRE(r.error().context("field") == "port");
+        REQUIRE(r.error() == kz::arena_error("invalid port 70000").with_context("field", "port"));
+        REQUIRE(r.error() != kz::arena_error("invalid port 70000"));
+    }
+
+    SECTION("steady state does not grow") {
+        auto& arena = kz::error_arena::current();
+        const auto capacity = arena.capacity();
+        for (int i = 0; i != 1000; ++i) {
+            kz::error_arena::scope inner;
+            const auto r = parse_port(100000 + i);
+            REQUIRE(!r);
+        }
+        REQUIRE(arena.capacity() == capacity);
+    }
+
+    SECTION("one arena per thread") {
+        const auto* main_arena = &kz::error_arena::current();
+        const kz::error_arena* other = nullptr;
+        std::thread([&] { other = &kz::error_arena::current(); }).join();
+        REQUIRE(other != main_arena);
+    }
+}
@@ -0,0 +1,146 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/error_code.hpp>
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+    class TestCategory : public std::error_category {
+    public:
+        const char* name() const noexcept override { return "test"; }
+        std::string message(int value) const override { return "test error " + std::to_string(value); }
+    };
+
+    const TestCategory& test_category() {
+        static const TestCategory category;
+        return category;
+    }
+
+    const int test_category_id = kz::register_error_category(test_category());
+
+} // namespace
+
+TEST_CASE("error_code layout", "[error_code]") {
+    static_assert(sizeof(kz::error_code) == 4);
+    static_assert(sizeof(std::expected<std::int32_t, kz::error_code>) == 8);
+    static_assert(std::is_trivially_copyable_v<std::expected<std::int32_t, kz::error_code>>);
+}
+
+TEST_CASE("error_code", "[error_code]") {
+    SECTION("default") {
+        const kz::error_code ec;
+        REQUIRE(!ec);
+        REQUIRE(ec.value() == 0);
+        REQUIRE(ec.category() == std::system_category());
+        REQUIRE(ec == std::error_code());
+    }
+
+    SECTION("value and category") {
+        const kz::error_code ec(ENOENT, std::generic_category());
+        REQUIRE(ec);
+        REQUIRE(ec.value() == ENOENT);
+        REQUIRE(ec.category_id() == kz::error_code::generic_category_id);
+        REQUIRE(ec.category() == std::generic_category());
+        REQUIRE(ec.message() == std::generic_category().message(ENOENT));
+        REQUIRE(ec == std::errc::no_such_file_or_directory);
+        REQUIRE(ec == kz::error_code::from_id(kz::error_code::generic_category_id, ENOENT));
+        REQUIRE(ec != kz::error_code(ENOENT, std::system_category()));
+    }
+
+    SECTION("negative values") {
+        const kz::error_code ec(kz::error_code::min_value, test_category());
+        REQUIRE(ec.value() == kz::error_code::min_value);
+        REQUIRE(kz::error_code(-1, test_category()).value() == -1);
+        REQUIRE(kz::error_code(kz::error_code::max_value, test_category()).value() == kz::error_code::max_value);
+    }
+
+    SECTION("registered categories") {
+        REQUIRE(test_category_id >= 2);
+        const kz::error_code ec(42, test_category());
+        REQUIRE(ec.category_id() == test_category_id);
+        REQUIRE(&ec.category() == &test_category());
+        REQUIRE(ec.message() == "test error 42");
+        REQUIRE(kz::register_error_category(test_category()) == test_category_id);
+        REQUIRE(kz::register_error_category(std::system_category()) == kz::error_code::system_category_id);
+    }
+
+    SECTION("error code enums") {
+        const kz::error_code ec = std::future_errc::no_state;
+        REQUIRE(ec.category() == std::future_category());
+        REQUIRE(ec == std::make_error_code(std::future_errc::no_state));
+    }
+
+    SECTION("conversions to and from std::error_code") {
+        const std::error_code original(EACCES, std::system_category());
+        const kz::error_code ec(original);
+        const std::error_code back = ec;
+        REQUIRE(back == original);
+        REQUIRE(&back.category() == &original.category());
+
+        REQUIRE(kz::to_error_code(original) == ec);
+
+        const std::error_code large(1 << 24, std::system_category());
+        REQUIRE(kz::to_error_code(large) == std::unexpected(large));
+    }
+
+    SECTION("errors that do not fit") {
+        const kz::error_code large(kz::error_code::max_value + 1, test_category());
+        REQUIRE(large);
+        REQUIRE(large.category_id() == kz::error_code::unknown_category_id);
+        REQUIRE(large.value() == 1);
+        REQUIRE(large.category().name() == std::string("kz::unknown"));
+        REQUIRE(kz::error_code(kz::error_code::min_value - 1, std::system_category()) == large);
+
+        kz::detail::error_category_registry registry;
+        std::vector<TestCategory> categories(kz::error_code::unknown_category_id);
+        for (std::size_t i = 0; i != categories.size(); ++i)
+            REQUIRE(registry.find_or_add(categories[i]) == (i + 2 < kz::error_code::unknown_category_id ? int(i + 2) : -1));
+    }
+
+    SECTION("bits") {
+        const kz::error_code ec(7, test_category());
+        REQUIRE(kz::error_code::from_bits(ec.bits()) == ec);
+        REQUIRE(ec.bits() == ((static_cast<std::uint32_t>(test_category_id) << 24) | 7));
+    }
+
+    SECTION("in an expected") {
+        const auto open = [](bool ok) -> std::expected<std::int32_t, kz::error_code> {
+            if (!ok)
+                return std::unexpected(kz::error_code(EBADF, std::generic_category()));
+            return 3;
+        };
+        REQUIRE(open(true) == 3);
+        REQUIRE(open(false).error() == std::errc::bad_file_descriptor);
+    }
+}
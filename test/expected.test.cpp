@@ -28,9 +28,35 @@
 #include <expected>
 #include <catch2/catch.hpp>
 #include "value.hpp"
+#include <csetjmp>
+#include <mutex>
+#include <ranges>
+#include <string>
+#include <system_error>
+
+// <expected> brings namespace kz into std: none of its names may clash with
+// the standard ones for code that is using namespace std
+namespace using_std {
+    using namespace std;
+    using code = error_code;
+    inline constexpr auto odd = views::filter([](int i) { return i % 2 != 0; });
+} // namespace using_std
 
 enum class Error { FileNotFound, IOError, FlyingSquirrels };
 
+#if !KZ_EXCEPTIONS
+// Handler for bad accesses that jumps back into the test
+struct BadAccess {
+    static inline std::jmp_buf jump;
+    static inline const char* what;
+
+    static void handler(const char* w) {
+        what = w;
+        std::longjmp(jump, 1);
+    }
+};
+#endif
+
 TEST_CASE("static assertions", "[expected]") {
     using T = std::expected<short, bool>;
     static_assert(std::is_same_v<T::value_type, short>);
@@ -390,6 +416,61 @@ TEST_CASE("Construct using unexpect_t and initializer_list") {
     // TODO: more tests, including with extra params
 }
 
+TEST_CASE("Construct using invoke_tag", "[expected]") {
+    // Neither copyable nor movable
+    struct Guarded {
+        explicit Guarded(int v) : value(v) {}
+        Guarded(const Guarded&) = delete;
+        Guarded& operator=(const Guarded&) = delete;
+
+        std::mutex mutex;
+        int value;
+    };
+
+    SECTION("value") {
+        std::expected<Guarded, Error> a(kz::invoke_tag, [](int x) { return Guarded(x); }, 3);
+        REQUIRE(a->value == 3);
+    }
+
+    SECTION("error") {
+        std::expected<int, Guarded> a(kz::invoke_tag, std::unexpect, [] { return Guarded(4); });
+        REQUIRE(a.error().value == 4);
+
+        std::expected<void, Guarded> b(kz::invoke_tag, std::unexpect, [] { return Guarded(5); });
+        REQUIRE(b.error().value == 5);
+    }
+
+    SECTION("reference") {
+        int x = 6;
+        std::expected<int&, Error> a(kz::invoke_tag, [&]() -> int& { return x; });
+        REQUIRE(&*a == &x);
+    }
+
+    SECTION("transform() constructs in place") {
+        const std::expected<int, Error> a{7};
+        const auto b = a.transform([](int v) { return Guarded(v * 2); });
+        REQUIRE(b->value == 14);
+
+        const std::expected<int, Error> c{std::unexpected(Error::IOError)};
+        const auto d = c.transform([](int v) { return Guarded(v); });
+        REQUIRE(d.error() == Error::IOError);
+
+        const std::expected<void, Error> e{};
+        const auto f = e.transform([] { return Guarded(8); });
+        REQUIRE(f->value == 8);
+    }
+
+    SECTION("transform_error() constructs in place") {
+        const std::expected<int, Error> a{std::unexpected(Error::IOError)};
+        const auto b = a.transform_error([](Error) { return Guarded(9); });
+        REQUIRE(b.error().value == 9);
+
+        const std::expected<void, Error> c{std::unexpected(Error::IOError)};
+        const auto d = c.transform_error([](Error) { return Guarded(10); });
+        REQUIRE(d.error().value == 10);
+    }
+}
+
 TEST_CASE("Destructor", "[expected]") {
     // TODO: verify destructors for T and E are called
 
@@ -410,6 +491,74 @@ TEST_CASE("Destructor", "[expected]") {
 #endif
 }
 
+TEST_CASE("Assignment", "[expected]") {
+#if KZ_P0848R3
+    SECTION("T and E are trivially-assignable") {
+        using Type1 = std::expected<int, int>;
+        using Type2 = std::expected<int, Error>;
+        using Type3 = std::expected<double, int>;
+        using Type4 = std::expected<int*, long>;
+        using Type5 = std::expected<void, int>;
+        using Type6 = std::expected<void, Error>;
+
+        static_assert(std::is_trivially_copy_assignable_v<Type1>);
+        static_assert(std::is_trivially_move_assignable_v<Type1>);
+        static_assert(std::is_trivially_copy_assignable_v<Type5>);
+        static_assert(std::is_trivially_move_assignable_v<Type5>);
+
+        static_assert(std::is_trivially_copyable_v<Type1>);
+        static_assert(std::is_trivially_copyable_v<Type2>);
+        static_assert(std::is_trivially_copyable_v<Type3>);
+        static_assert(std::is_trivially_copyable_v<Type4>);
+        static_assert(std::is_trivially_copyable_v<Type5>);
+        static_assert(std::is_trivially_copyable_v<Type6>);
+    }
+
+    SECTION("T or E is not trivially-assignable") {
+        using Type1 = std::expected<std::vector<int>, Error>;
+        using Type2 = std::expected<int, std::vector<int>>;
+        using Type3 = std::expected<void, std::vector<int>>;
+        using Type4 = std::expected<MoveAssignable, int>;
+
+        static_assert(std::is_copy_assignable_v<Type1>);
+        static_assert(!std::is_trivially_copy_assignable_v<Type1>);
+        static_assert(!std::is_trivially_move_assignable_v<Type1>);
+        static_assert(std::is_copy_assignable_v<Type2>);
+        static_assert(!std::is_trivially_copy_assignable_v<Type2>);
+        static_assert(!std::is_trivially_move_assignable_v<Type2>);
+        static_assert(std::is_copy_assignable_v<Type3>);
+        static_assert(!std::is_trivially_copy_assignable_v<Type3>);
+        static_assert(!std::is_trivially_move_assignable_v<Type3>);
+        static_assert(!std::is_trivially_move_assignable_v<Type4>);
+
+        static_assert(!std::is_trivially_copyable_v<Type1>);
+        static_assert(!std::is_trivially_copyable_v<Type2>);
+        static_assert(!std::is_trivially_copyable_v<Type3>);
+    }
+#endif
+
+    SECTION("State transitions, trivial types") {
+        std::expected<int, int> a(1);
+        std::expected<int, int> b(std::unexpect, 2);
+
+        a = b;
+        REQUIRE(!a);
+        REQUIRE(a.error() == 2);
+
+        b = std::expected<int, int>(3);
+        REQUIRE(b);
+        REQUIRE(*b == 3);
+
+        std::expected<void, int> c;
+        std::expected<void, int> d(std::unexpect, 4);
+        c = d;
+        REQUIRE(!c);
+        REQUIRE(c.error() == 4);
+        d = std::expected<void, int>();
+        REQUIRE(d);
+    }
+}
+
 TEST_CASE("observers", "[expected]") {
 
     SECTION("operator bool / has_value()") {
@@ -495,6 +644,30 @@ TEST_CASE("observers", "[expected]") {
         REQUIRE_THROWS_AS(
             std::move(d).value(), std::bad_expected_access<Error>);
     }
+#elif KZ_EXPECTED_ACCESS_POLICY == KZ_EXPECTED_ACCESS_HANDLER
+    SECTION("value() - has error") {
+        const auto previous = kz::set_bad_access_handler(&BadAccess::handler);
+        REQUIRE(kz::get_bad_access_handler() == &BadAccess::handler);
+
+        // &
+        std::expected<int, Error> a{std::unexpected(Error::FileNotFound)};
+        BadAccess::what = nullptr;
+        if (setjmp(BadAccess::jump) == 0) {
+            a.value();
+        }
+        REQUIRE(BadAccess::what != nullptr);
+
+        // &&
+        std::expected<void, Error> b{std::unexpected(Error::FileNotFound)};
+        BadAccess::what = nullptr;
+        if (setjmp(BadAccess::jump) == 0) {
+            std::move(b).value();
+        }
+        REQUIRE(BadAccess::what != nullptr);
+
+        REQUIRE(kz::set_bad_access_handler(previous) == &BadAccess::handler);
+        REQUIRE(kz::get_bad_access_handler() == previous);
+    }
 #endif
 
     SECTION("error()") {
@@ -553,6 +726,55 @@ TEST_CASE("observers", "[expected]") {
                 Error::FileNotFound);
     }
 
+    SECTION("value_or_else()") {
+        int calls = 0;
+        const auto fallback = [&] { ++calls; return 42; };
+
+        // value - const&: the fallback isn't called
+        const std::expected<int, Error> a{31};
+        REQUIRE(a.value_or_else(fallback) == 31);
+        REQUIRE(calls == 0);
+
+        // error - const&
+        const std::expected<int, Error> b{std::unexpected(Error::IOError)};
+        REQUIRE(b.value_or_else(fallback) == 42);
+        REQUIRE(calls == 1);
+
+        // error - &&, the fallback gets the error
+        std::expected<std::string, std::string> c{std::unexpected("bad")};
+        REQUIRE(std::move(c).value_or_else([](std::string&& e) { return e + "!"; }) == "bad!");
+
+        // value - &&
+        std::expected<std::string, Error> d{"good"};
+        REQUIRE(std::move(d).value_or_else([] { return std::string("bad"); }) == "good");
+    }
+
+    SECTION("error_or_else()") {
+        int calls = 0;
+        const auto fallback = [&] { ++calls; return Error::FlyingSquirrels; };
+
+        // error - const&: the fallback isn't called
+        const std::expected<int, Error> a{std::unexpected(Error::IOError)};
+        REQUIRE(a.error_or_else(fallback) == Error::IOError);
+        REQUIRE(calls == 0);
+
+        // value - const&
+        const std::expected<int, Error> b{31};
+        REQUIRE(b.error_or_else(fallback) == Error::FlyingSquirrels);
+        REQUIRE(calls == 1);
+
+        // value - &&, the fallback gets the value
+        std::expected<int, std::string> c{7};
+        REQUIRE(std::move(c).error_or_else([](int v) { return std::to_string(v); }) == "7");
+
+        // void specialization
+        const std::expected<void, Error> d{};
+        REQUIRE(d.error_or_else(fallback) == Error::FlyingSquirrels);
+        std::expected<void, Error> e{std::unexpected(Error::IOError)};
+        REQUIRE(std::move(e).error_or_else(fallback) == Error::IOError);
+        REQUIRE(calls == 2);
+    }
+
     SECTION("and_then()") {
         const std::expected<int, Error> a{12};
         const auto a2 = a.and_then([](int value) -> std::expected<bool, Error> {
@@ -593,7 +815,7 @@ TEST_CASE("observers", "[expected]") {
         const std::expected<int, Error> a{60};
         const auto a2 = a.transform_error(
             [](Error) -> Error { return Error::FlyingSquirrels; });
-        REQUIRE(a2);
+        REQUIRE(a2 == 60);
 
         // Error
         const std::expected<int, Error> b{std::unexpected(Error::IOError)};
@@ -634,3 +856,112 @@ TEST_CASE("observers", "[expected]") {
         REQUIRE(b2.error() == Error::FlyingSquirrels);
     }
 }
+
+TEST_CASE("Reference specialization", "[expected]") {
+    struct Row {
+        int id;
+        int count;
+    };
+
+    struct NotFound {};
+
+    Row rows[] = {{1, 10}, {2, 20}};
+
+    SECTION("Layout") {
+        static_assert(sizeof(std::expected<const Row&, NotFound>) == sizeof(Row*));
+        static_assert(sizeof(std::expected<Row&, int>) == 2 * sizeof(Row*));
+        static_assert(std::is_trivially_copyable_v<std::expected<const Row&, Error>>);
+        static_assert(!std::is_trivially_copyable_v<std::expected<const Row&, std::string>>);
+        static_assert(!std::is_constructible_v<std::expected<const Row&, Error>, Row&&>);
+    }
+
+    SECTION("Value") {
+        std::expected<const Row&, Error> a(rows[0]);
+        REQUIRE(a);
+        REQUIRE(&*a == &rows[0]);
+        REQUIRE(a->id == 1);
+        REQUIRE(&a.value() == &rows[0]);
+    }
+
+    SECTION("Error") {
+        std::expected<const Row&, Error> a = std::unexpected(Error::FileNotFound);
+        REQUIRE(!a);
+        REQUIRE(a.error() == Error::FileNotFound);
+        REQUIRE(a.value_or(rows[1]).id == 2);
+        REQUIRE(a.value_or_else([&] { return rows[1]; }).id == 2);
+        REQUIRE(a == std::unexpected(Error::FileNotFound));
+    }
+
+    SECTION("Assignment rebinds") {
+        std::expected<Row&, std::string> a(rows[0]);
+        a = rows[1];
+        REQUIRE(&*a == &rows[1]);
+        REQUIRE(rows[0].id == 1);
+
+        a = std::unexpected(std::string("missing"));
+        REQUIRE(!a);
+        REQUIRE(a.error() == "missing");
+
+        std::expected<Row&, std::string> b(rows[0]);
+        a = b;
+        REQUIRE(&*a == &rows[0]);
+
+        b = std::unexpected(std::string("gone"));
+        a = std::move(b);
+        REQUIRE(a.error() == "gone");
+    }
+
+    SECTION("Swap") {
+        std::expected<Row&, std::string> a(rows[0]);
+        std::expected<Row&, std::string> b(std::unexpect, "missing");
+        a.swap(b);
+        REQUIRE(!a);
+        REQUIRE(a.error() == "missing");
+        REQUIRE(&*b == &rows[0]);
+    }
+
+    SECTION("and_then()") {
+        std::expected<const Row&, Error> a(rows[1]);
+        const auto b = a.and_then([](const Row& r) { return std::expected<int, Error>(r.count); });
+        REQUIRE(*b == 20);
+
+        std::expected<const Row&, Error> c(std::unexpect, Error::IOError);
+        const auto d = c.and_then([](const Row& r) { return std::expected<int, Error>(r.count); });
+        REQUIRE(d.error() == Error::IOError);
+    }
+
+    SECTION("transform()") {
+        std::expected<Row&, Error> a(rows[0]);
+
+        // References are kept
+        auto b = a.transform([](Row& r) -> int& { return r.count; });
+        static_assert(std::is_same_v<decltype(b), std::expected<int&, Error>>);
+        *b = 11;
+        REQUIRE(rows[0].count == 11);
+
+        auto c = a.transform([](const Row& r) { return r.id; });
+        static_assert(std::is_same_v<decltype(c), std::expected<int, Error>>);
+        REQUIRE(*c == 1);
+    }
+
+    SECTION("or_else() / transform_error()") {
+        std::expected<const Row&, Error> a(std::unexpect, Error::IOError);
+        const auto b = a.or_else([&](Error) { return std::expected<const Row&, Error>(rows[1]); });
+        REQUIRE(&*b == &rows[1]);
+
+        const auto c = a.transform_error([](Error) { return 5; });
+        static_assert(std::is_same_v<decltype(c), const std::expected<const Row&, int>>);
+        REQUIRE(c.error() == 5);
+
+        std::expected<const Row&, Error> d(rows[0]);
+        const auto e = d.transform_error([](Error) { return 5; });
+        REQUIRE(&*e == &rows[0]);
+    }
+
+#if KZ_EXCEPTIONS
+    SECTION("value() throws") {
+        std::expected<const Row&, Error> a(std::unexpect, Error::IOError);
+        REQUIRE_THROWS_AS(a.value(), std::bad_expected_access<Error>);
+    }
+#endif
+}
@@ -0,0 +1,199 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/expected_vector.hpp>
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#if KZ_EXCEPTIONS
+namespace {
+
+    // Default construction throws on demand: the placeholder pushed for an element holding a value
+    struct Fragile {
+        static inline bool fail = false;
+
+        Fragile() {
+            if (fail)
+                throw 0;
+        }
+        Fragile(int) {}
+    };
+
+} // namespace
+#endif
+
+TEST_CASE("expected_vector", "[expected_vector]") {
+    SECTION("push_back and access") {
+        kz::expected_vector<float, std::uint8_t> v;
+        REQUIRE(v.empty());
+
+        v.push_back(1.5f);
+        v.push_back(std::unexpected<std::uint8_t>(3));
+        v.push_back(std::expected<float, std::uint8_t>(2.5f));
+        v.emplace_back(std::unexpect, std::uint8_t(4));
+        const std::expected<float, std::uint8_t> failed(std::unexpect, std::uint8_t(5));
+        v.push_back(failed);
+
+        REQUIRE(v.size() == 5);
+        REQUIRE(v[4] == std::unexpected<std::uint8_t>(5));
+        REQUIRE(v[0].has_value());
+        REQUIRE(*v[0] == 1.5f);
+        REQUIRE(v[0].value() == 1.5f);
+        REQUIRE(!v[1]);
+        REQUIRE(v[1].error() == 3);
+        REQUIRE(v[1].value_or(9.0f) == 9.0f);
+        REQUIRE(v[2] == 2.5f);
+        REQUIRE(v[3] == std::unexpected<std::uint8_t>(4));
+        REQUIRE(v[3] == std::expected<float, std::uint8_t>(std::unexpect, std::uint8_t(4)));
+
+        const std::expected<float, std::uint8_t> copy = v[2];
+        REQUIRE(copy == 2.5f);
+
+        // Dense storage
+        REQUIRE(v.values().size() == 5);
+        REQUIRE(v.values()[2] == 2.5f);
+        REQUIRE(v.errors()[1] == 3);
+        REQUIRE(v.bitmap().size() == 1);
+        REQUIRE(v.bitmap()[0] == 0b0101);
+
+#if KZ_EXCEPTIONS
+        REQUIRE_THROWS_AS(v[1].value(), std::bad_expected_access<std::uint8_t>);
+#endif
+    }
+
+    SECTION("assignment through references") {
+        kz::expected_vector<std::string, int> v(3, "x");
+        REQUIRE(v.count_errors() == 0);
+
+        v[1] = std::unexpected(7);
+        REQUIRE(v[1].error() == 7);
+        REQUIRE(v.count_errors() == 1);
+
+        v[1] = std::string("y");
+        REQUIRE(v[1] == "y");
+        v[0] = std::expected<std::string, int>(std::unexpect, 8);
+        REQUIRE(v[0] == std::unexpected(8));
+        v[2] = v[0];
+        REQUIRE(v[2] == std::unexpected(8));
+        REQUIRE(v.count_errors() == 2);
+
+        *v[1] += "z";
+        REQUIRE(v[1]->size() == 2);
+    }
+
+    SECTION("iterators") {
+        kz::expected_vector<int, int> v;
+        for (int i = 0; i != 10; ++i) {
+            if (i % 3)
+                v.push_back(i);
+            else
+                v.push_back(std::unexpected(i));
+        }
+        REQUIRE(std::count_if(v.begin(), v.end(), [](auto e) { return e.has_value(); }) == 6);
+        REQUIRE(v.end() - v.begin() == 10);
+        REQUIRE(v.begin()[4] == 4);
+
+        int sum = 0;
+        for (auto e : std::as_const(v))
+            sum += e.value_or(0);
+        REQUIRE(sum == 1 + 2 + 4 + 5 + 7 + 8);
+
+        for (auto e : v)
+            if (e)
+                *e *= 10;
+        REQUIRE(v[8] == 80);
+    }
+
+    SECTION("bitmap across words") {
+        kz::expected_vector<int, int> v;
+        for (int i = 0; i != 200; ++i) {
+            if (i % 7 == 0)
+                v.push_back(std::unexpected(i));
+            else
+                v.push_back(i);
+        }
+        REQUIRE(v.bitmap().size() == 4);
+        REQUIRE(v.count_errors() == 29);
+        REQUIRE(v.count_values() == 171);
+
+        v.pop_back();
+        v.pop_back();
+        REQUIRE(v.size() == 198);
+        REQUIRE(v.count_errors() == 29);
+        for (int i = 0; i != 70; ++i)
+            v.pop_back();
+        REQUIRE(v.size() == 128);
+        REQUIRE(v.bitmap().size() == 2);
+        REQUIRE(v.count_errors() == 19);
+    }
+
+#if KZ_EXCEPTIONS
+    SECTION("failed push_back leaves the vector unchanged") {
+        kz::expected_vector<int, Fragile> v;
+        v.push_back(1);
+        v.push_back(std::unexpected(Fragile(2)));
+
+        Fragile::fail = true;
+        REQUIRE_THROWS(v.push_back(3));
+        Fragile::fail = false;
+
+        REQUIRE(v.size() == 2);
+        REQUIRE(v.values().size() == 2);
+        REQUIRE(v.errors().size() == 2);
+        REQUIRE(v[0].has_value());
+        REQUIRE(!v[1].has_value());
+    }
+#endif
+
+    SECTION("transform_values") {
+        kz::expected_vector<float, std::uint8_t> v;
+        for (int i = 0; i != 150; ++i) {
+            if (i % 50 == 49)
+                v.push_back(std::unexpected<std::uint8_t>(static_cast<std::uint8_t>(i)));
+            else
+                v.push_back(static_cast<float>(i));
+        }
+
+        const auto r = v.transform_values([](float x) { return static_cast<int>(x) * 2; });
+        static_assert(std::is_same_v<decltype(r), const kz::expected_vector<int, std::uint8_t>>);
+        REQUIRE(r.size() == 150);
+        REQUIRE(r.count_errors() == 3);
+        for (std::size_t i = 0; i != 150; ++i) {
+            if (i % 50 == 49)
+                REQUIRE(r[i] == std::unexpected<std::uint8_t>(static_cast<std::uint8_t>(i)));
+            else
+                REQUIRE(r[i] == static_cast<int>(i) * 2);
+        }
+
+        int calls = 0;
+        v.transform_values([&](float x) { ++calls; return x; });
+        REQUIRE(calls == 147);
+    }
+}
@@ -0,0 +1,128 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/lazy_error.hpp>
+#include <catch2/catch.hpp>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    enum class errc { bad_port, timeout };
+
+    using port_error = kz::lazy_error<errc, int, int, int>;
+
+    std::expected<int, port_error> parse_port(int port) {
+        if (port < 1 || port > 65535)
+            return std::unexpected(kz::lazy_error(errc::bad_port, "port %d out of range [%d, %d]", port, 1, 65535));
+        return port;
+    }
+
+} // namespace
+
+TEST_CASE("lazy_error", "[lazy_error]") {
+    SECTION("Deduction") {
+        kz::lazy_error e(errc::timeout, "%s after %u ms (%.1f%%)", "read", 250u, 12.5f);
+        STATIC_REQUIRE(std::is_same_v<decltype(e), kz::lazy_error<errc, const char*, unsigned, float>>);
+        REQUIRE(e.code() == errc::timeout);
+        REQUIRE(e.message() == "read after 250 ms (12.5%)");
+    }
+
+    SECTION("Renders on first use only") {
+        auto r = parse_port(70000);
+        REQUIRE(!r);
+        REQUIRE(r.error() == errc::bad_port);
+        REQUIRE(!r.error().rendered());
+        REQUIRE(std::string_view(r.error().what()) == "port 70000 out of range [1, 65535]");
+        REQUIRE(r.error().rendered());
+        const char* message = r.error().what();
+        REQUIRE(r.error().what() == message);
+    }
+
+    SECTION("No arguments") {
+        kz::lazy_error e(errc::timeout, "timed out");
+        REQUIRE(e.message() == "timed out");
+    }
+
+    SECTION("Enum arguments") {
+        kz::lazy_error e(0, "code %d", errc::timeout);
+        REQUIRE(e.message() == "code 1");
+    }
+
+    SECTION("Copy and move") {
+        auto r = parse_port(0);
+        REQUIRE(r.error().message() == "port 0 out of range [1, 65535]");
+
+        port_error copy = r.error();
+        REQUIRE(!copy.rendered());
+        REQUIRE(copy.message() == r.error().message());
+        REQUIRE(copy.what() != r.error().what());
+
+        port_error moved = std::move(r.error());
+        REQUIRE(moved.rendered());
+        REQUIRE(moved.message() == "port 0 out of range [1, 65535]");
+
+        copy = moved;
+        REQUIRE(!copy.rendered());
+        REQUIRE(copy == moved);
+        REQUIRE(copy.message() == moved.message());
+
+        port_error other(errc::timeout, "%d %d %d", 1, 2, 3);
+        other = std::move(moved);
+        REQUIRE(other.code() == errc::bad_port);
+        REQUIRE(other.message() == "port 0 out of range [1, 65535]");
+    }
+
+    SECTION("Concurrent first render") {
+        auto r = parse_port(-1);
+        std::vector<std::thread> threads;
+        std::vector<const char*> messages(4);
+        for (std::size_t i = 0; i != messages.size(); ++i)
+            threads.emplace_back([&, i] { messages[i] = r.error().what(); });
+        for (auto& t : threads)
+            t.join();
+        for (const char* m : messages) {
+            REQUIRE(m == r.error().what());
+        }
+        REQUIRE(r.error().message() == "port -1 out of range [1, 65535]");
+    }
+
+#if KZ_EXCEPTIONS
+    SECTION("bad_expected_access reports the message") {
+        auto r = parse_port(99999);
+        try {
+            (void)r.value();
+            FAIL();
+        } catch (const std::bad_expected_access<port_error>& e) {
+            REQUIRE(std::string_view(e.what()) == "port 99999 out of range [1, 65535]");
+            REQUIRE(e.error().code() == errc::bad_port);
+        }
+    }
+#endif
+}
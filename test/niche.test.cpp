@@ -0,0 +1,252 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+    struct Row {
+        int id;
+    };
+
+    // Empty error types
+    struct NotFound {
+        friend constexpr bool operator==(NotFound, NotFound) { return true; }
+    };
+    struct Timeout {};
+
+    enum class Errc : std::uint8_t { None = 0xFF, NotFound = 1, Timeout = 2 };
+    enum class Color : std::uint32_t { Red, Green, Blue };
+    enum class Status : std::int32_t { Ok = 0, Failed = 1, Invalid = 2 };
+
+    // User-declared sentinel, not a niche
+    struct Handle {
+        int fd;
+    };
+
+} // namespace
+
+template <>
+struct kz::niche_traits<Row*> : kz::sentinel_niche<Row*, nullptr> {};
+
+template <>
+struct kz::niche_traits<Color> : kz::sentinel_niche<Color, Color(0xFFFFFFFF)> {};
+
+template <>
+struct kz::niche_traits<Errc> : kz::sentinel_niche<Errc, Errc::None> {};
+
+template <>
+struct kz::niche_traits<Status> : kz::sentinel_niche<Status, Status::Ok> {};
+
+template <>
+struct kz::niche_traits<double> : kz::nan_niche<double> {};
+
+template <>
+struct kz::niche_traits<float> : kz::nan_niche<float> {};
+
+template <>
+struct kz::niche_traits<Handle> {
+    static constexpr Handle niche() noexcept { return Handle{-1}; }
+    static constexpr bool is_niche(const Handle& h) noexcept { return h.fd == -1; }
+};
+
+TEST_CASE("Niche layouts", "[niche]") {
+    // Niche in the value, empty error
+    static_assert(sizeof(std::expected<Row*, NotFound>) == sizeof(Row*));
+    static_assert(alignof(std::expected<Row*, NotFound>) == alignof(Row*));
+    static_assert(sizeof(std::expected<Color, NotFound>) == sizeof(Color));
+    static_assert(alignof(std::expected<Color, NotFound>) == alignof(Color));
+    static_assert(sizeof(std::expected<double, Timeout>) == sizeof(double));
+    static_assert(alignof(std::expected<double, Timeout>) == alignof(double));
+    static_assert(sizeof(std::expected<float, Timeout>) == sizeof(float));
+    static_assert(alignof(std::expected<float, Timeout>) == alignof(float));
+    static_assert(sizeof(std::expected<Handle, NotFound>) == sizeof(Handle));
+    static_assert(alignof(std::expected<Handle, NotFound>) == alignof(Handle));
+
+    // Niche in the error, void value
+    static_assert(sizeof(std::expected<void, Errc>) == sizeof(Errc));
+    static_assert(alignof(std::expected<void, Errc>) == alignof(Errc));
+    static_assert(sizeof(std::expected<void, Status>) == sizeof(Status));
+    static_assert(alignof(std::expected<void, Status>) == alignof(Status));
+
+    // No niche: separate discriminant
+    static_assert(sizeof(std::expected<int*, NotFound>) == 2 * sizeof(int*));
+    static_assert(sizeof(std::expected<void, int>) == 2 * sizeof(int));
+    static_assert(sizeof(std::expected<Row*, int>) == 2 * sizeof(Row*));
+
+    // Niche layouts are trivial
+    static_assert(std::is_trivially_copyable_v<std::expected<Row*, NotFound>>);
+    static_assert(std::is_trivially_copyable_v<std::expected<double, Timeout>>);
+    static_assert(std::is_trivially_copyable_v<std::expected<void, Errc>>);
+}
+
+TEST_CASE("Niche in value", "[niche]") {
+    Row row{42};
+
+    SECTION("Value") {
+        std::expected<Row*, NotFound> a(&row);
+        REQUIRE(a.has_value());
+        REQUIRE(*a == &row);
+        REQUIRE((*a)->id == 42);
+        REQUIRE(a.value_or(nullptr) == &row);
+    }
+
+    SECTION("Default construction") {
+        // nullptr is the niche, a default-constructed expected<Row*> would hold an error
+        static_assert(!std::is_default_constructible_v<std::expected<Row*, NotFound>>);
+
+        std::expected<Color, NotFound> a;
+        REQUIRE(a.has_value());
+        REQUIRE(*a == Color::Red);
+
+        std::expected<double, Timeout> b;
+        REQUIRE(b.has_value());
+        REQUIRE(*b == 0.0);
+    }
+
+    SECTION("Error") {
+        std::expected<Row*, NotFound> a = std::unexpected(NotFound{});
+        REQUIRE(!a.has_value());
+        REQUIRE(a.value_or(nullptr) == nullptr);
+        REQUIRE(a == std::unexpected(NotFound{}));
+    }
+
+    SECTION("Assignment") {
+        std::expected<Row*, NotFound> a(&row);
+        a = std::unexpected(NotFound{});
+        REQUIRE(!a);
+        a = &row;
+        REQUIRE(a);
+        REQUIRE(*a == &row);
+    }
+
+    SECTION("Swap") {
+        std::expected<Row*, NotFound> a(&row);
+        std::expected<Row*, NotFound> b(std::unexpect);
+        a.swap(b);
+        REQUIRE(!a);
+        REQUIRE(b);
+        REQUIRE(*b == &row);
+    }
+
+    SECTION("Monadic operations") {
+        std::expected<Row*, NotFound> a(&row);
+        auto b = a.transform([](Row* r) { return r->id; });
+        REQUIRE(b);
+        REQUIRE(*b == 42);
+
+        std::expected<Row*, NotFound> c(std::unexpect);
+        auto d = c.transform([](Row* r) { return r->id; });
+        REQUIRE(!d);
+
+        auto e = c.or_else([&](NotFound) { return std::expected<Row*, NotFound>(&row); });
+        REQUIRE(e);
+        REQUIRE(*e == &row);
+
+        auto f = a.transform_error([](NotFound) { return Timeout{}; });
+        static_assert(std::is_same_v<decltype(f), std::expected<Row*, Timeout>>);
+        REQUIRE(f);
+        REQUIRE(*f == &row);
+
+        REQUIRE(a.value_or_else([] { return nullptr; }) == &row);
+        REQUIRE(c.value_or_else([] { return nullptr; }) == nullptr);
+        REQUIRE(c.error_or_else([] { return NotFound{}; }) == NotFound{});
+    }
+
+    SECTION("NaN payload") {
+        std::expected<double, Timeout> a(std::nan(""));
+        REQUIRE(a.has_value());
+        REQUIRE(std::isnan(*a));
+
+        std::expected<double, Timeout> b(std::unexpect);
+        REQUIRE(!b.has_value());
+        REQUIRE(std::isnan(kz::niche_traits<double>::niche()));
+
+        std::expected<float, Timeout> c(1.5f);
+        REQUIRE(*c == 1.5f);
+    }
+
+    SECTION("User-declared sentinel") {
+        std::expected<Handle, NotFound> a(Handle{3});
+        REQUIRE(a);
+        REQUIRE(a->fd == 3);
+
+        a = std::unexpected(NotFound{});
+        REQUIRE(!a);
+        REQUIRE(a->fd == -1);
+    }
+}
+
+TEST_CASE("Niche in error", "[niche]") {
+    SECTION("Value") {
+        std::expected<void, Errc> a;
+        REQUIRE(a.has_value());
+        REQUIRE(a.error_or(Errc::Timeout) == Errc::Timeout);
+    }
+
+    SECTION("Error") {
+        std::expected<void, Errc> a = std::unexpected(Errc::NotFound);
+        REQUIRE(!a.has_value());
+        REQUIRE(a.error() == Errc::NotFound);
+        REQUIRE(a == std::unexpected(Errc::NotFound));
+    }
+
+    SECTION("Assignment") {
+        std::expected<void, Status> a;
+        a = std::unexpected(Status::Failed);
+        REQUIRE(!a);
+        REQUIRE(a.error() == Status::Failed);
+        a.emplace();
+        REQUIRE(a);
+    }
+
+    SECTION("Monadic operations") {
+        std::expected<void, Errc> a;
+        auto b = a.and_then([] { return std::expected<int, Errc>(3); });
+        REQUIRE(b);
+        REQUIRE(*b == 3);
+
+        std::expected<void, Errc> c(std::unexpect, Errc::Timeout);
+        auto d = c.transform([] { return 3; });
+        REQUIRE(!d);
+        REQUIRE(d.error() == Errc::Timeout);
+
+        auto e = c.transform_error([](Errc e) { return static_cast<int>(e); });
+        static_assert(std::is_same_v<decltype(e), std::expected<void, int>>);
+        REQUIRE(e.error() == 2);
+    }
+
+#if KZ_EXCEPTIONS
+    SECTION("value() throws") {
+        std::expected<void, Errc> a(std::unexpect, Errc::NotFound);
+        REQUIRE_THROWS_AS(a.value(), std::bad_expected_access<Errc>);
+    }
+#endif
+}
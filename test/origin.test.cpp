@@ -0,0 +1,209 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/batch.hpp>
+#include <kz/expected_bits/collect.hpp>
+#include <kz/expected_bits/coroutine.hpp>
+#include <kz/expected_bits/pipeline.hpp>
+#include <kz/expected_bits/try.hpp>
+#include <catch2/catch.hpp>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Built as its own executable, with KZ_EXPECTED_TRACK_ORIGIN=1
+
+namespace {
+
+    constexpr std::uint_least32_t line_of_fail = __LINE__ + 3;
+    std::expected<int, std::string> fail(int i) {
+        if (i < 0)
+            return std::unexpected(std::string("negative"));
+        return i;
+    }
+
+    constexpr std::uint_least32_t line_of_unexpect = __LINE__ + 2;
+    std::expected<void, int> fail_void() {
+        return std::expected<void, int>(std::unexpect, 42);
+    }
+
+    std::expected<long, std::string> forward(int i) {
+        long v = KZ_TRY(fail(i));
+        return v;
+    }
+
+    // Runs tasks on the calling thread, as they are submitted
+    struct InlineExecutor {
+        int concurrency() const { return 2; }
+        template <class F>
+        void execute(F&& f) { f(); }
+    };
+
+#if KZ_EXPECTED_COROUTINES
+    constexpr std::uint_least32_t line_of_co_await = __LINE__ + 4;
+    std::expected<int, std::string> checked(int i) {
+        const int v = co_await fail(i);
+        if (v > 100)
+            co_await std::unexpected(std::string("too large"));
+        co_return v;
+    }
+#endif
+
+    bool from_this_file(const std::source_location& where) {
+        return std::string_view(where.file_name()).ends_with("origin.test.cpp");
+    }
+
+} // namespace
+
+static_assert(KZ_EXPECTED_TRACK_ORIGIN);
+
+TEST_CASE("origin", "[origin]") {
+    SECTION("unexpected() records its caller") {
+        auto r = fail(-1);
+        REQUIRE(kz::origin_id(r) != 0);
+        REQUIRE(from_this_file(kz::origin(r)));
+        REQUIRE(kz::origin(r).line() == line_of_fail);
+        REQUIRE(kz::origin(r).function_name() == std::string_view(kz::origin(fail(-2)).function_name()));
+    }
+
+    SECTION("unexpect records its caller") {
+        auto r = fail_void();
+        REQUIRE(from_this_file(kz::origin(r)));
+        REQUIRE(kz::origin(r).line() == line_of_unexpect);
+    }
+
+    SECTION("One id per site") {
+        REQUIRE(kz::origin_id(fail(-1)) == kz::origin_id(fail(-5)));
+        REQUIRE(kz::origin_id(fail(-1)) != kz::origin_id(fail_void()));
+    }
+
+    SECTION("No origin for values") {
+        REQUIRE(kz::origin_id(fail(1)) == 0);
+        REQUIRE(kz::origin(fail(1)).line() == 0);
+    }
+
+    SECTION("Follows the error") {
+        const auto id = kz::origin_id(fail(-1));
+        auto r = fail(-1);
+        auto copy = r;
+        REQUIRE(kz::origin_id(copy) == id);
+        std::expected<int, std::string> assigned = 1;
+        assigned = std::move(copy);
+        REQUIRE(kz::origin_id(assigned) == id);
+
+        std::expected<int, std::string> other = 1;
+        swap(other, r);
+        REQUIRE(kz::origin_id(other) == id);
+
+        auto chained = other.and_then([](int v) { return std::expected<double, std::string>(v * 2.0); })
+                            .transform([](double v) { return v + 1; })
+                            .transform_error([](const std::string& s) { return s.size(); });
+        REQUIRE(kz::origin_id(chained) == id);
+
+        REQUIRE(kz::origin_id(forward(-1)) == id);
+
+        std::expected<long, std::string> converted = fail(-1);
+        REQUIRE(kz::origin_id(converted) == id);
+    }
+
+    SECTION("Assigning an unexpected") {
+        std::expected<int, int> r = 1;
+        const auto line = __LINE__ + 1;
+        r = std::unexpected(3);
+        REQUIRE(kz::origin(r).line() == line);
+
+        std::unexpected<int> u(3);
+        REQUIRE(kz::origin_id(u) != 0);
+    }
+
+    SECTION("Batch transform") {
+        // 8-byte values: the layout the SIMD kernels would otherwise take
+        static_assert(kz::batch::detail::lane_size_v<std::expected<double, int>> == 0);
+        std::vector<std::expected<double, int>> in(16, 1.0);
+        in[3] = std::unexpected(7);
+        const auto id = kz::origin_id(in[3]);
+        REQUIRE(id != 0);
+
+        std::vector<std::expected<double, int>> out(in.size());
+        kz::batch::transform(in, out, [](double x) { return x * 2; });
+        REQUIRE(out[3] == std::unexpected(7));
+        REQUIRE(kz::origin_id(out[3]) == id);
+        REQUIRE(out[4] == 2.0);
+    }
+
+    SECTION("Pipelines") {
+        const auto id = kz::origin_id(fail(-1));
+        std::expected<int, std::string> source = fail(-1);
+        std::expected<int, std::string> r = kz::pipe(source)
+            | kz::transform([](int v) { return v + 1; })
+            | kz::transform_error([](const std::string& e) { return e + "!"; });
+        REQUIRE(kz::origin_id(r) == id);
+
+        std::expected<int, std::string> value = 1;
+        std::expected<int, std::string> stage = kz::pipe(value)
+            | kz::and_then([](int) { return fail(-1); })
+            | kz::transform([](int v) { return v + 1; });
+        REQUIRE(kz::origin_id(stage) == id);
+    }
+
+    SECTION("parallel_transform_collect") {
+        const auto id = kz::origin_id(fail(-1));
+        const std::vector<int> input{1, 2, -3, 4, 5};
+        const auto r = kz::parallel_transform_collect(input, fail, InlineExecutor{});
+        REQUIRE(!r.has_value());
+        REQUIRE(kz::origin_id(r) == id);
+    }
+
+#if KZ_EXPECTED_COROUTINES
+    SECTION("Coroutines") {
+        REQUIRE(kz::origin_id(checked(-1)) == kz::origin_id(fail(-1)));
+        const auto r = checked(101);
+        REQUIRE(from_this_file(kz::origin(r)));
+        REQUIRE(kz::origin(r).line() == line_of_co_await);
+    }
+#endif
+
+    SECTION("Many threads, many sites") {
+        std::vector<std::thread> threads;
+        std::vector<std::uint32_t> ids(8);
+        for (std::size_t t = 0; t != ids.size(); ++t)
+            threads.emplace_back([&, t] { ids[t] = kz::origin_id(fail(-1)) + kz::origin_id(fail_void()); });
+        for (auto& t : threads)
+            t.join();
+        for (auto id : ids) {
+            REQUIRE(id == ids[0]);
+        }
+    }
+
+    SECTION("Constant evaluation") {
+        constexpr std::expected<int, int> e = std::unexpected(1);
+        STATIC_REQUIRE(!e.has_value());
+        REQUIRE(kz::origin_id(e) == 0);
+    }
+}
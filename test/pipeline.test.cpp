@@ -0,0 +1,171 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/pipeline.hpp>
+#include <catch2/catch.hpp>
+#include <string>
+
+namespace {
+
+    // Error that counts how many times it is copied or moved
+    struct Tracked {
+        static inline int copies = 0;
+        static inline int moves = 0;
+
+        int code;
+
+        explicit Tracked(int c) : code(c) {}
+        Tracked(const Tracked& other) : code(other.code) { ++copies; }
+        Tracked(Tracked&& other) noexcept : code(other.code) { ++moves; }
+        Tracked& operator=(const Tracked&) = default;
+        Tracked& operator=(Tracked&&) = default;
+
+        static void reset() { copies = moves = 0; }
+    };
+
+    std::expected<int, Tracked> parse(const std::string& s) {
+        if (s.empty())
+            return std::unexpected(Tracked(1));
+        return static_cast<int>(s.size());
+    }
+
+    std::expected<int, Tracked> positive(int x) {
+        if (x <= 0)
+            return std::unexpected(Tracked(2));
+        return x;
+    }
+
+} // namespace
+
+TEST_CASE("pipeline", "[pipeline]") {
+    SECTION("value") {
+        std::expected<std::string, Tracked> e("abc");
+        std::expected<std::string, Tracked> r = kz::pipe(e)
+            | kz::transform([](const std::string& s) { return s + "de"; })
+            | kz::and_then(parse)
+            | kz::and_then(positive)
+            | kz::transform([](int x) { return std::to_string(x * 10); });
+
+        REQUIRE(r.has_value());
+        REQUIRE(*r == "50");
+        REQUIRE(*e == "abc");
+    }
+
+    SECTION("error from and_then() skips later stages") {
+        int calls = 0;
+        auto r = (kz::pipe(std::expected<std::string, Tracked>(""))
+            | kz::and_then(parse)
+            | kz::transform([&](int x) { ++calls; return x; })
+            | kz::and_then(positive)).run();
+
+        static_assert(std::is_same_v<decltype(r), std::expected<int, Tracked>>);
+        REQUIRE(!r.has_value());
+        REQUIRE(r.error().code == 1);
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("transform_error() and or_else()") {
+        auto r = (kz::pipe(std::expected<int, Tracked>(std::unexpect, 7))
+            | kz::transform([](int x) { return x + 1; })
+            | kz::transform_error([](const Tracked& t) { return std::to_string(t.code); })
+            | kz::or_else([](const std::string& s) -> std::expected<int, std::string> {
+                  if (s == "7")
+                      return 70;
+                  return std::unexpected(s);
+              })
+            | kz::transform([](int x) { return x + 1; })).run();
+
+        static_assert(std::is_same_v<decltype(r), std::expected<int, std::string>>);
+        REQUIRE(r == 71);
+    }
+
+    SECTION("void") {
+        int calls = 0;
+        std::expected<void, int> e;
+        auto r = (kz::pipe(e)
+            | kz::transform([&] { ++calls; return 3; })
+            | kz::transform([&](int x) { calls += x; })
+            | kz::and_then([&]() -> std::expected<void, int> { return std::unexpected(calls); })).run();
+
+        static_assert(std::is_same_v<decltype(r), std::expected<void, int>>);
+        REQUIRE(r.error() == 4);
+    }
+
+    SECTION("error is moved once") {
+        std::expected<int, Tracked> e(std::unexpect, 3);
+        Tracked::reset();
+        auto r = (kz::pipe(std::move(e))
+            | kz::and_then(positive)
+            | kz::transform([](int x) { return x * 2; })
+            | kz::and_then(positive)
+            | kz::transform([](int x) { return x * 2; })).run();
+
+        REQUIRE(r.error().code == 3);
+        REQUIRE(Tracked::copies == 0);
+        REQUIRE(Tracked::moves == 1);
+    }
+
+    SECTION("error from an lvalue is copied once") {
+        const std::expected<int, Tracked> e(std::unexpect, 3);
+        Tracked::reset();
+        auto r = (kz::pipe(e)
+            | kz::and_then(positive)
+            | kz::transform([](int x) { return x * 2; })
+            | kz::and_then(positive)).run();
+
+        REQUIRE(r.error().code == 3);
+        REQUIRE(Tracked::copies == 1);
+        REQUIRE(Tracked::moves == 0);
+    }
+
+    SECTION("constexpr") {
+        constexpr auto r = (kz::pipe(std::expected<int, int>(20))
+            | kz::transform([](int x) { return x + 1; })
+            | kz::and_then([](int x) -> std::expected<int, int> { return x * 2; })).run();
+        static_assert(r == 42);
+    }
+}
+
+TEST_CASE("pipeline constructs the last stage in place", "[pipeline]") {
+    struct Guarded {
+        explicit Guarded(int v) : value(v) {}
+        Guarded(const Guarded&) = delete;
+        Guarded& operator=(const Guarded&) = delete;
+
+        int value;
+    };
+
+    std::expected<Guarded, int> a = kz::pipe(std::expected<int, int>(2))
+        | kz::transform([](int x) { return x + 1; })
+        | kz::transform([](int x) { return Guarded(x); });
+    REQUIRE(a->value == 3);
+
+    std::expected<int, Guarded> b = kz::pipe(std::expected<int, int>(std::unexpect, 4))
+        | kz::transform_error([](int x) { return Guarded(x); });
+    REQUIRE(b.error().value == 4);
+}
@@ -0,0 +1,167 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/boxed_error.hpp>
+#include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+
+namespace {
+
+    // Owns its resource through a pointer and counts moves
+    struct Tracked {
+        static inline int moves = 0;
+
+        explicit Tracked(int v) : value(new int(v)) {}
+        Tracked(const Tracked& rhs) : value(new int(*rhs.value)) {}
+        Tracked(Tracked&& rhs) noexcept : value(std::exchange(rhs.value, nullptr)) { ++moves; }
+        Tracked& operator=(const Tracked& rhs) {
+            *value = *rhs.value;
+            return *this;
+        }
+        Tracked& operator=(Tracked&& rhs) noexcept {
+            std::swap(value, rhs.value);
+            return *this;
+        }
+        ~Tracked() { delete value; }
+
+        int* value;
+    };
+
+    // Same, with a throwing move constructor
+    struct ThrowingTracked : Tracked {
+        using Tracked::Tracked;
+        ThrowingTracked(ThrowingTracked&& rhs) noexcept(false) : Tracked(std::move(rhs)) {}
+        ThrowingTracked(const ThrowingTracked&) = default;
+        ThrowingTracked& operator=(const ThrowingTracked&) = default;
+        ThrowingTracked& operator=(ThrowingTracked&&) = default;
+    };
+
+} // namespace
+
+template <>
+struct kz::is_trivially_relocatable<Tracked> : std::true_type {};
+
+template <>
+struct kz::is_trivially_relocatable<ThrowingTracked> : std::true_type {};
+
+TEST_CASE("is_trivially_relocatable", "[relocate]") {
+    static_assert(kz::is_trivially_relocatable_v<int>);
+    static_assert(kz::is_trivially_relocatable_v<std::unique_ptr<int>>);
+    static_assert(kz::is_trivially_relocatable_v<Tracked>);
+    static_assert(!kz::is_trivially_relocatable_v<std::string>);
+
+    static_assert(kz::is_trivially_relocatable_v<std::expected<int, int>>);
+    static_assert(kz::is_trivially_relocatable_v<std::expected<std::unique_ptr<int>, Tracked>>);
+    static_assert(kz::is_trivially_relocatable_v<std::expected<void, Tracked>>);
+    static_assert(kz::is_trivially_relocatable_v<std::expected<int, kz::boxed_error<std::string>>>);
+    static_assert(kz::is_trivially_relocatable_v<std::unexpected<Tracked>>);
+    static_assert(!kz::is_trivially_relocatable_v<std::expected<std::string, int>>);
+    static_assert(!kz::is_trivially_relocatable_v<std::expected<int, std::string>>);
+}
+
+TEST_CASE("relocate_at()", "[relocate]") {
+    kz::detail::relocation_buffer<Tracked> buffer;
+    auto source = new Tracked(3);
+    Tracked::moves = 0;
+
+    Tracked* dest = kz::relocate_at(source, buffer.get());
+    ::operator delete(source);
+
+    REQUIRE(Tracked::moves == 0);
+    REQUIRE(*dest->value == 3);
+    dest->~Tracked();
+}
+
+TEST_CASE("uninitialized_relocate()", "[relocate]") {
+    std::allocator<Tracked> allocator;
+    Tracked* source = allocator.allocate(3);
+    Tracked* dest = allocator.allocate(3);
+    for (int i = 0; i != 3; ++i) {
+        ::new (source + i) Tracked(i);
+    }
+    Tracked::moves = 0;
+
+    Tracked* end = kz::uninitialized_relocate(source, source + 3, dest);
+
+    REQUIRE(end == dest + 3);
+    REQUIRE(Tracked::moves == 0);
+    REQUIRE(*dest[2].value == 2);
+
+    std::destroy(dest, end);
+    allocator.deallocate(source, 3);
+    allocator.deallocate(dest, 3);
+}
+
+TEST_CASE("Relocation in expected", "[relocate]") {
+    SECTION("swap() value and error") {
+        std::expected<Tracked, Tracked> a(std::in_place, 1);
+        std::expected<Tracked, Tracked> b(std::unexpect, 2);
+        Tracked::moves = 0;
+
+        a.swap(b);
+
+        REQUIRE(Tracked::moves == 0);
+        REQUIRE(!a);
+        REQUIRE(*a.error().value == 2);
+        REQUIRE(b);
+        REQUIRE(*b->value == 1);
+
+        b.swap(a);
+        REQUIRE(Tracked::moves == 0);
+        REQUIRE(*a->value == 1);
+        REQUIRE(*b.error().value == 2);
+    }
+
+    SECTION("swap() void") {
+        std::expected<void, Tracked> a;
+        std::expected<void, Tracked> b(std::unexpect, 2);
+        Tracked::moves = 0;
+
+        a.swap(b);
+
+        REQUIRE(Tracked::moves == 0);
+        REQUIRE(!a);
+        REQUIRE(*a.error().value == 2);
+        REQUIRE(b);
+    }
+
+    SECTION("Assignment with a throwing move constructor") {
+        std::expected<ThrowingTracked, int> a(std::unexpect, 1);
+        const ThrowingTracked value(5);
+        Tracked::moves = 0;
+
+        a = value;
+
+        REQUIRE(a);
+        REQUIRE(*a->value == 5);
+#if KZ_EXCEPTIONS
+        REQUIRE(Tracked::moves == 0);
+#endif
+    }
+}
@@ -0,0 +1,158 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Built as its own executable, with KZ_EXPECTED_TELEMETRY=1
+
+namespace {
+
+    enum class errc { invalid = 1, timeout = 2, huge = 1000 };
+
+    struct Coded {
+        errc code() const { return _code; }
+        errc _code;
+    };
+
+    struct Untracked {};
+
+    std::uint64_t errors_of(const std::vector<kz::telemetry::error_counts>& counts, std::string_view type) {
+        for (const auto& c : counts) {
+            if (c.type == type)
+                return c.errors;
+        }
+        return 0;
+    }
+
+} // namespace
+
+static_assert(KZ_EXPECTED_TELEMETRY);
+
+TEST_CASE("telemetry", "[telemetry]") {
+    SECTION("Counts errors entering an expected") {
+        const auto before = kz::telemetry::counts<errc>();
+        REQUIRE(before.keyed);
+        REQUIRE(before.type.find("errc") != std::string_view::npos);
+
+        std::expected<int, errc> a = std::unexpected(errc::invalid);
+        std::expected<std::string, errc> b(std::unexpect, errc::timeout);
+        std::expected<void, errc> c = std::unexpected(errc::huge);
+        a = std::unexpected(errc::timeout);
+        a = std::unexpected(errc::timeout);
+        std::expected<int, errc> ok = 42;
+        ok = 43;
+
+        const auto after = kz::telemetry::counts<errc>();
+        REQUIRE(after.errors - before.errors == 5);
+        REQUIRE(after.by_value[1] - before.by_value[1] == 1);
+        REQUIRE(after.by_value[2] - before.by_value[2] == 3);
+        REQUIRE(after.other_values - before.other_values == 1);
+    }
+
+    SECTION("Copies and moves do not count") {
+        std::expected<std::string, errc> a = std::unexpected(errc::invalid);
+        const auto before = kz::telemetry::counts<errc>().errors;
+        auto b = a;
+        auto c = std::move(b);
+        c = a;
+        REQUIRE(kz::telemetry::counts<errc>().errors == before);
+    }
+
+    SECTION("Keyed by code()") {
+        std::expected<int, Coded> a = std::unexpected(Coded{errc::timeout});
+        const auto counts = kz::telemetry::counts<Coded>();
+        REQUIRE(counts.keyed);
+        REQUIRE(counts.by_value[2] >= 1);
+    }
+
+    SECTION("Unkeyed types") {
+        std::expected<int, Untracked> a = std::unexpected(Untracked{});
+        std::expected<int&, Untracked> b = std::unexpected(Untracked{});
+        const auto counts = kz::telemetry::counts<Untracked>();
+        REQUIRE(!counts.keyed);
+        REQUIRE(counts.errors == 2);
+        REQUIRE(counts.other_values == 0);
+    }
+
+    SECTION("Aggregated over threads") {
+        const auto before = kz::telemetry::counts<int>().errors;
+        const auto thread_before = errors_of(kz::telemetry::thread_snapshot(), kz::telemetry::counts<int>().type);
+        std::vector<std::thread> threads;
+        for (int t = 0; t != 4; ++t) {
+            threads.emplace_back([] {
+                for (int i = 0; i != 1000; ++i) {
+                    std::expected<long, int> e = std::unexpected(i);
+                    (void)e;
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        const auto snapshot = kz::telemetry::snapshot();
+        REQUIRE(errors_of(snapshot, kz::telemetry::counts<int>().type) - before == 4000);
+        REQUIRE(errors_of(kz::telemetry::thread_snapshot(), kz::telemetry::counts<int>().type) == thread_before);
+    }
+
+    SECTION("Counted while threads exit") {
+        // Destroyed after the thread's counters are released: counted in
+        // the block shared by exiting threads
+        struct Late {
+            ~Late() {
+                for (int i = 0; i != 1000; ++i) {
+                    std::expected<long, short> e = std::unexpected(static_cast<short>(i));
+                    (void)e;
+                }
+            }
+        };
+
+        const auto before = kz::telemetry::counts<short>().errors;
+        std::vector<std::thread> threads;
+        for (int t = 0; t != 4; ++t) {
+            threads.emplace_back([] {
+                thread_local Late late;
+                (void)late;
+                std::expected<long, short> e = std::unexpected(short(1));
+                (void)e;
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        REQUIRE(kz::telemetry::counts<short>().errors - before == 4 * 1001);
+    }
+
+    SECTION("Constant evaluation") {
+        constexpr std::expected<int, errc> e = std::unexpected(errc::invalid);
+        STATIC_REQUIRE(!e.has_value());
+    }
+}
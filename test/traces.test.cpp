@@ -0,0 +1,200 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Built as its own executable, with KZ_EXPECTED_SAMPLE_TRACES=1
+
+namespace {
+
+    enum class errc { invalid = 1 };
+
+    __attribute__((noinline)) std::expected<int, errc> fail(int i) {
+        if (i >= 0)
+            return std::unexpected(errc::invalid);
+        return i;
+    }
+
+    // The barrier after the call keeps it from becoming a tail call, so
+    // that these frames show up in the stack
+    __attribute__((noinline)) void call_a() { (void)fail(1); asm volatile("" ::: "memory"); }
+    __attribute__((noinline)) void call_b() { (void)fail(2); asm volatile("" ::: "memory"); }
+
+    enum class other_errc { invalid = 1 };
+
+    __attribute__((noinline)) std::expected<int, other_errc> fail_deep(int depth) {
+        if (depth == 0)
+            return std::unexpected(other_errc::invalid);
+        auto r = fail_deep(depth - 1);
+        asm volatile("" ::: "memory");
+        return r;
+    }
+
+    std::size_t count_samples(std::uint64_t since) {
+        std::size_t count = 0;
+        for (const auto& t : kz::traces::snapshot()) {
+            if (t.sequence >= since && t.type.find("errc") != std::string_view::npos)
+                ++count;
+        }
+        return count;
+    }
+
+} // namespace
+
+static_assert(KZ_EXPECTED_SAMPLE_TRACES);
+
+TEST_CASE("traces", "[traces]") {
+    const auto rate = kz::traces::sample_rate();
+
+    SECTION("One in N") {
+        kz::traces::set_sample_rate(4);
+        const auto since = kz::traces::samples_taken();
+        for (int i = 0; i != 100; ++i)
+            (void)fail(i);
+        REQUIRE(kz::traces::samples_taken() - since == 25);
+        REQUIRE(count_samples(since) == 25);
+    }
+
+    SECTION("Disabled") {
+        kz::traces::set_sample_rate(0);
+        const auto since = kz::traces::samples_taken();
+        for (int i = 0; i != 100; ++i)
+            (void)fail(i);
+        REQUIRE(kz::traces::samples_taken() == since);
+    }
+
+    SECTION("Stacks tell call sites apart") {
+        kz::traces::set_sample_rate(1);
+        const auto since = kz::traces::samples_taken();
+        for (int i = 0; i != 2; ++i)
+            call_a();
+        call_b();
+        const auto traces = kz::traces::snapshot();
+        REQUIRE(traces.size() >= 3);
+        const auto& a1 = traces[traces.size() - 3];
+        const auto& a2 = traces[traces.size() - 2];
+        const auto& b = traces.back();
+        REQUIRE(a1.sequence == since);
+        REQUIRE(b.type.find("errc") != std::string_view::npos);
+#if __has_include(<unwind.h>)
+        REQUIRE(a1.depth >= 2);
+        // The loop may be unrolled, so only the frames up to call_a() are
+        // known to match, and call_b() must differ somewhere in those
+        const auto end = a1.frames.begin() + std::min(a1.depth, a2.depth);
+        const auto same = std::mismatch(a1.frames.begin(), end, a2.frames.begin()).first;
+        REQUIRE(same != a1.frames.begin());
+        REQUIRE(!std::equal(a1.frames.begin(), same, b.frames.begin()));
+#endif
+    }
+
+    SECTION("Ring buffer keeps the latest samples") {
+        kz::traces::set_sample_rate(1);
+        for (std::size_t i = 0; i != 2 * kz::traces::capacity; ++i)
+            (void)fail(1);
+        const auto traces = kz::traces::snapshot();
+        REQUIRE(traces.size() == kz::traces::capacity);
+        REQUIRE(traces.back().sequence == kz::traces::samples_taken() - 1);
+        REQUIRE(traces.front().sequence == kz::traces::samples_taken() - kz::traces::capacity);
+    }
+
+    SECTION("Rate changes reach other threads") {
+        kz::traces::set_sample_rate(1000000);
+        std::atomic<int> phase{0};
+        std::uint64_t since = 0;
+        std::thread t([&] {
+            (void)fail(1);
+            phase = 1;
+            while (phase != 2)
+                std::this_thread::yield();
+            for (int i = 0; i != 10; ++i)
+                (void)fail(1);
+        });
+        while (phase != 1)
+            std::this_thread::yield();
+        kz::traces::set_sample_rate(2);
+        since = kz::traces::samples_taken();
+        phase = 2;
+        t.join();
+        REQUIRE(kz::traces::samples_taken() - since == 5);
+    }
+
+    SECTION("Threads writing the same record") {
+        // Each thread fills the ring many times over, so threads a ring
+        // apart race for the same records: every sample kept must be whole
+        kz::traces::set_sample_rate(1);
+        std::vector<std::thread> threads;
+        for (int t = 0; t != 4; ++t) {
+            threads.emplace_back([t] {
+                for (std::size_t i = 0; i != 20 * kz::traces::capacity; ++i) {
+                    if (t % 2)
+                        (void)fail_deep(4);
+                    else
+                        (void)fail(1);
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        const auto traces = kz::traces::snapshot();
+        REQUIRE(!traces.empty());
+        std::size_t depth[2] = {};
+        for (const auto& t : traces) {
+            const bool deep = t.type.find("other_errc") != std::string_view::npos;
+            if (!depth[deep])
+                depth[deep] = t.depth;
+            REQUIRE(t.depth == depth[deep]);
+        }
+    }
+
+    SECTION("Dump") {
+        kz::traces::set_sample_rate(1);
+        for (int i = 0; i != 3; ++i)
+            (void)fail(1);
+        std::FILE* file = std::tmpfile();
+        REQUIRE(kz::traces::dump(file) == kz::traces::snapshot().size());
+        std::rewind(file);
+        std::string text;
+        char buffer[256];
+        while (std::fgets(buffer, sizeof(buffer), file))
+            text += buffer;
+        std::fclose(file);
+        REQUIRE(text.find("error samples, 1 in 1 per thread") != std::string::npos);
+        REQUIRE(text.find(" x ") != std::string::npos);
+        REQUIRE(text.find("errc") != std::string::npos);
+#if __has_include(<unwind.h>)
+        REQUIRE(text.find("#0 ") != std::string::npos);
+#endif
+    }
+
+    kz::traces::set_sample_rate(rate);
+}
@@ -0,0 +1,124 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/try.hpp>
+#include <catch2/catch.hpp>
+#include <string>
+
+namespace {
+
+    struct Tracked {
+        static inline int copies = 0;
+        static inline int moves = 0;
+
+        int code;
+
+        explicit Tracked(int c) : code(c) {}
+        Tracked(const Tracked& other) : code(other.code) { ++copies; }
+        Tracked(Tracked&& other) noexcept : code(other.code) { ++moves; }
+
+        static void reset() { copies = moves = 0; }
+    };
+
+    std::expected<int, Tracked> parse(int x) {
+        if (x < 0)
+            return std::unexpected(Tracked(x));
+        return x * 2;
+    }
+
+    std::expected<void, Tracked> check(int x) {
+        if (x > 100)
+            return std::unexpected(Tracked(x));
+        return {};
+    }
+
+    std::expected<std::string, Tracked> assign(int x) {
+        KZ_TRY_ASSIGN(const auto a, parse(x));
+        KZ_TRY_ASSIGN(auto b, parse(a));
+        KZ_TRY(check(b));
+
+        std::string s;
+        KZ_TRY_ASSIGN(s, std::expected<std::string, Tracked>(std::to_string(b)));
+        return s;
+    }
+
+    // The error type of the caller only has to be constructible from the error
+    struct Wrapped {
+        Tracked inner;
+        Wrapped(Tracked t) : inner(std::move(t)) {}
+    };
+
+    std::expected<int, Wrapped> convert(int x) {
+        KZ_TRY_ASSIGN(auto a, parse(x));
+        return a + 1;
+    }
+
+    std::expected<int, Tracked> from_lvalue(const std::expected<int, Tracked>& e) {
+        KZ_TRY_ASSIGN(auto a, e);
+        return a;
+    }
+
+#if KZ_HAS_STATEMENT_EXPRESSIONS
+    std::expected<int, Tracked> expression(int x) {
+        const int a = KZ_TRY(parse(x));
+        KZ_TRY(check(a));
+        return KZ_TRY(parse(a)) + 1;
+    }
+#endif
+
+} // namespace
+
+TEST_CASE("KZ_TRY_ASSIGN", "[try]") {
+    REQUIRE(assign(5) == "20");
+
+    Tracked::reset();
+    const auto r = assign(-3);
+    REQUIRE(r.error().code == -3);
+    REQUIRE(Tracked::copies == 0);
+    // Two moves to build the result of parse(), one to propagate it
+    REQUIRE(Tracked::moves == 3);
+    Tracked::reset();
+
+    REQUIRE(assign(30).error().code == 120);
+    REQUIRE(convert(1) == 3);
+    REQUIRE(convert(-1).error().inner.code == -1);
+
+    const std::expected<int, Tracked> e(std::unexpect, 9);
+    Tracked::reset();
+    REQUIRE(from_lvalue(e).error().code == 9);
+    REQUIRE(Tracked::copies == 1);
+    REQUIRE(e.error().code == 9);
+}
+
+#if KZ_HAS_STATEMENT_EXPRESSIONS
+TEST_CASE("KZ_TRY", "[try]") {
+    REQUIRE(expression(5) == 21);
+    REQUIRE(expression(-5).error().code == -5);
+    REQUIRE(expression(60).error().code == 120);
+}
+#endif
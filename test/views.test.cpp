@@ -0,0 +1,118 @@
+/*
+    Copyright (c) 2022, Thierry Tremblay
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <expected>
+#include <kz/expected_bits/views.hpp>
+#include <catch2/catch.hpp>
+#include <ranges>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Result = std::expected<std::string, int>;
+
+    std::vector<Result> make_results() {
+        return {"a", std::unexpected(1), "b", std::unexpected(2), "c"};
+    }
+
+} // namespace
+
+TEST_CASE("views::values", "[views]") {
+    auto v = make_results();
+    auto values = v | kz::views::values;
+    static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(values)>, std::string&>);
+    REQUIRE(std::ranges::equal(values, std::vector<std::string>{"a", "b", "c"}));
+
+    // References into the elements
+    for (auto& s : values)
+        s += "!";
+    REQUIRE(v[2] == "b!");
+    REQUIRE(&*values.begin() == &*v[0]);
+
+    const auto& cv = v;
+    static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(cv | kz::views::values)>, const std::string&>);
+
+    // Composes with std::views
+    auto sizes = v | kz::views::values | std::views::transform(&std::string::size);
+    REQUIRE(std::ranges::equal(sizes, std::vector<std::size_t>{2, 2, 2}));
+}
+
+TEST_CASE("views::errors", "[views]") {
+    auto v = make_results();
+    auto errors = v | kz::views::errors;
+    static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(errors)>, int&>);
+    REQUIRE(std::ranges::equal(errors, std::vector<int>{1, 2}));
+    REQUIRE(&*errors.begin() == &v[1].error());
+
+    std::vector<std::expected<void, int>> vv(2);
+    vv.emplace_back(std::unexpect, 3);
+    REQUIRE(std::ranges::equal(vv | kz::views::errors, std::vector<int>{3}));
+}
+
+TEST_CASE("views::unwrap_or", "[views]") {
+    auto v = make_results();
+    auto unwrapped = v | kz::views::unwrap_or(std::string("?"));
+    static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(unwrapped)>, const std::string&>);
+    REQUIRE(std::ranges::equal(unwrapped, std::vector<std::string>{"a", "?", "b", "?", "c"}));
+    REQUIRE(&*unwrapped.begin() == &*v[0]);
+
+    std::vector<std::expected<int, std::string>> ints{1, std::unexpected("x"), 3};
+    REQUIRE(std::ranges::equal(ints | kz::views::unwrap_or(0), std::vector<int>{1, 0, 3}));
+}
+
+TEST_CASE("views over a range of prvalues", "[views]") {
+    // The elements are temporaries, long strings make a dangling reference visible under ASan
+    auto make = [](int i) -> std::expected<std::string, std::string> {
+        if (i % 2)
+            return std::unexpected(std::string(40, 'A' + i));
+        return std::string(40, 'a' + i);
+    };
+    const std::vector<int> ids{0, 1, 2, 3};
+
+    auto values = ids | std::views::transform(make) | kz::views::values;
+    static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(values)>, std::string>);
+    std::vector<std::string> seen;
+    for (const auto& s : values)
+        seen.push_back(s);
+    REQUIRE(seen == std::vector<std::string>{std::string(40, 'a'), std::string(40, 'c')});
+
+    auto errors = ids | std::views::transform(make) | kz::views::errors;
+    static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(errors)>, std::string>);
+    REQUIRE(std::ranges::equal(errors, std::vector<std::string>{std::string(40, 'B'), std::string(40, 'D')}));
+}
+
+TEST_CASE("partition_results", "[views]") {
+    auto v = make_results();
+    const auto failures = kz::partition_results(v);
+    REQUIRE(failures.begin() == v.begin() + 3);
+    REQUIRE(failures.end() == v.end());
+    REQUIRE(v == std::vector<Result>{"a", "b", "c", std::unexpected(1), std::unexpected(2)});
+
+    std::vector<Result> none{"a"};
+    REQUIRE(kz::partition_results(none).empty());
+}